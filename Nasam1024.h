@@ -11,7 +11,10 @@
 #include <limits>
 
 #include "RNG_SplitMix64.h"
+#include "RNG_mix.h"    // nasam()
+#include "RNG_engine.h"
 #include "RNG_random_device.h"
+#include "RNG_stats.h"
 #include "umul128.h"   // platform-specific 64×64→128 multiplication
 
 
@@ -21,50 +24,6 @@
 
 
 
-// ─────────────────────────────────────────────────────────────────────────────
-// Mixing functions
-// ─────────────────────────────────────────────────────────────────────────────
-namespace RNG {
-	/*
-	NASAM (Not Another Strange Adding Mixer) - 64-bit Variant
-
-	Mixer: Strong triple-multiply 64-bit unary mixer
-		Inspired by Pelle Evensen's high-quality non-cryptographic mixers
-		(rrmxmx constant 0x9FB21C651E98DF25 and overall strong mixing patterns)
-		See: http://mostlymangling.blogspot.com/
-		Golden-ratio-derived multipliers common in hashing/PRNG literature
-	*/
-	[[nodiscard]] inline constexpr uint64_t nasam(uint64_t v) noexcept {
-		/*
-		History (ignore if you want):
-
-		Here is the original version by Pelle Evensen.
-		Source: https://mostlymangling.blogspot.com/2020/01/nasam-not-another-strange-acronym-mixer.html
-
-			uint64_t nasam(uint64_t x) {
-				// ror64(a, r) is a 64-bit rotation of a by r bits.
-				x ^= ror64(x, 25) ^ ror64(x, 47);
-				x *= 0x9E6C63D0676A9A99UL;
-				x ^= x >> 23 ^ x >> 51;
-				x *= 0x9E6D62D06F6A9A9BUL;
-				x ^= x >> 23 ^ x >> 51;
-
-				return x;
-			}
-		Note that his version differs from mine in constants and other details,
-		but he gets the credit for developing the general pattern.
-		*/
-		v *= 0x9E6F1D9BB2D6C165ULL;
-		v ^= std::rotr(v, 26);
-		v *= 0x9E6F1D9BB2D6C165ULL;
-		v ^= std::rotr(v, 47) ^ std::rotr(v, 21);
-		v *= 0x9FB21C651E98DF25ULL; // Strong multiplier popularized in rrmxmx 
-		// (orig. xxHash prime)			
-		return v ^ (v >> 28);
-	}
-}
-
-
 // ─────────────────────────────────────────────────────────────────────────────
 // 1024-bit additive counter
 // ─────────────────────────────────────────────────────────────────────────────
@@ -403,7 +362,7 @@ namespace RNG {
 
 	PractRand command completed successfully
 	*/
-	class Nasam1024 {
+	class Nasam1024 : public engine_base<Nasam1024> {
 	protected:
 		// Declare counter
 		int static constexpr COUNTERSIZE = 16; // 1024 bits / 64 bits per lane
@@ -415,6 +374,7 @@ namespace RNG {
 		int buffer_position = BUFFERSIZE;  // buffer_position==BUFFERSIZE means buffer is empty
 
 		inline void refill_buffer() noexcept {
+			stats::count<Nasam1024>(stats::refills);
 			// This ++ operator actually "increments" the counter by a complex 1024 bit integer.
 			// See class Counter_1024 for details
 			++counter; 
@@ -428,6 +388,15 @@ namespace RNG {
 			buffer_position = 0; // buffer is full
 		}
 
+		// Recompute a non-empty buffer after the counter changed, keeping the
+		// position in the block, so that the buffer always matches the counter
+		// (checkpoint(), at() and restore() assume it does)
+		inline void rebuild_buffer() noexcept {
+			if (!is_buffer_empty())
+				for (int i = 0; i < BUFFERSIZE; ++i)
+					buffer[i] = nasam(counter[i + BUFFERSIZE]);
+		}
+
 		inline bool is_buffer_empty() const noexcept { return (buffer_position == BUFFERSIZE); }
 		inline bool is_buffer_full () const noexcept { return (buffer_position == 0); }
 
@@ -448,7 +417,7 @@ namespace RNG {
 
 		// Construct from a single 64-bit seed (deterministic) using SplitMix64
 		explicit Nasam1024(uint64_t seed) {
-			reseed(seed);
+			set_seed(seed);
 		}
 
 		// Construct from an explicit full 1024-bit initial_state, where initial_state
@@ -463,7 +432,7 @@ namespace RNG {
 		}
 
 		// Construct from any SeedSequence-compatible type (e.g., std::seed_seq, random_device)
-		template<class Sseq>
+		template<seed_sequence Sseq>
 		explicit Nasam1024(Sseq& seq) {
 			std::uint32_t seeds[2*COUNTERSIZE];
 			seq.generate(seeds, seeds + 2* COUNTERSIZE);
@@ -489,6 +458,7 @@ namespace RNG {
 
 		// Generate the next 64 bit random number
 		inline uint64_t operator()() noexcept {
+			stats::count<Nasam1024>(stats::draws);
 			if (is_buffer_empty())
 				refill_buffer();
 			return buffer[buffer_position++];
@@ -505,46 +475,73 @@ namespace RNG {
 		// fill a byte buffer with n bytes of random data
 		inline void bulk(uint8_t* x, size_t n) noexcept
 		{
+			stats::count<Nasam1024>(stats::bulk_bytes, n);
 			uint8_t* p = x;
-			// Assume we have an empty buffer at start. So, we have to refill_buffer 
-			// each time we want another 64 bytes.
-			
+			// Use up what is left in the buffer first, so that bulk() continues
+			// the same stream as operator().
+			while (n > 0 && buffer_position < BUFFERSIZE) {
+				size_t k = std::min<size_t>(n, sizeof(uint64_t));
+				memcpy(p, &buffer[buffer_position++], k);
+				n -= k;
+				p += k;
+			}
+
 			// fill full buffer-sized chunks
 			constexpr size_t bufsize = BUFFERSIZE * sizeof(uint64_t); // 64 bytes
 			while (n >= bufsize) {
 				refill_buffer();
 				memcpy(p, buffer, bufsize);
+				buffer_position = BUFFERSIZE;
 				n -= bufsize;
 				p += bufsize;
 			}
-			// fill any remaining bytes
+			// fill any remaining bytes; a partly used word counts as used
 			if (n > 0) {
 				refill_buffer();
 				memcpy(p, buffer, n);
+				buffer_position = static_cast<int>((n + 7) / 8);
 			}
-			// invalidate the buffer
-			buffer_position = BUFFERSIZE;
 		}
 
-		// Optional convenience overloads 
-		void fill(std::span<std::byte> data) noexcept {
-			bulk(reinterpret_cast<uint8_t*>(data.data()), data.size());
-		}
-
-		template <class T, size_t N>
-		void fill(std::array<T, N>& arr) noexcept {
-			fill(std::as_bytes(std::span(arr)));
-		}
-
-		template <class T>
-		void fill(std::vector<T>& vec) noexcept {
-			fill(std::as_bytes(std::span(vec)));
+		// Internal iteration: the next n outputs, the same ones n calls to
+		// operator() would return, passed to f as consecutive blocks
+		// (std::span<const uint64_t>) of at most BUFFERSIZE words. The counter
+		// is copied to a local for the whole loop instead of being reloaded
+		// after every output. f must not use this engine; if f throws, the
+		// engine's position is unspecified.
+		template <class F>
+		void for_each_block(uint64_t n, F&& f) {
+			stats::count<Nasam1024>(stats::bulk_bytes, n * sizeof(uint64_t));
+			if (n > 0 && !is_buffer_empty()) {
+				const int k = static_cast<int>(std::min<uint64_t>(n, BUFFERSIZE - buffer_position));
+				f(std::span<const uint64_t>(buffer + buffer_position, static_cast<size_t>(k)));
+				buffer_position += k;
+				n -= static_cast<uint64_t>(k);
+			}
+			Counter_1024 c = counter;
+			uint64_t block[BUFFERSIZE];
+			for (; n >= BUFFERSIZE; n -= BUFFERSIZE) {
+				++c;
+				for (int i = 0; i < BUFFERSIZE; ++i)
+					block[i] = nasam(c[i + BUFFERSIZE]);
+				stats::count<Nasam1024>(stats::refills);
+				f(std::span<const uint64_t>(block, BUFFERSIZE));
+			}
+			counter = c;
+			if (n > 0) {
+				refill_buffer();
+				f(std::span<const uint64_t>(buffer, static_cast<size_t>(n)));
+				buffer_position = static_cast<int>(n);
+			}
 		}
 
-		// Fill a byte buffer with random data
-		// Useful for generating random keys, noise, or initializing memory
-		void fill(uint8_t* data, size_t size) noexcept {
-			bulk(data, size);
+		// f(x) for each of the next n outputs, see for_each_block()
+		template <class F>
+		void generate_n(uint64_t n, F&& f) {
+			for_each_block(n, [&](std::span<const uint64_t> block) {
+				for (uint64_t x : block)
+					f(x);
+			});
 		}
 
 		// 
@@ -553,8 +550,10 @@ namespace RNG {
 
 		// Since this is a non-cryptographic RNG, we provide state get/set functions
 
+		// The next output is the first of the block after initial_counter
 		Nasam1024& set_counter(const Counter_1024& initial_counter) noexcept {
 			counter = initial_counter;
+			buffer_position = BUFFERSIZE;
 			return *this;
 		}
 
@@ -562,8 +561,21 @@ namespace RNG {
 			return counter;
 		}
 
+		// n-th output from the current position (0 = the next one) without
+		// advancing: block b ahead of the current buffer is nasam() of the
+		// counter + b increments.
+		uint64_t at(uint64_t n) const noexcept {
+			const uint64_t k = n + static_cast<uint64_t>(buffer_position); // from the start of the current buffer
+			if (k < BUFFERSIZE)
+				return buffer[k];
+			Counter_1024 c = counter;
+			c += k / BUFFERSIZE;
+			return nasam(c[static_cast<int>(k % BUFFERSIZE) + BUFFERSIZE]);
+		}
+
 		// Advance the RNG state by 'n' outputs without generating them.
 		void discard(uint64_t n) noexcept {
+			stats::count<Nasam1024>(stats::discards);
 			// Goal: Advance the RNG forward by exactly 'n' output values,
 			// without generating them individually (for efficiency).
 
@@ -607,26 +619,33 @@ namespace RNG {
 		}
 
 		void big_jump(uint64_t step[16]) {
+			stats::count<Nasam1024>(stats::jumps);
 			counter.big_jump(step);
+			rebuild_buffer();
 		}
 		void jump64() {
 			uint64_t step[16] = { 0,1,0,0, 0,0,0,0, 0,0,0,0, 0,0,0,0 };
-			counter.big_jump(step);
+			big_jump(step);
 		}
 		void jump128() {
 			uint64_t step[16] = { 0,0,1,0, 0,0,0,0, 0,0,0,0, 0,0,0,0 };
-			counter.big_jump(step);
+			big_jump(step);
 		}
 		void jump192() {
 			uint64_t step[16] = { 0,0,0,1, 0,0,0,0, 0,0,0,0, 0,0,0,0 };
-			counter.big_jump(step);
+			big_jump(step);
 		}
 		void jump256() {
 			uint64_t step[16] = { 0,0,0,0, 1,0,0,0, 0,0,0,0, 0,0,0,0 };
-			counter.big_jump(step);
+			big_jump(step);
 		}
 		void jump() { jump128(); }
 		void long_jump() { jump256(); }
+		// jump() 'times' times, in one step
+		void jump(uint64_t times) {
+			uint64_t step[16] = { 0,0,times,0, 0,0,0,0, 0,0,0,0, 0,0,0,0 };
+			big_jump(step);
+		}
 
 	public:	// Compatibility
 		using result_type = uint64_t;
@@ -652,6 +671,22 @@ namespace RNG {
 			buffer_position = s.buffer_position;
 		}
 
+		// Compact binary checkpoint (see RNG_checkpoint.h): the counter value
+		// (the increment is a constant) and the buffer position, 129 bytes.
+		// The buffer is a function of the counter, so restore() recomputes it.
+		static constexpr size_t CHECKPOINT_BYTES = COUNTERSIZE * 8 + 1;
+
+		void checkpoint(uint8_t* out) const noexcept {
+			memcpy(out, counter.data(), COUNTERSIZE * 8);
+			out[COUNTERSIZE * 8] = static_cast<uint8_t>(buffer_position);
+		}
+
+		void restore(const uint8_t* in) noexcept {
+			memcpy(counter.data(), in, COUNTERSIZE * 8);
+			buffer_position = std::min<int>(in[COUNTERSIZE * 8], BUFFERSIZE);
+			rebuild_buffer();
+		}
+
 		// Constants required by the concept
 		static constexpr result_type min() noexcept { return 0; }
 		static constexpr result_type max() noexcept { return std::numeric_limits<result_type>::max(); }
@@ -659,17 +694,20 @@ namespace RNG {
 		// 1. seed() with no argument — same as default constructor
 		void seed() {
 			*this = Nasam1024();  // delegating to default ctor
+			stats::count<Nasam1024>(stats::reseeds);
 		}
 
 		// 2. seed() with single uint64_t — delegate to your existing ctor
 		void seed(uint64_t s) {
 			*this = Nasam1024(s);
+			stats::count<Nasam1024>(stats::reseeds);
 		}
 
 		// 3. seed() with SeedSequence — delegate to template ctor
-		template<class Sseq>
+		template<seed_sequence Sseq>
 		void seed(Sseq& seq) {
 			*this = Nasam1024(seq);
+			stats::count<Nasam1024>(stats::reseeds);
 		}
 
 		// 4. Equality / inequality — compare full state
@@ -685,6 +723,13 @@ namespace RNG {
 		}
 
 		void reseed(uint64_t seed) noexcept {
+			stats::count<Nasam1024>(stats::reseeds);
+			set_seed(seed);
+		}
+
+	private:
+		// reseed() without the usage count (RNG_stats.h), for the constructor
+		void set_seed(uint64_t seed) noexcept {
 			RNG::SplitMix64 gen(seed);
 			uint64_t step[16];
 			for (int i = 0; i < 16; i++)
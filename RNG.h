@@ -10,6 +10,13 @@
 
 #define NOMINMAX
 
+// The single engine headers include only what the engines need. This header
+// also brings in <iostream> and <random>, which most users of it expect (see
+// the example in README.md). For fast builds include single engines, or use
+// the module: import rng; (rng.cppm)
+#include <iostream>
+#include <random>
+
 #include "RNG_random_device.h"  // Platform entropy source (non-deterministic) — ~0.062 GB/s (OS-limited)
 
 #include "RNG_SplitMix64.h"     // Classic fast seeder — ~5.60 GB/s
@@ -20,6 +27,6 @@
                                 //   Single-call: ~5.35 GB/s
                                 //   Bulk mode:    ~8.77 GB/s
 
-#include "RNG_Nasam1024.h"       // 1024-bit state, 2^1024 period, NASAM mixing
+#include "Nasam1024.h"           // 1024-bit state, 2^1024 period, NASAM mixing
                                 //   Single-call: ~1.58 GB/s
                                 //   Bulk mode:   ~1.77 GB/s
@@ -2,6 +2,8 @@
 // File: RNG_SplitMix64.h
 
 #include "common.h"
+#include "RNG_engine.h"
+#include "RNG_stats.h"
 
 namespace RNG {
 
@@ -10,13 +12,21 @@ namespace RNG {
     // the non-deterministic seeding constructor.
     // -----------------------------------------------------------------
 
-    class SplitMix64 {
+    class SplitMix64 : public engine_base<SplitMix64> {
         // u64 is defined in RNG_detail.h, namespace RNG.
         static constexpr u64 INCREMENT = 0x9e3779b97f4a7c15ULL;
         static constexpr u64 MUL1 = 0xbf58476d1ce4e5b9ULL;
         static constexpr u64 MUL2 = 0x94d049bb133111ebULL;
 
         u64 state;
+
+        static constexpr u64 mix(u64 z) noexcept {
+            z = (z ^ (z >> 30)) * MUL1;
+            z = (z ^ (z >> 27)) * MUL2;
+            return z ^ (z >> 31);
+        }
+
+        template <class E> friend struct soa_kernel;  // RNG_engine_array.h
     public:
         using result_type = u64;
 
@@ -40,17 +50,55 @@ namespace RNG {
         // Deterministic is defined in RNG_detail.h, namespace RNG.
         constexpr SplitMix64(Deterministic, u64 seed) noexcept : state(seed) {}
         constexpr u64 operator()() noexcept {
-            u64 z = (state += INCREMENT);
-            z = (z ^ (z >> 30)) * MUL1;
-            z = (z ^ (z >> 27)) * MUL2;
-            return z ^ (z >> 31);
+            stats::count<SplitMix64>(stats::draws);
+            return mix(state += INCREMENT);
+        }
+
+        // Internal iteration: the next n outputs, the same ones n calls to
+        // operator() would return, with the state in a local for the whole
+        // loop. for_each_block() passes them to f in blocks
+        // (std::span<const u64>) of at most 64 words, generate_n() one at a
+        // time. f must not use this engine.
+        template <class F>
+        void for_each_block(u64 n, F&& f) {
+            stats::count<SplitMix64>(stats::bulk_bytes, n * sizeof(u64));
+            u64 s = state;
+            std::array<u64, 64> block;
+            while (n > 0) {
+                const std::size_t k = static_cast<std::size_t>(std::min<u64>(n, block.size()));
+                for (std::size_t i = 0; i < k; ++i)
+                    block[i] = mix(s += INCREMENT);
+                state = s;
+                f(std::span<const u64>(block.data(), k));
+                n -= k;
+            }
+        }
+
+        template <class F>
+        void generate_n(u64 n, F&& f) {
+            stats::count<SplitMix64>(stats::bulk_bytes, n * sizeof(u64));
+            u64 s = state;
+            for (u64 i = 0; i < n; ++i)
+                f(mix(s += INCREMENT));
+            state = s;
+        }
+
+        // n-th output from the current position (0 = the next one) without advancing
+        constexpr u64 at(u64 n) const noexcept {
+            return mix(state + (n + 1) * INCREMENT);
         }
 
         constexpr SplitMix64& discard(u64 n) noexcept {
+            stats::count<SplitMix64>(stats::discards);
             state += INCREMENT * n;
             return *this;
         }
 
+        // Compact binary checkpoint (see RNG_checkpoint.h)
+        static constexpr std::size_t CHECKPOINT_BYTES = 8;
+        void checkpoint(u8* out) const noexcept { std::memcpy(out, &state, sizeof(state)); }
+        void restore(const u8* in) noexcept { std::memcpy(&state, in, sizeof(state)); }
+
         static constexpr result_type min()  noexcept { return 0; }
         static constexpr result_type max()  noexcept { return UINT64_MAX; }
     };// class SplitMix64
@@ -0,0 +1,309 @@
+#pragma once
+// file RNG_any_engine.h
+//
+// RNG::any_engine, an engine chosen at run time.
+//
+// A std::function<u64()> makes one indirect call per output. any_engine's
+// virtual interface is block based instead: the wrapped engine fills a local
+// buffer of BLOCK words with one virtual call, and operator() serves from that
+// buffer inline. The indirect call is paid once per BLOCK outputs.
+//
+// The wrapped engine lives in a small buffer inside any_engine when it fits
+// (all engines of this library do), otherwise on the heap.
+//
+// Outputs are the wrapped engine's outputs, in order, whether they are drawn
+// with operator(), fill() or bulk(). Because of the read-ahead, the wrapped
+// engine itself is up to BLOCK words further on; it is not accessible.
+//
+// Factory
+//      any_engine e = RNG::make_engine("nasam1024", seed);
+//      any_engine r = RNG::make_engine("fast");            // platform entropy
+//
+//      Built-in names: "splitmix64", "wyrand", "fast", "nasam1024" (the names
+//      used in tape and checkpoint files). Plugins add their own with
+//      RNG::register_engine<E>("name"). An unknown name throws
+//      std::invalid_argument.
+//
+// Example
+//      RNG::any_engine rng = RNG::make_engine(config.engine, config.seed);
+//      std::normal_distribution<double> normal;
+//      double x = normal(rng);                 // no indirect call per draw
+//      rng.fill(std::span<u64>(words));        // one indirect call per block
+
+#define NOMINMAX
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "common.h"
+#include "RNG_file.h"
+
+namespace RNG {
+
+    class any_engine {
+    public:
+        static constexpr std::size_t BLOCK = 64;        // words per virtual call from operator()
+        static constexpr std::size_t INLINE_BYTES = 384; // small-buffer size, fits Nasam1024
+
+    private:
+        struct base {
+            virtual ~base() = default;
+            virtual void fill(u64* words, std::size_t count) = 0;
+            virtual base* clone_into(void* storage) const = 0;   // copy, placement new
+            virtual base* move_into(void* storage) noexcept = 0; // move, placement new
+            virtual base* clone_heap() const = 0;
+        };
+
+        template <class E>
+        struct model final : base {
+            E engine;
+
+            explicit model(E e) : engine(std::move(e)) {}
+            void fill(u64* words, std::size_t count) override
+            {
+                RNG::generate_n(engine, count, [&](u64 x) { *words++ = x; });
+            }
+            base* clone_into(void* storage) const override { return ::new (storage) model(engine); }
+            base* move_into(void* storage) noexcept override { return ::new (storage) model(std::move(engine)); }
+            base* clone_heap() const override { return new model(engine); }
+        };
+
+        template <class E>
+        static constexpr bool fits_inline = sizeof(model<E>) <= INLINE_BYTES
+            && alignof(model<E>) <= alignof(std::max_align_t)
+            && std::is_nothrow_move_constructible_v<E>;
+
+        alignas(std::max_align_t) unsigned char storage_[INLINE_BYTES];
+        base* self_ = nullptr;          // into storage_, or on the heap
+        std::array<u64, BLOCK> block_;
+        std::size_t pos_ = BLOCK;       // next unread word of block_
+
+        bool is_inline() const noexcept
+        {
+            return reinterpret_cast<const unsigned char*>(self_) == storage_;
+        }
+
+        void reset() noexcept
+        {
+            if (!self_) return;
+            if (is_inline()) self_->~base();
+            else delete self_;
+            self_ = nullptr;
+        }
+
+        void copy_from(const any_engine& other)
+        {
+            if (!other.self_) self_ = nullptr;
+            else if (other.is_inline()) self_ = other.self_->clone_into(storage_);
+            else self_ = other.self_->clone_heap();
+            std::memcpy(block_.data(), other.block_.data(), sizeof(block_));
+            pos_ = other.pos_;
+        }
+
+        void move_from(any_engine& other) noexcept
+        {
+            if (!other.self_) self_ = nullptr;
+            else if (other.is_inline()) { self_ = other.self_->move_into(storage_); other.reset(); }
+            else { self_ = other.self_; other.self_ = nullptr; }
+            std::memcpy(block_.data(), other.block_.data(), sizeof(block_));
+            pos_ = other.pos_;
+            other.pos_ = BLOCK;
+        }
+
+        void refill()
+        {
+            if (!self_)
+                throw std::logic_error("any_engine: empty");
+            self_->fill(block_.data(), BLOCK);
+            pos_ = 0;
+        }
+
+    public:
+        using result_type = u64;
+
+        any_engine() noexcept = default;
+
+        template <class E>
+            requires (!std::is_same_v<std::remove_cvref_t<E>, any_engine>)
+        any_engine(E&& engine)
+        {
+            using T = std::remove_cvref_t<E>;
+            if constexpr (fits_inline<T>)
+                self_ = ::new (static_cast<void*>(storage_)) model<T>(std::forward<E>(engine));
+            else
+                self_ = new model<T>(std::forward<E>(engine));
+        }
+
+        any_engine(const any_engine& other) { copy_from(other); }
+        any_engine(any_engine&& other) noexcept { move_from(other); }
+
+        any_engine& operator=(const any_engine& other)
+        {
+            if (this != &other) {
+                any_engine copy(other);
+                *this = std::move(copy);
+            }
+            return *this;
+        }
+
+        any_engine& operator=(any_engine&& other) noexcept
+        {
+            if (this != &other) {
+                reset();
+                move_from(other);
+            }
+            return *this;
+        }
+
+        ~any_engine() { reset(); }
+
+        explicit operator bool() const noexcept { return self_ != nullptr; }
+
+        inline u64 operator()()
+        {
+            if (pos_ == BLOCK)
+                refill();
+            return block_[pos_++];
+        }
+
+        // The next words.size() outputs: the buffered words first, then whole
+        // blocks straight from the wrapped engine with one virtual call
+        void fill(std::span<u64> words)
+        {
+            u64* p = words.data();
+            std::size_t n = words.size();
+            const std::size_t k = std::min(n, BLOCK - pos_);
+            std::memcpy(p, block_.data() + pos_, k * sizeof(u64));
+            pos_ += k;
+            p += k;
+            n -= k;
+            if (n == 0) return;
+            if (!self_)
+                throw std::logic_error("any_engine: empty");
+            self_->fill(p, n);
+        }
+
+        // Bytes of the following outputs; a partial last word counts as used,
+        // as with the engines' bulk()
+        void bulk(u8* data, std::size_t bytes)
+        {
+            const std::size_t whole = bytes / sizeof(u64);
+            u8* p = data;
+            for (std::size_t done = 0; done < whole; ) {
+                u64 words[BLOCK];
+                const std::size_t k = std::min(BLOCK, whole - done);
+                fill(std::span<u64>(words, k));
+                std::memcpy(p, words, k * sizeof(u64));
+                p += k * sizeof(u64);
+                done += k;
+            }
+            if (const std::size_t tail = bytes % sizeof(u64)) {
+                const u64 w = (*this)();
+                std::memcpy(p, &w, tail);
+            }
+        }
+
+        static constexpr result_type min() noexcept { return 0; }
+        static constexpr result_type max() noexcept { return std::numeric_limits<result_type>::max(); }
+    };
+
+    // ----------------------------------------------------------------------
+    // String-keyed factory
+    // ----------------------------------------------------------------------
+    namespace any_engine_detail {
+
+        struct factory {
+            std::function<any_engine(u64)> seeded;
+            std::function<any_engine()> unseeded;
+        };
+
+        template <class E>
+        factory make_factory()
+        {
+            factory f;
+            f.seeded = [](u64 seed) { return any_engine(E(seed)); };
+            if constexpr (std::is_default_constructible_v<E>)
+                f.unseeded = [] { return any_engine(E()); };
+            return f;
+        }
+
+        struct registry {
+            std::mutex mutex;
+            std::map<std::string, factory, std::less<>> factories;
+
+            registry()
+            {
+                factories.emplace(file_name<SplitMix64>::value, make_factory<SplitMix64>());
+                factories.emplace(file_name<wyrand>::value, make_factory<wyrand>());
+                factories.emplace(file_name<fast>::value, make_factory<fast>());
+                factories.emplace(file_name<Nasam1024>::value, make_factory<Nasam1024>());
+            }
+
+            static registry& instance()
+            {
+                static registry r;
+                return r;
+            }
+
+            factory find(std::string_view name)
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                const auto it = factories.find(name);
+                if (it == factories.end())
+                    throw std::invalid_argument("make_engine: unknown engine '" + std::string(name) + "'");
+                return it->second;
+            }
+        };
+
+    } // namespace any_engine_detail
+
+    // Make E available to make_engine() as 'name' (replaces an existing entry).
+    // E needs a u64 seed constructor; make_engine(name) without a seed also
+    // needs a default constructor.
+    template <class E>
+    void register_engine(std::string_view name)
+    {
+        auto& r = any_engine_detail::registry::instance();
+        std::lock_guard<std::mutex> lock(r.mutex);
+        r.factories.insert_or_assign(std::string(name), any_engine_detail::make_factory<E>());
+    }
+
+    inline any_engine make_engine(std::string_view name, u64 seed)
+    {
+        return any_engine_detail::registry::instance().find(name).seeded(seed);
+    }
+
+    // Seeded from platform entropy (the engine's default constructor)
+    inline any_engine make_engine(std::string_view name)
+    {
+        const auto f = any_engine_detail::registry::instance().find(name);
+        if (!f.unseeded)
+            throw std::invalid_argument("make_engine: engine '" + std::string(name) + "' needs a seed");
+        return f.unseeded();
+    }
+
+    // Registered names, sorted
+    inline std::vector<std::string> engine_names()
+    {
+        auto& r = any_engine_detail::registry::instance();
+        std::lock_guard<std::mutex> lock(r.mutex);
+        std::vector<std::string> names;
+        for (const auto& [name, f] : r.factories)
+            names.push_back(name);
+        return names;
+    }
+
+} // namespace RNG
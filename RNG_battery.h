@@ -0,0 +1,568 @@
+#pragma once
+// file RNG_battery.h
+//
+// RNG::battery - quick, multi-threaded statistical smoke test for any engine.
+//
+// Not a replacement for PractRand or TestU01 BigCrush. It is meant to run in
+// seconds to a few minutes on every build, so that a broken SIMD kernel, a
+// new mixer or a bad jump shows up before a multi-hour PractRand run.
+//
+// Tests (each run on several independent streams, in parallel)
+//      monobit             number of one bits
+//      byte_frequency      chi-square over the 256 byte values
+//      gap(hi), gap(lo)    gap test on the top / bottom 4 bits (hit = 0000)
+//      birthday(hi), (lo)  Marsaglia birthday spacings on the top / bottom
+//                          32 bits, m = 4096 birthdays, lambda = 4 per sample
+//      matrix_rank         GF(2) rank of 64x64 bit matrices built from 64 words
+//      linear_complexity   NIST linear complexity (M = 500) on bit 0 of each word
+//      fft                 NIST discrete Fourier transform test, 2^20 bits
+//      interstream(jump)   8 streams split with jump(): Hamming distance and
+//                          correlation of every pair of streams (engines with jump())
+//      interstream(split)  the same for 8 engines seeded from a SplitMix64
+//                          sequence, the way make_stream() splits engines
+//                          without jump()
+//
+// Streams of fast and wyrand seeded with adjacent seeds (seed, seed + 1) are
+// strongly correlated and fail the inter-stream test; derive parallel streams
+// with make_stream() or jump() instead.
+//
+// Every test returns one p-value per stream. The p-values of a test are
+// combined with Fisher's method in both directions (too bad and too good),
+// and the smaller of the two doubled (Bonferroni), so that the thresholds
+// are the false-alarm rates of the two-sided test:
+//      FAIL        combined p < 1e-8
+//      suspicious  combined p < 1e-4
+//      pass        otherwise
+//
+// Example
+//      RNG::battery::config cfg;            // all hardware threads, seed 12345
+//      auto report = RNG::battery::run<RNG::Nasam1024>(cfg);
+//      RNG::battery::print(report, std::cout);
+//      return report.passed() ? 0 : 1;
+//
+// See tools/rng_battery.cpp for a command-line driver.
+
+#define NOMINMAX
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <chrono>
+#include <cmath>
+#include <complex>
+#include <cstdint>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "common.h"
+#include "RNG_SplitMix64.h"
+
+namespace RNG::battery {
+
+    struct config {
+        u64 seed = 12345ull;
+        unsigned threads = std::max(1u, std::thread::hardware_concurrency());
+        unsigned replicates = 0; // streams per test; 0 = max(4, threads)
+        double scale = 1.0;      // multiplies the sample size of every test
+    };
+
+    enum class verdict { pass, suspicious, fail };
+
+    struct test_result {
+        std::string name;
+        std::vector<double> p;   // one per stream
+        double p_combined = 1.0; // two-sided Fisher combination, see above
+        verdict outcome = verdict::pass;
+    };
+
+    struct report {
+        std::vector<test_result> tests;
+        double seconds = 0.0;
+        u64 words = 0; // engine outputs consumed
+
+        bool passed() const noexcept {
+            return std::none_of(tests.begin(), tests.end(),
+                [](const test_result& t) { return t.outcome == verdict::fail; });
+        }
+    };
+
+    // -----------------------------------------------------------------
+    // Distributions
+    // -----------------------------------------------------------------
+    namespace math {
+
+        // Regularized lower incomplete gamma P(a, x)
+        inline double gamma_p(double a, double x);
+
+        // Regularized upper incomplete gamma Q(a, x) = 1 - P(a, x)
+        inline double gamma_q(double a, double x)
+        {
+            if (x <= 0.0) return 1.0;
+            if (x < a + 1.0) return 1.0 - gamma_p(a, x);
+            // continued fraction (modified Lentz)
+            const double tiny = 1e-300;
+            double b = x + 1.0 - a, c = 1.0 / tiny, d = 1.0 / b, h = d;
+            for (int i = 1; i < 10000; ++i) {
+                const double an = -i * (i - a);
+                b += 2.0;
+                d = an * d + b;
+                if (std::abs(d) < tiny) d = tiny;
+                c = b + an / c;
+                if (std::abs(c) < tiny) c = tiny;
+                d = 1.0 / d;
+                const double delta = d * c;
+                h *= delta;
+                if (std::abs(delta - 1.0) < 1e-15) break;
+            }
+            return std::exp(-x + a * std::log(x) - std::lgamma(a)) * h;
+        }
+
+        inline double gamma_p(double a, double x)
+        {
+            if (x <= 0.0) return 0.0;
+            if (x >= a + 1.0) return 1.0 - gamma_q(a, x);
+            // series
+            double sum = 1.0 / a, term = sum, ap = a;
+            for (int i = 0; i < 10000; ++i) {
+                ap += 1.0;
+                term *= x / ap;
+                sum += term;
+                if (std::abs(term) < std::abs(sum) * 1e-15) break;
+            }
+            return sum * std::exp(-x + a * std::log(x) - std::lgamma(a));
+        }
+
+        // P(X >= chi2) for X ~ chi-square(dof)
+        inline double chi2_sf(double chi2, double dof) { return gamma_q(0.5 * dof, 0.5 * chi2); }
+
+        // Two-sided p-value of a standard normal z
+        inline double normal_2sided(double z) { return std::erfc(std::abs(z) / std::sqrt(2.0)); }
+
+        // Two-sided mid-p value of k for X ~ Poisson(lambda). The mid-p is
+        // uniform enough that a plain p of exactly 1 (k at the mode) does not
+        // look "too good" to the combination below.
+        inline double poisson_2sided(u64 k, double lambda)
+        {
+            const double kd = static_cast<double>(k);
+            const double below = k == 0 ? 0.0 : gamma_q(kd, lambda); // P(X < k)
+            const double at = std::exp(kd * std::log(lambda) - lambda - std::lgamma(kd + 1.0));
+            const double lower = below + 0.5 * at;
+            return 2.0 * std::min(lower, 1.0 - lower);
+        }
+
+        // Chi-square p-value of observed counts against expected probabilities
+        inline double chi2_counts(const std::vector<u64>& observed, const std::vector<double>& prob)
+        {
+            double n = 0.0;
+            for (u64 o : observed) n += static_cast<double>(o);
+            double chi2 = 0.0;
+            for (std::size_t i = 0; i < observed.size(); ++i) {
+                const double e = n * prob[i];
+                const double d = static_cast<double>(observed[i]) - e;
+                chi2 += d * d / e;
+            }
+            return chi2_sf(chi2, static_cast<double>(observed.size() - 1));
+        }
+
+        // Fisher's method: P(chi-square(2k) >= -2 sum ln p)
+        inline double fisher(const std::vector<double>& p)
+        {
+            double x = 0.0;
+            for (double v : p) x += -2.0 * std::log(std::max(v, 1e-300));
+            return chi2_sf(x, 2.0 * static_cast<double>(p.size()));
+        }
+
+    } // namespace math
+
+    // -----------------------------------------------------------------
+    // Tests. Each reads 'words' outputs (or a fixed multiple of them) and
+    // returns one p-value.
+    // -----------------------------------------------------------------
+    namespace tests {
+
+        // Reads the engine in blocks through its bulk path
+        template <class E>
+        class reader {
+            E& e_;
+            std::vector<u64> block_;
+            std::size_t pos_;
+            u64 consumed_ = 0;
+
+        public:
+            explicit reader(E& e, std::size_t block = 4096) : e_(e), block_(block), pos_(block) {}
+
+            // Next block of outputs
+            const std::vector<u64>& next() {
+                fill_words(e_, block_.data(), block_.size());
+                consumed_ += block_.size();
+                return block_;
+            }
+            u64 operator()() {
+                if (pos_ == block_.size()) { next(); pos_ = 0; }
+                return block_[pos_++];
+            }
+            u64 consumed() const noexcept { return consumed_; }
+        };
+
+        template <class E>
+        double monobit(reader<E>& r, u64 words)
+        {
+            u64 ones = 0;
+            for (u64 n = 0; n < words; n += 4096)
+                for (u64 w : r.next())
+                    ones += static_cast<u64>(std::popcount(w));
+            const double bits = 64.0 * static_cast<double>(r.consumed());
+            return math::normal_2sided((static_cast<double>(ones) - 0.5 * bits) / std::sqrt(0.25 * bits));
+        }
+
+        template <class E>
+        double byte_frequency(reader<E>& r, u64 words)
+        {
+            std::vector<u64> count(256, 0);
+            for (u64 n = 0; n < words; n += 4096)
+                for (u64 w : r.next())
+                    for (int k = 0; k < 8; ++k)
+                        ++count[(w >> (8 * k)) & 0xff];
+            return math::chi2_counts(count, std::vector<double>(256, 1.0 / 256.0));
+        }
+
+        // Gap test: 4 bits at 'shift' equal to zero is a hit (p = 1/16); the
+        // number of misses between hits is geometric. Bins 0..127 and >= 128.
+        template <class E>
+        double gap(reader<E>& r, u64 words, int shift)
+        {
+            constexpr int T = 128;
+            constexpr double p = 1.0 / 16.0;
+            std::vector<u64> count(T + 1, 0);
+            u64 run = 0;
+            bool started = false;
+            for (u64 n = 0; n < words; n += 4096)
+                for (u64 w : r.next()) {
+                    if (((w >> shift) & 0xf) == 0) {
+                        if (started) ++count[std::min<u64>(run, T)];
+                        started = true;
+                        run = 0;
+                    }
+                    else {
+                        ++run;
+                    }
+                }
+            std::vector<double> prob(T + 1);
+            for (int k = 0; k < T; ++k) prob[k] = p * std::pow(1.0 - p, k);
+            prob[T] = std::pow(1.0 - p, T);
+            return math::chi2_counts(count, prob);
+        }
+
+        // Birthday spacings: m birthdays in a year of 2^32 days (32 bits at
+        // 'shift'); the number of repeated spacings per sample is ~Poisson(m^3 / 4n).
+        template <class E>
+        double birthday(reader<E>& r, u64 words, int shift)
+        {
+            constexpr std::size_t m = 4096;
+            const double lambda = std::pow(static_cast<double>(m), 3) / (4.0 * 0x1p32);
+            std::vector<u64> day(m), spacing(m);
+            u64 repeats = 0, samples = 0;
+            for (u64 n = 0; n < words; n += m, ++samples) {
+                for (std::size_t i = 0; i < m; ++i)
+                    day[i] = (r() >> shift) & 0xffffffffull;
+                std::sort(day.begin(), day.end());
+                for (std::size_t i = 1; i < m; ++i)
+                    spacing[i] = day[i] - day[i - 1];
+                spacing[0] = day[0] + 0x100000000ull - day[m - 1]; // around the year
+                std::sort(spacing.begin(), spacing.end());
+                for (std::size_t i = 1; i < m; ++i)
+                    repeats += (spacing[i] == spacing[i - 1]);
+            }
+            return math::poisson_2sided(repeats, lambda * static_cast<double>(samples));
+        }
+
+        // Rank over GF(2) of a 64x64 bit matrix, one word per row
+        inline int gf2_rank(u64 rows[64])
+        {
+            int rank = 0;
+            for (int bit = 63; bit >= 0 && rank < 64; --bit) {
+                const u64 mask = 1ull << bit;
+                int pivot = -1;
+                for (int i = rank; i < 64; ++i)
+                    if (rows[i] & mask) { pivot = i; break; }
+                if (pivot < 0) continue;
+                std::swap(rows[rank], rows[pivot]);
+                for (int i = 0; i < 64; ++i)
+                    if (i != rank && (rows[i] & mask)) rows[i] ^= rows[rank];
+                ++rank;
+            }
+            return rank;
+        }
+
+        template <class E>
+        double matrix_rank(reader<E>& r, u64 words)
+        {
+            // P(rank = k) for a random n x n matrix over GF(2):
+            // 2^(k(2n-k) - n^2) prod_{i<k} (1 - 2^(i-n))^2 / (1 - 2^(i-k))
+            auto prob = [](int k) {
+                constexpr int n = 64;
+                double v = std::exp2(static_cast<double>(k * (2 * n - k) - n * n));
+                for (int i = 0; i < k; ++i)
+                    v *= std::pow(1.0 - std::exp2(i - n), 2) / (1.0 - std::exp2(i - k));
+                return v;
+            };
+            const double p64 = prob(64), p63 = prob(63);
+            std::vector<u64> count(3, 0); // rank 64, 63, <= 62
+            u64 rows[64];
+            for (u64 n = 0; n < words; n += 64) {
+                for (auto& row : rows) row = r();
+                const int k = gf2_rank(rows);
+                ++count[k == 64 ? 0 : k == 63 ? 1 : 2];
+            }
+            return math::chi2_counts(count, { p64, p63, 1.0 - p64 - p63 });
+        }
+
+        // Berlekamp-Massey: length of the shortest LFSR generating s
+        inline int linear_complexity_of(const std::vector<u8>& s)
+        {
+            const int n = static_cast<int>(s.size());
+            std::vector<u8> c(n + 1, 0), b(n + 1, 0), t;
+            c[0] = b[0] = 1;
+            int L = 0, m = -1;
+            for (int i = 0; i < n; ++i) {
+                u8 d = s[i];
+                for (int j = 1; j <= L; ++j) d ^= c[j] & s[i - j];
+                if (d) {
+                    t = c;
+                    for (int j = 0; j + i - m <= n; ++j) c[j + i - m] ^= b[j];
+                    if (2 * L <= i) {
+                        L = i + 1 - L;
+                        m = i;
+                        b = t;
+                    }
+                }
+            }
+            return L;
+        }
+
+        // NIST SP 800-22 linear complexity test, M = 500, on bit 0 of each word.
+        // Low bits are where linear structure (LCG-like weakness) shows first.
+        template <class E>
+        double linear_complexity(reader<E>& r, u64 words)
+        {
+            constexpr int M = 500;
+            static constexpr double pi[7] = { 0.010417, 0.03125, 0.125, 0.5, 0.25, 0.0625, 0.020833 };
+            const double mu = M / 2.0 + (9.0 + ((M + 1) % 2 ? -1.0 : 1.0)) / 36.0 - (M / 3.0 + 2.0 / 9.0) / std::exp2(M);
+            std::vector<u64> count(7, 0);
+            std::vector<u8> bits(M);
+            for (u64 n = 0; n < words; n += M) {
+                for (int i = 0; i < M; ++i)
+                    bits[i] = static_cast<u8>(r() & 1);
+                const double T = ((M % 2) ? -1.0 : 1.0) * (linear_complexity_of(bits) - mu) + 2.0 / 9.0;
+                const int bin = T <= -2.5 ? 0 : T <= -1.5 ? 1 : T <= -0.5 ? 2 : T <= 0.5 ? 3 : T <= 1.5 ? 4 : T <= 2.5 ? 5 : 6;
+                ++count[bin];
+            }
+            return math::chi2_counts(count, std::vector<double>(pi, pi + 7));
+        }
+
+        inline void fft(std::vector<std::complex<double>>& a)
+        {
+            const std::size_t n = a.size();
+            for (std::size_t i = 1, j = 0; i < n; ++i) {
+                std::size_t bit = n >> 1;
+                for (; j & bit; bit >>= 1) j ^= bit;
+                j ^= bit;
+                if (i < j) std::swap(a[i], a[j]);
+            }
+            const double PI = 3.14159265358979323846;
+            for (std::size_t len = 2; len <= n; len <<= 1) {
+                const std::complex<double> w(std::cos(2 * PI / len), -std::sin(2 * PI / len));
+                for (std::size_t i = 0; i < n; i += len) {
+                    std::complex<double> wk(1.0, 0.0);
+                    for (std::size_t k = 0; k < len / 2; ++k) {
+                        const auto u = a[i + k], v = a[i + k + len / 2] * wk;
+                        a[i + k] = u + v;
+                        a[i + k + len / 2] = u - v;
+                        wk *= w;
+                    }
+                }
+            }
+        }
+
+        // NIST SP 800-22 discrete Fourier transform (spectral) test on 2^20 bits
+        template <class E>
+        double spectral(reader<E>& r)
+        {
+            constexpr std::size_t n = std::size_t(1) << 20;
+            std::vector<std::complex<double>> x(n);
+            for (std::size_t i = 0; i < n; i += 64) {
+                const u64 w = r();
+                for (int k = 0; k < 64; ++k)
+                    x[i + k] = ((w >> k) & 1) ? 1.0 : -1.0;
+            }
+            fft(x);
+            const double T = std::sqrt(std::log(1.0 / 0.05) * static_cast<double>(n));
+            u64 below = 0;
+            for (std::size_t i = 0; i < n / 2; ++i)
+                below += (std::abs(x[i]) < T);
+            const double N0 = 0.95 * static_cast<double>(n) / 2.0;
+            const double d = (static_cast<double>(below) - N0) / std::sqrt(static_cast<double>(n) * 0.95 * 0.05 / 4.0);
+            return math::normal_2sided(d);
+        }
+
+        // Every pair of streams: Hamming distance of the XOR (Binomial(64N, 1/2))
+        // and Pearson correlation of the words as uniforms (r sqrt(N) ~ N(0,1)).
+        template <class E>
+        double interstream(std::vector<E>& streams, u64 words)
+        {
+            const std::size_t k = streams.size();
+            constexpr std::size_t B = 4096;
+            std::vector<std::vector<u64>> block(k, std::vector<u64>(B));
+            std::vector<u64> ham(k * k, 0);
+            std::vector<double> dot(k * k, 0.0), sum(k, 0.0), sq(k, 0.0);
+            u64 n = 0;
+            for (; n < words; n += B) {
+                for (std::size_t i = 0; i < k; ++i)
+                    fill_words(streams[i], block[i].data(), B);
+                for (std::size_t t = 0; t < B; ++t) {
+                    double u[64];
+                    for (std::size_t i = 0; i < k; ++i) {
+                        u[i] = static_cast<double>(block[i][t] >> 11) * 0x1.0p-53 - 0.5;
+                        sum[i] += u[i];
+                        sq[i] += u[i] * u[i];
+                    }
+                    for (std::size_t i = 0; i < k; ++i)
+                        for (std::size_t j = i + 1; j < k; ++j) {
+                            ham[i * k + j] += static_cast<u64>(std::popcount(block[i][t] ^ block[j][t]));
+                            dot[i * k + j] += u[i] * u[j];
+                        }
+                }
+            }
+            const double N = static_cast<double>(n);
+            double chi2 = 0.0, dof = 0.0;
+            for (std::size_t i = 0; i < k; ++i)
+                for (std::size_t j = i + 1; j < k; ++j) {
+                    const double bits = 64.0 * N;
+                    const double zh = (static_cast<double>(ham[i * k + j]) - 0.5 * bits) / std::sqrt(0.25 * bits);
+                    const double cov = dot[i * k + j] / N - (sum[i] / N) * (sum[j] / N);
+                    const double vi = sq[i] / N - (sum[i] / N) * (sum[i] / N);
+                    const double vj = sq[j] / N - (sum[j] / N) * (sum[j] / N);
+                    const double zc = cov / std::sqrt(vi * vj) * std::sqrt(N);
+                    chi2 += zh * zh + zc * zc;
+                    dof += 2.0;
+                }
+            return math::chi2_sf(chi2, dof);
+        }
+
+    } // namespace tests
+
+    // -----------------------------------------------------------------
+    // Runner
+    // -----------------------------------------------------------------
+
+    template <class E>
+    report run(const config& cfg)
+    {
+        const unsigned threads = std::max(1u, cfg.threads);
+        const unsigned reps = cfg.replicates ? cfg.replicates : std::max(4u, threads);
+        auto size = [&](double n) { return static_cast<u64>(std::max(1.0, n * cfg.scale)); };
+
+        constexpr std::size_t STREAMS = 8; // for the inter-stream tests
+
+        using single_fn = std::function<double(tests::reader<E>&)>;
+        struct test_def {
+            std::string name;
+            single_fn single;          // one-stream tests
+            bool jump_streams = false; // inter-stream: jump() rather than split seeds
+        };
+
+        const u64 big = size(0x1p24), mid = size(0x1p22), small = size(0x1p19);
+        std::vector<test_def> defs = {
+            { "monobit",           [=](auto& r) { return tests::monobit(r, big); } },
+            { "byte_frequency",    [=](auto& r) { return tests::byte_frequency(r, big); } },
+            { "gap(hi)",           [=](auto& r) { return tests::gap(r, big, 60); } },
+            { "gap(lo)",           [=](auto& r) { return tests::gap(r, big, 0); } },
+            { "birthday(hi)",      [=](auto& r) { return tests::birthday(r, mid, 32); } },
+            { "birthday(lo)",      [=](auto& r) { return tests::birthday(r, mid, 0); } },
+            { "matrix_rank",       [=](auto& r) { return tests::matrix_rank(r, mid); } },
+            { "linear_complexity", [=](auto& r) { return tests::linear_complexity(r, small); } },
+            { "fft",               [](auto& r) { return tests::spectral(r); } },
+        };
+        if constexpr (requires(E & e) { e.jump(); })
+            defs.push_back({ "interstream(jump)", nullptr, true });
+        defs.push_back({ "interstream(split)", nullptr, false });
+
+        report out;
+        out.tests.resize(defs.size());
+        for (std::size_t t = 0; t < defs.size(); ++t) {
+            out.tests[t].name = defs[t].name;
+            out.tests[t].p.assign(reps, 1.0);
+        }
+
+        // One task per (test, replicate). Each task gets its own base seed from
+        // a SplitMix64 sequence over cfg.seed, so no two tasks share a stream.
+        const std::size_t tasks = defs.size() * reps;
+        std::atomic<std::size_t> next{ 0 };
+        std::atomic<u64> consumed{ 0 };
+
+        auto worker = [&] {
+            for (std::size_t task; (task = next.fetch_add(1)) < tasks;) {
+                const std::size_t t = task / reps, rep = task % reps;
+                const test_def& def = defs[t];
+                const u64 base = SplitMix64(cfg.seed).discard(task)();
+
+                double p;
+                if (def.single) {
+                    E e(base);
+                    tests::reader<E> r(e);
+                    p = def.single(r);
+                    consumed += r.consumed();
+                }
+                else {
+                    std::vector<E> streams;
+                    SplitMix64 split(base);
+                    for (std::size_t i = 0; i < STREAMS; ++i)
+                        streams.push_back(def.jump_streams ? make_stream<E>(base, i) : E(split()));
+                    p = tests::interstream(streams, mid);
+                    consumed += STREAMS * mid;
+                }
+                out.tests[t].p[rep] = p;
+            }
+        };
+
+        const auto t0 = std::chrono::steady_clock::now();
+        std::vector<std::thread> pool;
+        for (unsigned i = 1; i < threads; ++i)
+            pool.emplace_back(worker);
+        worker();
+        for (auto& th : pool)
+            th.join();
+        out.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count();
+        out.words = consumed;
+
+        for (test_result& t : out.tests) {
+            std::vector<double> q(t.p.size());
+            std::transform(t.p.begin(), t.p.end(), q.begin(), [](double p) { return 1.0 - p; });
+            t.p_combined = std::min(1.0, 2.0 * std::min(math::fisher(t.p), math::fisher(q)));
+            t.outcome = t.p_combined < 1e-8 ? verdict::fail
+                : t.p_combined < 1e-4 ? verdict::suspicious : verdict::pass;
+        }
+        return out;
+    }
+
+    inline void print(const report& r, std::ostream& os)
+    {
+        for (const test_result& t : r.tests) {
+            const double lo = *std::min_element(t.p.begin(), t.p.end());
+            const double hi = *std::max_element(t.p.begin(), t.p.end());
+            os << std::left << std::setw(20) << t.name << std::right
+                << "  streams " << std::setw(3) << t.p.size()
+                << "  p in [" << std::setprecision(3) << std::scientific << lo << ", " << hi << "]"
+                << "  combined " << t.p_combined << std::defaultfloat << "  "
+                << (t.outcome == verdict::fail ? "FAIL" : t.outcome == verdict::suspicious ? "suspicious" : "pass")
+                << '\n';
+        }
+        os << std::fixed << std::setprecision(2) << static_cast<double>(r.words) * 8.0 / 0x1p30 << " GiB in "
+            << r.seconds << " s (" << static_cast<double>(r.words) * 8.0 / 0x1p30 / r.seconds << " GiB/s)  "
+            << (r.passed() ? "PASSED" : "FAILED") << std::defaultfloat << '\n';
+    }
+
+} // namespace RNG::battery
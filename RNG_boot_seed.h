@@ -0,0 +1,210 @@
+#pragma once
+// file RNG_boot_seed.h
+//
+// Seeding that does not wait for the kernel's generator in early boot.
+//
+// RNG_platform::get_entropy() (and so random_device and the default
+// constructors of the engines) blocks in getrandom() until the kernel's
+// generator is initialized, which on a fresh VM can take seconds. Services
+// that start that early can use
+//
+//      RNG::boot_seeded<RNG::Nasam1024> rng;     // never blocks
+//
+// It is seeded from platform entropy when that is available without waiting,
+// and otherwise from a provisional seed (clocks, the kernel's per-process
+// AT_RANDOM bytes, ids, addresses: unique but NOT unpredictable). In that
+// case a background thread waits for the kernel, and the engine reseeds
+// itself from platform entropy on its first use after that, in its own
+// thread. The output before the reseed is only as good as the provisional
+// seed: do not use it where unpredictability matters.
+//
+// boot_seeded<E> is an engine (operator(), bulk() when E has it,
+// for_each_block(), and the engine_base API); E needs E() and E(u64).
+//
+// Other state can be reseeded with on_strong_entropy(f): f runs once, on the
+// waiting thread, when platform entropy is ready (or at once if it already
+// is), and must do its own synchronization.
+
+#define NOMINMAX
+#include <atomic>
+#include <cstddef>
+#include <exception>
+#include <functional>
+#include <limits>
+#include <mutex>
+#include <span>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "common.h"
+#include "RNG_engine.h"
+
+namespace RNG_platform {
+    // Defined in platform_entropy.cpp, next to get_entropy()
+    bool try_get_entropy(unsigned char* buffer, std::size_t size);
+    void get_provisional_entropy(unsigned char* buffer, std::size_t size);
+}
+
+namespace RNG {
+
+    namespace boot_seed_detail {
+
+        struct state {
+            std::atomic<bool> strong{ false };
+            std::once_flag waiter;
+            std::mutex mutex;
+            std::vector<std::function<void()>> callbacks;
+
+            // Leaked: the detached waiter thread may still be running at exit
+            static state& instance()
+            {
+                static state& s = *new state;
+                return s;
+            }
+
+            void ready()
+            {
+                std::vector<std::function<void()>> run;
+                {
+                    std::lock_guard<std::mutex> lock(mutex);
+                    strong.store(true, std::memory_order_release);
+                    run.swap(callbacks);
+                }
+                for (auto& f : run)
+                    f();
+            }
+        };
+
+        // One detached thread, blocked in get_entropy() until the kernel is ready
+        inline void start_waiter()
+        {
+            state& s = state::instance();
+            std::call_once(s.waiter, [&s] {
+                std::thread([&s] {
+                    try {
+                        unsigned char b;
+                        RNG_platform::get_entropy(&b, 1);
+                        s.ready();
+                    }
+                    catch (...) {
+                        // no platform entropy: boot_seeded engines keep their provisional seed
+                    }
+                }).detach();
+            });
+        }
+
+    } // namespace boot_seed_detail
+
+    // True once platform entropy has been obtained without blocking, by
+    // boot_entropy() or the waiting thread
+    inline bool strong_entropy_available() noexcept
+    {
+        return boot_seed_detail::state::instance().strong.load(std::memory_order_acquire);
+    }
+
+    // Fill 'data' without blocking: platform entropy if the kernel is ready
+    // (returns true), a provisional seed otherwise (returns false; the
+    // waiting thread is started)
+    inline bool boot_entropy(std::span<std::byte> data)
+    {
+        auto* p = reinterpret_cast<unsigned char*>(data.data());
+        auto& s = boot_seed_detail::state::instance();
+        if (s.strong.load(std::memory_order_acquire)) {
+            RNG_platform::get_entropy(p, data.size());  // no longer blocks
+            return true;
+        }
+        if (!data.empty() && RNG_platform::try_get_entropy(p, data.size())) {
+            s.ready();
+            return true;
+        }
+        RNG_platform::get_provisional_entropy(p, data.size());
+        boot_seed_detail::start_waiter();
+        return false;
+    }
+
+    // Run f once platform entropy is available: now, in this thread, if it
+    // already is, otherwise later on the waiting thread
+    inline void on_strong_entropy(std::function<void()> f)
+    {
+        auto& s = boot_seed_detail::state::instance();
+        {
+            std::lock_guard<std::mutex> lock(s.mutex);
+            if (!s.strong.load(std::memory_order_relaxed)) {
+                s.callbacks.push_back(std::move(f));
+                boot_seed_detail::start_waiter();
+                return;
+            }
+        }
+        f();
+    }
+
+    template <class E>
+    class boot_seeded : public engine_base<boot_seeded<E>> {
+        bool provisional_;
+        E engine_;
+
+        static E make(bool& provisional)
+        {
+            u64 seed;
+            provisional = !boot_entropy(std::as_writable_bytes(std::span(&seed, 1)));
+            return provisional ? E(seed) : E();
+        }
+
+        // One branch on a member once strong; before that an atomic load per call
+        void refresh()
+        {
+            if (provisional_) [[unlikely]] {
+                if (strong_entropy_available()) {
+                    engine_ = E();  // platform entropy, no longer blocks
+                    provisional_ = false;
+                }
+            }
+        }
+
+    public:
+        using result_type = u64;
+
+        boot_seeded() : engine_(make(provisional_)) {}
+
+        // Still running on the provisional seed
+        bool provisional() const noexcept { return provisional_; }
+
+        // The engine, after any pending reseed
+        E& engine()
+        {
+            refresh();
+            return engine_;
+        }
+
+        u64 operator()()
+        {
+            refresh();
+            return engine_();
+        }
+
+        void bulk(u8* data, std::size_t size) requires requires(E & e, u8 * p, std::size_t n) { e.bulk(p, n); }
+        {
+            refresh();
+            engine_.bulk(data, size);
+        }
+
+        template <class F>
+        void for_each_block(u64 n, F&& f)
+        {
+            refresh();
+            RNG::for_each_block(engine_, n, std::forward<F>(f));
+        }
+
+        template <class F>
+        void generate_n(u64 n, F&& f)
+        {
+            refresh();
+            RNG::generate_n(engine_, n, std::forward<F>(f));
+        }
+
+        static constexpr result_type min() noexcept { return 0; }
+        static constexpr result_type max() noexcept { return std::numeric_limits<result_type>::max(); }
+    };
+
+} // namespace RNG
@@ -0,0 +1,188 @@
+#pragma once
+// file RNG_bootstrap.h
+//
+// Poisson bootstrap weights: replicate b weighs row r by w ~ Poisson(1),
+// which approximates resampling n rows with replacement without knowing n,
+// so a table can be streamed through in chunks and B replicates computed in
+// one pass.
+//
+//      RNG::poisson_bootstrap<RNG::fast> boot(seed, B);
+//      std::vector<std::uint8_t> w(B * chunk_rows);
+//      for (each chunk of rows) {
+//          boot.fill(w);                   // w[b * chunk_rows + r]
+//          ... statistic of replicate b: rows weighted by w[b * chunk_rows + r]
+//      }
+//
+// Replicate b draws from its own stream, make_stream<E>(seed, b), so the
+// weights are the same whatever the number of threads (fill() splits the
+// replicates between them) and however the rows are split into calls.
+//
+// Inversion with a table for lambda = 1: a 16-bit field u of engine output
+// is compared with the cumulative probabilities P(w <= k), k = 0..6, four
+// draws per output, 16 per step with AVX2. The thresholds are kept to 32
+// bits: for the 8 values of u (1 in 8192) in which one of them falls, 16 more
+// bits come from hash64 of the row in the replicate, so that P(w = k) is the
+// Poisson probability to within 2^-32, up to w = 12.
+
+#define NOMINMAX
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+#include "common.h"
+#include "RNG_engine.h"
+#include "RNG_hash.h"
+#include "RNG_parallel.h"
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#endif
+
+namespace RNG {
+
+    namespace bootstrap_detail {
+
+        // round(2^32 * P(w <= k)) for w ~ Poisson(1), k = 0..11 (P(w <= 12)
+        // rounds to 2^32)
+        inline constexpr std::array<u32, 12> CDF = {
+            0x5e2d58d9, 0xbc5ab1b1, 0xeb715e1e, 0xfb239797, 0xff1025f6, 0xffd90f3c,
+            0xfffa8b72, 0xffff540c, 0xffffed1f, 0xfffffe21, 0xffffffd5, 0xfffffffc };
+
+        // The 16-bit values holding a threshold: the first 7, then k = 7..11
+        // all fall in 0xffff
+        inline constexpr std::size_t CELLS = 7;
+        inline constexpr std::array<u16, CELLS> CELL = {
+            0x5e2d, 0xbc5a, 0xeb71, 0xfb23, 0xff10, 0xffd9, 0xfffa };
+        inline constexpr u16 TAIL = 0xffff;
+
+        inline constexpr std::size_t CHUNK = 512;   // engine outputs per block
+
+        // The weight from u and 16 more bits
+        inline u8 refine(u16 u, u64 row, u64 key) noexcept
+        {
+            const u32 x = (u32(u) << 16) | static_cast<u32>(hash64(row, key) >> 48);
+            u8 w = 0;
+            for (u32 c : CDF) w += x >= c;
+            return w;
+        }
+
+        inline u8 weight(u16 u, u64 row, u64 key) noexcept
+        {
+            u8 w = 0;
+            for (u16 c : CELL) w += u > c;
+            // u can only equal the first cell above it
+            const bool edge = w < CELLS ? u == CELL[w] : u == TAIL;
+            return edge ? refine(u, row, key) : w;
+        }
+
+        // Field j of words: bits 16 (j % 4) and up of words[j / 4]
+        inline u16 field(const u64* words, std::size_t j) noexcept { return static_cast<u16>(words[j >> 2] >> (16 * (j & 3))); }
+
+        // out[i] for the 16-bit fields of words[0 .. n), in order, for rows
+        // from 'row'
+        inline void weights(const u64* words, std::size_t n, u8* out, u64 row, u64 key) noexcept
+        {
+            std::size_t i = 0;
+#if defined(__AVX2__)
+            const __m256i flip = _mm256_set1_epi16(static_cast<short>(0x8000));
+            const auto count = [&](__m256i u, __m256i& edge) noexcept {
+                const __m256i s = _mm256_xor_si256(u, flip);   // unsigned order as signed
+                __m256i w = _mm256_setzero_si256();
+                edge = _mm256_cmpeq_epi16(u, _mm256_set1_epi16(static_cast<short>(TAIL)));
+                for (u16 c : CELL) {
+                    w = _mm256_sub_epi16(w, _mm256_cmpgt_epi16(s, _mm256_set1_epi16(static_cast<short>(c ^ 0x8000))));
+                    edge = _mm256_or_si256(edge, _mm256_cmpeq_epi16(u, _mm256_set1_epi16(static_cast<short>(c))));
+                }
+                return w;
+            };
+            for (; i + 8 <= n; i += 8) {
+                __m256i ea, eb;
+                const __m256i a = count(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(words + i)), ea);
+                const __m256i b = count(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(words + i + 4)), eb);
+                u8* o = out + 4 * i;
+                _mm256_storeu_si256(reinterpret_cast<__m256i*>(o), _mm256_permute4x64_epi64(_mm256_packus_epi16(a, b), 0xd8));
+                if (!_mm256_testz_si256(_mm256_or_si256(ea, eb), _mm256_or_si256(ea, eb))) {
+                    for (std::size_t j = 0; j < 32; ++j)
+                        o[j] = weight(field(words + i, j), row + 4 * i + j, key);
+                }
+            }
+#endif
+            for (std::size_t j = 4 * i; j < 4 * n; ++j)
+                out[j] = weight(field(words, j), row + j, key);
+        }
+
+    } // namespace bootstrap_detail
+
+    template <engine E>
+    class poisson_bootstrap {
+        // A replicate's stream, with the fields of its last output not yet used
+        struct replicate {
+            E engine;
+            u64 key;          // hash64 key of the refinements
+            u64 word = 0;
+            unsigned left = 0;
+        };
+
+        std::vector<replicate> reps_;
+        u64 rows_ = 0;
+
+        void fill_one(replicate& rep, u8* out, std::size_t n)
+        {
+            using namespace bootstrap_detail;
+            std::size_t r = 0;
+            for (; rep.left && r < n; ++r, --rep.left)
+                out[r] = weight(field(&rep.word, 4 - rep.left), rows_ + r, rep.key);
+
+            std::array<u64, CHUNK> words;
+            while (n - r >= 4) {
+                const std::size_t k = std::min(CHUNK, (n - r) / 4);
+                fill_words(rep.engine, words.data(), k);
+                weights(words.data(), k, out + r, rows_ + r, rep.key);
+                r += 4 * k;
+            }
+
+            if (r < n) {
+                rep.word = rep.engine();
+                for (rep.left = 4; r < n; ++r, --rep.left)
+                    out[r] = weight(field(&rep.word, 4 - rep.left), rows_ + r, rep.key);
+            }
+        }
+
+    public:
+        poisson_bootstrap(u64 seed, std::size_t replicates)
+        {
+            if (replicates == 0) throw std::invalid_argument("poisson_bootstrap: no replicates");
+            reps_.reserve(replicates);
+            for (std::size_t b = 0; b < replicates; ++b)
+                reps_.push_back({ make_stream<E>(seed, b), hash64(b, seed) });
+        }
+
+        std::size_t replicates() const noexcept { return reps_.size(); }
+
+        // Rows weighed so far, in every replicate
+        u64 rows() const noexcept { return rows_; }
+
+        // The weights of the next weights.size() / replicates() rows:
+        // weights[b * rows + r] for replicate b
+        void fill(std::span<u8> weights, unsigned threads = std::max(1u, std::thread::hardware_concurrency()))
+        {
+            const std::size_t B = reps_.size();
+            if (weights.size() % B != 0)
+                throw std::invalid_argument("poisson_bootstrap::fill: size is not a multiple of the replicates");
+            const std::size_t n = weights.size() / B;
+            // below about 64K draws a thread costs more than it saves
+            const unsigned t = static_cast<unsigned>(std::min<std::size_t>(threads, std::max<std::size_t>(1, weights.size() >> 16)));
+            parallel_detail::parallel_ranges(B, t, [&](std::size_t begin, std::size_t end) {
+                for (std::size_t b = begin; b < end; ++b)
+                    fill_one(reps_[b], weights.data() + b * n, n);
+            });
+            rows_ += n;
+        }
+    };
+
+} // namespace RNG
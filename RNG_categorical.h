@@ -0,0 +1,453 @@
+#pragma once
+// file RNG_categorical.h
+//
+// Sampling an index from unnormalized log-probabilities (logits), as a
+// language model samples its next token, without computing the softmax:
+// Gumbel-max, argmax over i of logits[i] + T * g_i with g_i = -ln(-ln u_i),
+// picks i with probability softmax(logits / T)[i].
+//
+//      sample_logits(logits, engine, T)            one sample
+//      sample_logits(logits, vocab, out, engine, T)
+//                                                  one per row of a batch
+//      sample_logits_top_k(logits, k, engine, T)   among the k largest logits
+//      sample_logits_top_p(logits, p, engine, T)   among the fewest largest
+//                                                  logits with probability >= p
+//
+// T = 0 takes the argmax, and so does a temperature so small that 1 / T
+// overflows. Each element takes 32 bits of engine output, through
+// fill_words() in blocks; ln and exp are branchless approximations (errors of
+// a few 1e-6), and the passes run 8 elements per step with AVX2, with the
+// same samples as the scalar code. Ties go to the lowest index. +infinity
+// logits, when there are any, take all the probability: one of them is
+// sampled uniformly (at T > 0). NaN logits are never sampled; a row with no
+// logit above -infinity throws std::invalid_argument.
+//
+// top_k keeps a heap of the k best while scanning the logits (or partially
+// sorts a copy, for k large against their number). top_p sums the
+// probabilities (with a polynomial exp) by buckets of 1/8 in log-probability,
+// which tells the bucket where the nucleus ends: only that one is sorted.
+//
+//      const std::size_t token = RNG::sample_logits_top_p(logits, 0.9f, rng, 0.7f);
+
+#define NOMINMAX
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <span>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+#include "common.h"
+#include "RNG_engine.h"
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#endif
+
+namespace RNG {
+
+    namespace categorical_detail {
+
+        inline constexpr std::size_t CHUNK = 1024;  // elements per block of engine output
+        inline constexpr float LN2 = 0.693147180559945309f;
+        inline constexpr float LOG2E = 1.44269504088896341f;
+        inline constexpr float NEG_INF = -std::numeric_limits<float>::infinity();
+        inline constexpr float INF = std::numeric_limits<float>::infinity();
+        inline constexpr std::size_t NPOS = static_cast<std::size_t>(-1);
+
+        // (0, 1), symmetric: odd multiples of 2^-24
+        inline float uniform(u32 x) noexcept { return static_cast<float>(((x >> 9) << 1) | 1) * 0x1.0p-24f; }
+
+        // ln x for normal x > 0: x = 2^e * m with m in [sqrt(1/2), sqrt(2)),
+        // ln m = 2 atanh(s), s = (m - 1) / (m + 1), |s| < 0.172, to s^9
+        inline float fast_ln(float x) noexcept
+        {
+            const std::int32_t b = std::bit_cast<std::int32_t>(x);
+            const std::int32_t e = (b - 0x3f3504f3) >> 23;
+            const float m = std::bit_cast<float>(b - (e << 23));
+            const float s = (m - 1.0f) / (m + 1.0f);
+            const float s2 = s * s;
+            const float p = (((s2 * (1.0f / 9) + 1.0f / 7) * s2 + 1.0f / 5) * s2 + 1.0f / 3) * s2 + 1.0f;
+            return static_cast<float>(e) * LN2 + (s + s) * p;
+        }
+
+        inline float gumbel(u32 x) noexcept { return -fast_ln(-fast_ln(uniform(x))); }
+
+        // Element j's 32 bits: the low, then the high half of words[j / 2]
+        inline u32 bits_of(const u64* words, std::size_t j) noexcept { return static_cast<u32>(words[j >> 1] >> (32 * (j & 1))); }
+
+        // e^x for x <= 0, 0 below -87 (and for NaN): 2^n * 2^f, |f| <= 1/2,
+        // 2^f by its Taylor series to the 6th power
+        inline float fast_exp(float x) noexcept
+        {
+            if (!(x >= -87.0f)) return 0.0f;
+            const float t = x * LOG2E;
+            const float n = (t + 0x1.8p23f) - 0x1.8p23f;   // round to nearest, |t| < 2^22
+            const float f = (t - n) * LN2;
+            const float p = (((((f * (1.0f / 720) + 1.0f / 120) * f + 1.0f / 24) * f + 1.0f / 6) * f + 0.5f) * f + 1.0f) * f + 1.0f;
+            return std::bit_cast<float>(std::bit_cast<std::int32_t>(p) + (static_cast<std::int32_t>(n) << 23));
+        }
+
+#if defined(__AVX2__)
+        inline __m256 uniform8(__m256i x) noexcept
+        {
+            const __m256i odd = _mm256_or_si256(_mm256_slli_epi32(_mm256_srli_epi32(x, 9), 1), _mm256_set1_epi32(1));
+            return _mm256_mul_ps(_mm256_cvtepi32_ps(odd), _mm256_set1_ps(0x1.0p-24f));
+        }
+
+        inline __m256 fast_ln8(__m256 x) noexcept
+        {
+            const __m256 one = _mm256_set1_ps(1.0f);
+            const __m256i b = _mm256_castps_si256(x);
+            const __m256i e = _mm256_srai_epi32(_mm256_sub_epi32(b, _mm256_set1_epi32(0x3f3504f3)), 23);
+            const __m256 m = _mm256_castsi256_ps(_mm256_sub_epi32(b, _mm256_slli_epi32(e, 23)));
+            const __m256 s = _mm256_div_ps(_mm256_sub_ps(m, one), _mm256_add_ps(m, one));
+            const __m256 s2 = _mm256_mul_ps(s, s);
+            __m256 p = _mm256_add_ps(_mm256_mul_ps(s2, _mm256_set1_ps(1.0f / 9)), _mm256_set1_ps(1.0f / 7));
+            p = _mm256_add_ps(_mm256_mul_ps(p, s2), _mm256_set1_ps(1.0f / 5));
+            p = _mm256_add_ps(_mm256_mul_ps(p, s2), _mm256_set1_ps(1.0f / 3));
+            p = _mm256_add_ps(_mm256_mul_ps(p, s2), one);
+            return _mm256_add_ps(_mm256_mul_ps(_mm256_cvtepi32_ps(e), _mm256_set1_ps(LN2)), _mm256_mul_ps(_mm256_add_ps(s, s), p));
+        }
+
+        inline __m256 gumbel8(__m256i x) noexcept
+        {
+            const __m256 zero = _mm256_setzero_ps();
+            return _mm256_sub_ps(zero, fast_ln8(_mm256_sub_ps(zero, fast_ln8(uniform8(x)))));
+        }
+
+        inline __m256 fast_exp8(__m256 x) noexcept
+        {
+            const __m256 in_range = _mm256_cmp_ps(x, _mm256_set1_ps(-87.0f), _CMP_GE_OQ);
+            const __m256 t = _mm256_mul_ps(x, _mm256_set1_ps(LOG2E));
+            const __m256 n = _mm256_sub_ps(_mm256_add_ps(t, _mm256_set1_ps(0x1.8p23f)), _mm256_set1_ps(0x1.8p23f));
+            const __m256 f = _mm256_mul_ps(_mm256_sub_ps(t, n), _mm256_set1_ps(LN2));
+            __m256 p = _mm256_add_ps(_mm256_mul_ps(f, _mm256_set1_ps(1.0f / 720)), _mm256_set1_ps(1.0f / 120));
+            p = _mm256_add_ps(_mm256_mul_ps(p, f), _mm256_set1_ps(1.0f / 24));
+            p = _mm256_add_ps(_mm256_mul_ps(p, f), _mm256_set1_ps(1.0f / 6));
+            p = _mm256_add_ps(_mm256_mul_ps(p, f), _mm256_set1_ps(0.5f));
+            p = _mm256_add_ps(_mm256_mul_ps(p, f), _mm256_set1_ps(1.0f));
+            p = _mm256_add_ps(_mm256_mul_ps(p, f), _mm256_set1_ps(1.0f));
+            const __m256i r = _mm256_add_epi32(_mm256_castps_si256(p), _mm256_slli_epi32(_mm256_cvttps_epi32(n), 23));
+            return _mm256_and_ps(_mm256_castsi256_ps(r), in_range);
+        }
+#endif
+
+        inline void check_temperature(float temperature)
+        {
+            if (!(temperature >= 0.0f) || !std::isfinite(temperature))
+                throw std::invalid_argument("sample_logits: temperature must be finite and non-negative");
+        }
+
+        // Index of the largest logit (the first of equal ones), npos if none is above -inf
+        inline std::size_t argmax(std::span<const float> logits) noexcept
+        {
+            std::size_t best = NPOS;
+            float top = NEG_INF;
+            for (std::size_t i = 0; i < logits.size(); ++i)
+                if (logits[i] > top) { top = logits[i]; best = i; }
+            return best;
+        }
+
+        inline float max_logit(std::span<const float> logits) noexcept
+        {
+            const float* x = logits.data();
+            const std::size_t n = logits.size();
+            float top = NEG_INF;
+            std::size_t i = 0;
+#if defined(__AVX2__)
+            __m256 m = _mm256_set1_ps(NEG_INF);
+            for (; i + 8 <= n; i += 8)
+                m = _mm256_max_ps(_mm256_loadu_ps(x + i), m);   // NaN in x keeps m
+            alignas(32) float lanes[8];
+            _mm256_store_ps(lanes, m);
+            for (float v : lanes) top = std::max(top, v);
+#endif
+            for (; i < n; ++i)
+                if (x[i] > top) top = x[i];
+            return top;
+        }
+
+        // Top-p weighs the logits in buckets of 1/8 in log-probability below
+        // the largest, down to e^-87
+        inline constexpr std::size_t BUCKETS = 87 * 8 + 1;
+
+        // mass[b] = sum of e^-q over the logits with q = (top - logit) / T in
+        // [b/8, (b+1)/8); the weights 8 at a time with AVX2
+        inline void bucket_masses(std::span<const float> logits, float top, float inv_t, std::array<double, BUCKETS>& mass) noexcept
+        {
+            const float* x = logits.data();
+            const std::size_t n = logits.size();
+            std::size_t i = 0;
+#if defined(__AVX2__)
+            const __m256 m = _mm256_set1_ps(top), s = _mm256_set1_ps(inv_t);
+            alignas(32) float q[8], w[8];
+            for (; i + 8 <= n; i += 8) {
+                const __m256 vq = _mm256_mul_ps(_mm256_sub_ps(m, _mm256_loadu_ps(x + i)), s);
+                _mm256_store_ps(q, vq);
+                _mm256_store_ps(w, fast_exp8(_mm256_sub_ps(_mm256_setzero_ps(), vq)));
+                for (std::size_t l = 0; l < 8; ++l)
+                    if (q[l] <= 87.0f) mass[static_cast<std::size_t>(q[l] * 8.0f)] += w[l];
+            }
+#endif
+            for (; i < n; ++i) {
+                const float q = (top - x[i]) * inv_t;
+                if (q <= 87.0f) mass[static_cast<std::size_t>(q * 8.0f)] += fast_exp(-q);
+            }
+        }
+
+        // Gumbel-max over one row: the first index of the largest
+        // logit + T * gumbel, npos if none is above -inf
+        template <engine E>
+        std::size_t gumbel_argmax(std::span<const float> logits, E& e, float temperature)
+        {
+            const float* x = logits.data();
+            const std::size_t n = logits.size();
+            std::array<u64, CHUNK / 2> words;
+            std::size_t best = NPOS;
+            float top = NEG_INF;
+            for (std::size_t i = 0; i < n; i += CHUNK) {
+                const std::size_t m = std::min(CHUNK, n - i);
+                fill_words(e, words.data(), (m + 1) / 2);
+                std::size_t j = 0;
+#if defined(__AVX2__)
+                const __m256 t = _mm256_set1_ps(temperature);
+                __m256 vtop = _mm256_set1_ps(NEG_INF);
+                __m256i vbest = _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7);
+                __m256i idx = vbest;
+                for (; j + 8 <= m; j += 8) {
+                    const __m256 g = gumbel8(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(words.data() + j / 2)));
+                    const __m256 s = _mm256_add_ps(_mm256_loadu_ps(x + i + j), _mm256_mul_ps(t, g));
+                    const __m256 gt = _mm256_cmp_ps(s, vtop, _CMP_GT_OQ);
+                    vtop = _mm256_blendv_ps(vtop, s, gt);
+                    vbest = _mm256_blendv_epi8(vbest, idx, _mm256_castps_si256(gt));
+                    idx = _mm256_add_epi32(idx, _mm256_set1_epi32(8));
+                }
+                alignas(32) float tops[8];
+                alignas(32) std::int32_t bests[8];
+                _mm256_store_ps(tops, vtop);
+                _mm256_store_si256(reinterpret_cast<__m256i*>(bests), vbest);
+                // lane order is not index order: the largest, then the lowest index
+                float ctop = NEG_INF;
+                std::size_t cbest = 0;
+                for (std::size_t l = 0; l < 8; ++l)
+                    if (tops[l] > ctop || (tops[l] == ctop && static_cast<std::size_t>(bests[l]) < cbest)) {
+                        ctop = tops[l];
+                        cbest = static_cast<std::size_t>(bests[l]);
+                    }
+                if (ctop > top) { top = ctop; best = i + cbest; }
+#endif
+                for (; j < m; ++j) {
+                    const float s = x[i + j] + temperature * gumbel(bits_of(words.data(), j));
+                    if (s > top) { top = s; best = i + j; }
+                }
+            }
+            return best;
+        }
+
+        using scored = std::pair<float, u32>;   // logit, index
+
+        // Larger logit, then lower index
+        inline bool better(const scored& a, const scored& b) noexcept
+        {
+            return a.first > b.first || (a.first == b.first && a.second < b.second);
+        }
+
+        // All logits but the NaNs, unordered
+        inline std::vector<scored> candidates(std::span<const float> logits)
+        {
+            std::vector<scored> all;
+            all.reserve(logits.size());
+            for (std::size_t i = 0; i < logits.size(); ++i)
+                if (logits[i] == logits[i]) all.push_back({ logits[i], static_cast<u32>(i) });
+            return all;
+        }
+
+        // The k largest logits, best first. A heap of k while scanning when
+        // k is small against the logits, a partial sort of a copy otherwise
+        inline std::vector<scored> largest(std::span<const float> logits, std::size_t k)
+        {
+            if (k * 16 >= logits.size()) {
+                std::vector<scored> all = candidates(logits);
+                k = std::min(k, all.size());
+                if (k < all.size())
+                    std::nth_element(all.begin(), all.begin() + static_cast<std::ptrdiff_t>(k), all.end(), better);
+                all.resize(k);
+                std::sort(all.begin(), all.end(), better);
+                return all;
+            }
+            std::vector<scored> heap;   // heap.front() is the worst kept
+            heap.reserve(k);
+            for (std::size_t i = 0; i < logits.size(); ++i) {
+                const float v = logits[i];
+                if (heap.size() == k) {
+                    if (!(v > heap.front().first)) continue;
+                    std::pop_heap(heap.begin(), heap.end(), better);
+                    heap.back() = { v, static_cast<u32>(i) };
+                }
+                else {
+                    if (v != v) continue;
+                    heap.push_back({ v, static_cast<u32>(i) });
+                }
+                std::push_heap(heap.begin(), heap.end(), better);
+            }
+            std::sort_heap(heap.begin(), heap.end(), better);
+            return heap;
+        }
+
+        inline std::size_t checked(std::size_t index)
+        {
+            if (index == NPOS)
+                throw std::invalid_argument("sample_logits: no logit above -infinity");
+            return index;
+        }
+
+        // Uniform in [0, count), count < 2^32, from the high half of an output
+        template <engine E>
+        std::size_t uniform_below(std::size_t count, E& e)
+        {
+            return static_cast<std::size_t>(((e() >> 32) * count) >> 32);
+        }
+
+        // The limit of softmax with +inf logits: one of them, uniformly
+        template <engine E>
+        std::size_t uniform_infinite(std::span<const float> logits, E& e)
+        {
+            std::size_t count = 0;
+            for (float v : logits) count += v == INF;
+            std::size_t r = uniform_below(count, e);
+            for (std::size_t i = 0;; ++i)
+                if (logits[i] == INF && r-- == 0) return i;
+        }
+
+        // Gumbel-max with T > 0, and the +inf logits sampled uniformly:
+        // gumbel_argmax() alone would always pick the first
+        template <engine E>
+        std::size_t gumbel_sample(std::span<const float> logits, E& e, float temperature)
+        {
+            const std::size_t i = gumbel_argmax(logits, e, temperature);
+            if (i != NPOS && logits[i] == INF) return uniform_infinite(logits, e);
+            return checked(i);
+        }
+
+        // Whether sampling at this temperature is the argmax: T = 0, or 1 / T
+        // overflows and every logit below the largest has probability 0
+        inline bool is_argmax(float temperature) noexcept
+        {
+            return temperature == 0.0f || !std::isfinite(1.0f / temperature);
+        }
+
+    } // namespace categorical_detail
+
+    // An index sampled with probability softmax(logits / temperature)
+    template <engine E>
+    std::size_t sample_logits(std::span<const float> logits, E& e, float temperature = 1.0f)
+    {
+        using namespace categorical_detail;
+        check_temperature(temperature);
+        if (is_argmax(temperature)) return checked(argmax(logits));
+        return gumbel_sample(logits, e, temperature);
+    }
+
+    // out[r] sampled from row r of a batch: logits.size() == vocab * out.size()
+    template <engine E>
+    void sample_logits(std::span<const float> logits, std::size_t vocab, std::span<std::size_t> out, E& e, float temperature = 1.0f)
+    {
+        if (logits.size() != vocab * out.size())
+            throw std::invalid_argument("sample_logits: logits are not out.size() rows of vocab");
+        for (std::size_t r = 0; r < out.size(); ++r)
+            out[r] = sample_logits(logits.subspan(r * vocab, vocab), e, temperature);
+    }
+
+    // Sampled among the k largest logits
+    template <engine E>
+    std::size_t sample_logits_top_k(std::span<const float> logits, std::size_t k, E& e, float temperature = 1.0f)
+    {
+        using namespace categorical_detail;
+        if (k == 0) throw std::invalid_argument("sample_logits_top_k: k must be positive");
+        check_temperature(temperature);
+        if (is_argmax(temperature)) return checked(argmax(logits));
+        if (k >= logits.size()) return gumbel_sample(logits, e, temperature);
+
+        const std::vector<scored> best = largest(logits, k);
+        if (!best.empty() && best.front().first == INF) {
+            // the +inf logits among the k, best first
+            std::size_t count = 0;
+            while (count < best.size() && best[count].first == INF) ++count;
+            return best[uniform_below(count, e)].second;
+        }
+        std::vector<u64> words((best.size() + 1) / 2);
+        fill_words(e, words.data(), words.size());
+        std::size_t pick = NPOS;
+        float top = NEG_INF;
+        for (std::size_t j = 0; j < best.size(); ++j) {
+            const float s = best[j].first + temperature * gumbel(bits_of(words.data(), j));
+            if (s > top) { top = s; pick = best[j].second; }
+        }
+        return checked(pick);
+    }
+
+    // Sampled among the smallest set of largest logits whose probabilities
+    // (at this temperature) add up to at least p
+    template <engine E>
+    std::size_t sample_logits_top_p(std::span<const float> logits, float p, E& e, float temperature = 1.0f)
+    {
+        using namespace categorical_detail;
+        if (!(p > 0.0f && p <= 1.0f)) throw std::invalid_argument("sample_logits_top_p: p must be in (0, 1]");
+        check_temperature(temperature);
+        if (is_argmax(temperature)) return checked(argmax(logits));
+        if (p == 1.0f) return gumbel_sample(logits, e, temperature);
+
+        const float top = max_logit(logits);
+        if (!(top > NEG_INF)) throw std::invalid_argument("sample_logits: no logit above -infinity");
+        if (top == INF) return uniform_infinite(logits, e);   // the whole mass
+        const float inv_t = 1.0f / temperature;   // finite, see is_argmax()
+        const auto weight = [&](const scored& c) noexcept { return fast_exp(-((top - c.first) * inv_t)); };
+
+        // The mass of each bucket; the nucleus takes the buckets from the top
+        // until the one where it reaches p
+        std::array<double, BUCKETS> mass{};
+        bucket_masses(logits, top, inv_t, mass);
+        double total = 0.0;
+        for (const double m : mass) total += m;
+        const double target = p * total;
+        std::size_t edge = 0;
+        double inner = 0.0;
+        while (edge + 1 < BUCKETS && inner + mass[edge] < target)
+            inner += mass[edge++];
+
+        // Only the edge bucket is sorted, for its largest logits up to p
+        std::vector<scored> members, boundary;
+        for (std::size_t i = 0; i < logits.size(); ++i) {
+            const float q = (top - logits[i]) * inv_t;
+            if (!(q <= 87.0f)) continue;
+            const std::size_t b = static_cast<std::size_t>(q * 8.0f);
+            if (b < edge) members.push_back({ logits[i], static_cast<u32>(i) });
+            else if (b == edge) boundary.push_back({ logits[i], static_cast<u32>(i) });
+        }
+        std::sort(boundary.begin(), boundary.end(), better);
+        std::size_t count = 0;
+        for (double sum = inner; count < boundary.size() && sum < target; ++count)
+            sum += weight(boundary[count]);
+        members.insert(members.end(), boundary.begin(), boundary.begin() + static_cast<std::ptrdiff_t>(count));
+
+        // The largest logit has weight 1 and is always in; kept as a guard
+        if (members.empty()) return checked(argmax(logits));
+
+        double nucleus = 0.0;
+        for (const scored& c : members) nucleus += weight(c);
+        const double u = static_cast<double>(e() >> 11) * 0x1.0p-53 * nucleus;
+        double sum = 0.0;
+        for (std::size_t j = 0; j + 1 < members.size(); ++j) {
+            sum += weight(members[j]);
+            if (u < sum) return members[j].second;
+        }
+        return members.back().second;
+    }
+
+} // namespace RNG
@@ -0,0 +1,177 @@
+#pragma once
+// file RNG_checkpoint.h
+//
+// Compact, versioned binary checkpoints of engines, one or millions at a time.
+//
+// Every engine provides
+//      CHECKPOINT_BYTES            size of its record
+//      checkpoint(u8* out) const   write the minimal state, position included
+//      restore(const u8* in)       continue exactly where checkpoint() was taken
+//
+//      engine      bytes   record
+//      SplitMix64  8       state
+//      wyrand      8       state
+//      fast        8       state of the next output (buffered values are recomputed)
+//      Nasam1024   129     1024-bit counter + buffer position (the increment is a constant)
+//
+// A restored engine produces the same stream the saved one would have.
+//
+// File format (little-endian)
+//      0       checkpoint_header (64 bytes)
+//      64      'count' records of 'record_bytes' bytes, packed
+//
+// Example
+//      std::vector<RNG::Nasam1024> agents = ...;           // 10^7 engines
+//      RNG::save_checkpoint("agents.ckpt", std::span<const RNG::Nasam1024>(agents));
+//      ...
+//      RNG::load_checkpoint("agents.ckpt", std::span<RNG::Nasam1024>(agents));
+//      auto again = RNG::load_checkpoint<RNG::Nasam1024>("agents.ckpt");
+//
+// Files are written and read through a memory mapping, the records split
+// between threads. Errors (I/O, wrong engine, version or count) throw
+// std::runtime_error.
+
+#define NOMINMAX
+#include <algorithm>
+#include <array>
+#include <cstdint>
+#include <cstring>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#include "common.h"
+#include "RNG_file.h"
+#include "RNG_parallel.h"
+
+namespace RNG {
+
+    inline constexpr std::uint32_t CHECKPOINT_VERSION = 1;
+
+    struct checkpoint_header {
+        char magic[8];              // "RNGCKPT\0"
+        std::uint32_t version;      // CHECKPOINT_VERSION
+        std::uint32_t record_bytes; // E::CHECKPOINT_BYTES
+        char engine[32];            // file_name<E>, '\0' padded
+        u64 count;                  // number of records
+        u64 reserved;
+    };
+    static_assert(sizeof(checkpoint_header) == 64, "checkpoint_header layout");
+
+    template <class E>
+    concept checkpointable = requires(const E & c, E & e, u8 * out, const u8 * in) {
+        { E::CHECKPOINT_BYTES } -> std::convertible_to<std::size_t>;
+        c.checkpoint(out);
+        e.restore(in);
+    };
+
+    // One engine to / from a record
+    template <checkpointable E>
+    std::array<u8, E::CHECKPOINT_BYTES> checkpoint(const E& e) noexcept
+    {
+        std::array<u8, E::CHECKPOINT_BYTES> out;
+        e.checkpoint(out.data());
+        return out;
+    }
+
+    template <checkpointable E>
+    void restore(E& e, const std::array<u8, E::CHECKPOINT_BYTES>& in) noexcept
+    {
+        e.restore(in.data());
+    }
+
+    namespace checkpoint_detail {
+
+        // Below this many engines a thread costs more than it saves
+        inline constexpr std::size_t MIN_PER_THREAD = 1 << 14;
+
+        template <class E>
+        checkpoint_header make_header(u64 count)
+        {
+            checkpoint_header h{};
+            std::memcpy(h.magic, "RNGCKPT", 8);
+            h.version = CHECKPOINT_VERSION;
+            h.record_bytes = static_cast<std::uint32_t>(E::CHECKPOINT_BYTES);
+            const std::string_view name = file_name<E>::value;
+            std::memcpy(h.engine, name.data(), std::min(name.size(), sizeof(h.engine) - 1));
+            h.count = count;
+            return h;
+        }
+
+        // Header of a mapped checkpoint file, checked against E
+        template <class E>
+        checkpoint_header read_header(const mapped_file& f, const std::string& path)
+        {
+            checkpoint_header h;
+            if (f.size() < sizeof(h))
+                throw std::runtime_error("checkpoint: " + path + " is too short");
+            std::memcpy(&h, f.data(), sizeof(h));
+            const checkpoint_header expected = make_header<E>(0);
+            if (std::memcmp(h.magic, expected.magic, sizeof(h.magic)) != 0)
+                throw std::runtime_error("checkpoint: " + path + " is not a checkpoint");
+            if (h.version != CHECKPOINT_VERSION)
+                throw std::runtime_error("checkpoint: " + path + " has unsupported version " + std::to_string(h.version));
+            if (std::memcmp(h.engine, expected.engine, sizeof(h.engine)) != 0 || h.record_bytes != expected.record_bytes)
+                throw std::runtime_error("checkpoint: " + path + " holds " + std::string(h.engine, strnlen(h.engine, sizeof(h.engine)))
+                    + " engines, not " + file_name<E>::value);
+            if (h.count > (f.size() - sizeof(h)) / E::CHECKPOINT_BYTES)
+                throw std::runtime_error("checkpoint: " + path + " is truncated");
+            return h;
+        }
+
+        template <class E>
+        void restore_all(const u8* records, std::span<E> engines, unsigned threads)
+        {
+            parallel_detail::parallel_ranges(engines.size(), threads, [&](std::size_t b, std::size_t e) {
+                for (std::size_t i = b; i < e; ++i)
+                    engines[i].restore(records + i * E::CHECKPOINT_BYTES);
+            }, MIN_PER_THREAD);
+        }
+
+    } // namespace checkpoint_detail
+
+    template <checkpointable E>
+    void save_checkpoint(const std::string& path, std::span<const E> engines,
+        unsigned threads = std::max(1u, std::thread::hardware_concurrency()))
+    {
+        constexpr std::size_t R = E::CHECKPOINT_BYTES;
+        mapped_file f(path, sizeof(checkpoint_header) + engines.size() * R);
+        const checkpoint_header h = checkpoint_detail::make_header<E>(engines.size());
+        std::memcpy(f.data(), &h, sizeof(h));
+        u8* records = f.data() + sizeof(h);
+        parallel_detail::parallel_ranges(engines.size(), threads, [&](std::size_t b, std::size_t e) {
+            for (std::size_t i = b; i < e; ++i)
+                engines[i].checkpoint(records + i * R);
+        }, checkpoint_detail::MIN_PER_THREAD);
+    }
+
+    // Restore into existing engines; the file must hold exactly engines.size() records
+    template <checkpointable E>
+    void load_checkpoint(const std::string& path, std::span<E> engines,
+        unsigned threads = std::max(1u, std::thread::hardware_concurrency()))
+    {
+        const mapped_file f(path);
+        const checkpoint_header h = checkpoint_detail::read_header<E>(f, path);
+        if (h.count != engines.size())
+            throw std::runtime_error("checkpoint: " + path + " holds " + std::to_string(h.count)
+                + " engines, expected " + std::to_string(engines.size()));
+        checkpoint_detail::restore_all(f.data() + sizeof(h), engines, threads);
+    }
+
+    // Restore into new engines. They are copies of E(0) before restore(), so
+    // no engine is seeded from platform entropy.
+    template <checkpointable E>
+    std::vector<E> load_checkpoint(const std::string& path,
+        unsigned threads = std::max(1u, std::thread::hardware_concurrency()))
+    {
+        const mapped_file f(path);
+        const checkpoint_header h = checkpoint_detail::read_header<E>(f, path);
+        std::vector<E> engines(static_cast<std::size_t>(h.count), E(0ull));
+        checkpoint_detail::restore_all(f.data() + sizeof(h), std::span<E>(engines), threads);
+        return engines;
+    }
+
+} // namespace RNG
@@ -0,0 +1,276 @@
+#pragma once
+// file RNG_dither.h
+//
+// Dither for quantizing audio and images: noise added before rounding makes
+// the quantization error independent of the signal, instead of distortion.
+// RNG::ditherer<E> generates it in bulk from engine E and quantizes float
+// buffers to int16 or int8 in the same pass, with AVX2 when compiled for it.
+//
+//      tpdf        triangular PDF: u1 - u2, from the two 32-bit halves of one
+//                  output; the usual dither for audio
+//      gaussian    approximately Gaussian: the sum of four 16-bit uniforms of
+//                  one output (bounded at about 3.5 sigma)
+//      highpass    u[n] - u[n-1]: triangular PDF with a first-order high-pass
+//                  spectrum, less audible, and finer-grained on images;
+//                  two samples per output, the last u is kept between calls
+//
+// amplitude scales the noise, in units of the last bit: TPDF and high-pass
+// dither are within +-amplitude, and all three have variance amplitude^2 / 6.
+//
+//      RNG::ditherer<RNG::fast> d(RNG::fast(seed));
+//      d.quantize(samples, pcm16);                 // round(x * 32767 + noise)
+//      d.quantize(pixels, bytes, 127.0f);
+//
+// quantize() rounds to nearest (even) and saturates; NaN becomes 0. The
+// results are the same with and without AVX2.
+
+#define NOMINMAX
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <span>
+#include <stdexcept>
+#include <utility>
+
+#include "common.h"
+#include "RNG_engine.h"
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#endif
+
+namespace RNG {
+
+    enum class dither_kind { tpdf, gaussian, highpass };
+
+    namespace dither_detail {
+
+        inline constexpr std::size_t CHUNK = 1024;  // samples per block of engine output
+        inline constexpr float U24 = 0x1.0p-24f;
+        inline constexpr float GAUSS = 0x1.0p-16f * 0.70710678118654752f;  // sum of four -> variance 1/6
+
+        inline float uniform(u32 x) noexcept { return static_cast<float>(x >> 8) * U24; }
+
+        // Sample j of a block, in units of the amplitude. 'last' is the
+        // high-pass filter's previous uniform.
+        template <dither_kind K>
+        inline float noise(const u64* words, std::size_t j, float& last) noexcept
+        {
+            if constexpr (K == dither_kind::tpdf) {
+                const u64 w = words[j];
+                return uniform(static_cast<u32>(w)) - uniform(static_cast<u32>(w >> 32));
+            }
+            else if constexpr (K == dither_kind::gaussian) {
+                const u64 w = words[j];
+                int s = 0;
+                for (int k = 0; k < 4; ++k)
+                    s += static_cast<int>((w >> (16 * k)) & 0xffff) - 32768;
+                return static_cast<float>(s + 2) * GAUSS;
+            }
+            else {
+                const float u = uniform(static_cast<u32>(words[j >> 1] >> (32 * (j & 1))));
+                const float d = u - last;
+                last = u;
+                return d;
+            }
+        }
+
+        // Engine words a block of n samples takes
+        template <dither_kind K>
+        constexpr std::size_t words_for(std::size_t n) noexcept
+        {
+            return K == dither_kind::highpass ? (n + 1) / 2 : n;
+        }
+
+        template <class T>
+        inline T quantize(float v) noexcept
+        {
+            constexpr float lo = static_cast<float>(std::numeric_limits<T>::min());
+            constexpr float hi = static_cast<float>(std::numeric_limits<T>::max());
+            if (v != v) v = 0.0f;
+            v = std::min(std::max(v, lo), hi);
+            return static_cast<T>(std::nearbyint(v));
+        }
+
+#if defined(__AVX2__)
+        // Words j .. j+7 of 'words' as their low and high 32-bit halves, in order
+        inline void halves(const u64* words, __m256i& lo, __m256i& hi) noexcept
+        {
+            const __m256 a = _mm256_loadu_ps(reinterpret_cast<const float*>(words));
+            const __m256 b = _mm256_loadu_ps(reinterpret_cast<const float*>(words + 4));
+            lo = _mm256_permute4x64_epi64(_mm256_castps_si256(_mm256_shuffle_ps(a, b, _MM_SHUFFLE(2, 0, 2, 0))), 0xd8);
+            hi = _mm256_permute4x64_epi64(_mm256_castps_si256(_mm256_shuffle_ps(a, b, _MM_SHUFFLE(3, 1, 3, 1))), 0xd8);
+        }
+
+        inline __m256 uniform8(__m256i x) noexcept
+        {
+            return _mm256_mul_ps(_mm256_cvtepi32_ps(_mm256_srli_epi32(x, 8)), _mm256_set1_ps(U24));
+        }
+
+        // Samples j .. j+7, as noise<K>() for each
+        template <dither_kind K>
+        inline __m256 noise8(const u64* words, std::size_t j, __m256& last) noexcept
+        {
+            if constexpr (K == dither_kind::tpdf) {
+                __m256i lo, hi;
+                halves(words + j, lo, hi);
+                return _mm256_sub_ps(uniform8(lo), uniform8(hi));
+            }
+            else if constexpr (K == dither_kind::gaussian) {
+                // pairs of signed 16-bit fields summed by madd, then the pairs of pairs
+                const __m256i flip = _mm256_set1_epi16(static_cast<short>(0x8000));
+                const __m256i ones = _mm256_set1_epi16(1);
+                const __m256i a = _mm256_madd_epi16(_mm256_xor_si256(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(words + j)), flip), ones);
+                const __m256i b = _mm256_madd_epi16(_mm256_xor_si256(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(words + j + 4)), flip), ones);
+                const __m256i s = _mm256_permute4x64_epi64(_mm256_hadd_epi32(a, b), 0xd8);
+                return _mm256_mul_ps(_mm256_cvtepi32_ps(_mm256_add_epi32(s, _mm256_set1_epi32(2))), _mm256_set1_ps(GAUSS));
+            }
+            else {
+                const __m256 u = uniform8(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(words + j / 2)));
+                // the previous u of each lane: lane 0 takes the carried one
+                const __m256 prev = _mm256_blend_ps(_mm256_permutevar8x32_ps(u, _mm256_setr_epi32(7, 0, 1, 2, 3, 4, 5, 6)), last, 0x01);
+                last = _mm256_permutevar8x32_ps(u, _mm256_set1_epi32(7));
+                return _mm256_sub_ps(u, prev);
+            }
+        }
+
+        // 8 floats, rounded and saturated, stored as T
+        template <class T>
+        inline void quantize8(T* out, __m256 v) noexcept
+        {
+            constexpr float lo = static_cast<float>(std::numeric_limits<T>::min());
+            constexpr float hi = static_cast<float>(std::numeric_limits<T>::max());
+            v = _mm256_and_ps(v, _mm256_cmp_ps(v, v, _CMP_ORD_Q));
+            v = _mm256_min_ps(_mm256_max_ps(v, _mm256_set1_ps(lo)), _mm256_set1_ps(hi));
+            const __m256i w = _mm256_cvtps_epi32(v);
+            const __m256i p16 = _mm256_packs_epi32(w, w);
+            if constexpr (sizeof(T) == 2) {
+                _mm_storeu_si128(reinterpret_cast<__m128i*>(out), _mm256_castsi256_si128(_mm256_permute4x64_epi64(p16, 0x08)));
+            }
+            else {
+                const __m256i p8 = _mm256_packs_epi16(p16, p16);   // in bytes 0-3 of each 128-bit half
+                const __m256i b = _mm256_permutevar8x32_epi32(p8, _mm256_setr_epi32(0, 4, 0, 0, 0, 0, 0, 0));
+                _mm_storel_epi64(reinterpret_cast<__m128i*>(out), _mm256_castsi256_si128(b));
+            }
+        }
+#endif
+
+        // sink(j, noise) or sink8(j, noise vector) for samples 0 .. n-1 of a block
+        template <dither_kind K, class Sink, class Sink8>
+        inline void block(const u64* words, std::size_t n, float amplitude, float& last, Sink&& sink, [[maybe_unused]] Sink8&& sink8)
+        {
+            std::size_t j = 0;
+#if defined(__AVX2__)
+            const __m256 a = _mm256_set1_ps(amplitude);
+            __m256 carry = _mm256_set1_ps(last);
+            for (; j + 8 <= n; j += 8)
+                sink8(j, _mm256_mul_ps(noise8<K>(words, j, carry), a));
+            last = _mm256_cvtss_f32(carry);
+#endif
+            for (; j < n; ++j)
+                sink(j, noise<K>(words, j, last) * amplitude);
+        }
+
+    } // namespace dither_detail
+
+    template <engine E>
+    class ditherer {
+        E engine_;
+        dither_kind kind_;
+        float amplitude_;
+        float last_;    // high-pass: the previous uniform
+
+        // f(first sample, block of noise words, n) over the buffer, CHUNK samples at a time
+        template <dither_kind K, class F>
+        void blocks(std::size_t n, F&& f)
+        {
+            std::array<u64, dither_detail::CHUNK> words;
+            for (std::size_t i = 0; i < n; i += dither_detail::CHUNK) {
+                const std::size_t m = std::min(dither_detail::CHUNK, n - i);
+                fill_words(engine_, words.data(), dither_detail::words_for<K>(m));
+                f(i, words.data(), m);
+            }
+        }
+
+        template <dither_kind K>
+        void generate_as(std::span<float> out)
+        {
+            using namespace dither_detail;
+            float* p = out.data();
+            blocks<K>(out.size(), [&](std::size_t i, const u64* words, std::size_t m) {
+                block<K>(words, m, amplitude_, last_,
+                    [&](std::size_t j, float d) { p[i + j] = d; },
+                    [&](std::size_t j, auto d) {
+#if defined(__AVX2__)
+                        _mm256_storeu_ps(p + i + j, d);
+#endif
+                    });
+            });
+        }
+
+        template <dither_kind K, class T>
+        void quantize_as(std::span<const float> in, std::span<T> out, float scale)
+        {
+            using namespace dither_detail;
+            const float* x = in.data();
+            T* q = out.data();
+            blocks<K>(in.size(), [&](std::size_t i, const u64* words, std::size_t m) {
+                block<K>(words, m, amplitude_, last_,
+                    [&](std::size_t j, float d) { q[i + j] = dither_detail::quantize<T>(x[i + j] * scale + d); },
+                    [&](std::size_t j, auto d) {
+#if defined(__AVX2__)
+                        const __m256 v = _mm256_add_ps(_mm256_mul_ps(_mm256_loadu_ps(x + i + j), _mm256_set1_ps(scale)), d);
+                        quantize8<T>(q + i + j, v);
+#endif
+                    });
+            });
+        }
+
+        template <class T>
+        void quantize_any(std::span<const float> in, std::span<T> out, float scale)
+        {
+            if (in.size() != out.size()) throw std::invalid_argument("ditherer::quantize: input and output of different sizes");
+            switch (kind_) {
+            case dither_kind::tpdf:     quantize_as<dither_kind::tpdf>(in, out, scale); break;
+            case dither_kind::gaussian: quantize_as<dither_kind::gaussian>(in, out, scale); break;
+            default:                    quantize_as<dither_kind::highpass>(in, out, scale); break;
+            }
+        }
+
+    public:
+        explicit ditherer(E engine, dither_kind kind = dither_kind::tpdf, float amplitude = 1.0f)
+            : engine_(std::move(engine)), kind_(kind), amplitude_(amplitude)
+        {
+            last_ = dither_detail::uniform(static_cast<u32>(engine_() >> 32));
+        }
+
+        dither_kind kind() const noexcept { return kind_; }
+        float amplitude() const noexcept { return amplitude_; }
+        E& engine() noexcept { return engine_; }
+
+        // Dither values, in units of the last bit
+        void generate(std::span<float> out)
+        {
+            switch (kind_) {
+            case dither_kind::tpdf:     generate_as<dither_kind::tpdf>(out); break;
+            case dither_kind::gaussian: generate_as<dither_kind::gaussian>(out); break;
+            default:                    generate_as<dither_kind::highpass>(out); break;
+            }
+        }
+
+        // out[i] = round(in[i] * scale + dither), saturated
+        void quantize(std::span<const float> in, std::span<std::int16_t> out, float scale = 32767.0f)
+        {
+            quantize_any(in, out, scale);
+        }
+
+        void quantize(std::span<const float> in, std::span<std::int8_t> out, float scale = 127.0f)
+        {
+            quantize_any(in, out, scale);
+        }
+    };
+
+} // namespace RNG
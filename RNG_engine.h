@@ -0,0 +1,142 @@
+#pragma once
+// file RNG_engine.h
+//
+// Concepts for the library's engines and engine_base, the CRTP mixin that
+// gives every engine the same convenience API on top of its operator():
+//
+//      draw64()                    next output
+//      draw32()                    upper 32 bits of the next output
+//      fill(bytes)                 random bytes: std::span<std::byte>,
+//                                  u8* + size, contiguous containers
+//      unbiased(lo, hi)            uniform integer in [lo, hi] (Lemire)
+//      fill_uniform(span<double>)  doubles in [0, 1), 53 bits each
+//      fill_uniform(span<double>, a, b), fill_uniform(span<float>)
+//
+// The block operations use the fastest native path the engine has: bulk()
+// for fill(), for_each_block() (state in locals) for fill_uniform(), and
+// operator() otherwise. They continue the same stream as operator().
+//
+// An engine that defines one of these members itself keeps its own version
+// (the mixin's is hidden), e.g. Nasam1024::draw32() returns the low bits.
+//
+//      class my_engine : public RNG::engine_base<my_engine> { ... };
+
+#define NOMINMAX
+#include <algorithm>
+#include <concepts>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <span>
+#include <type_traits>
+#include <utility>
+
+#include "common.h"
+
+namespace RNG {
+
+    // A UniformRandomBitGenerator with 64-bit output over the full range
+    // (spelled out rather than using std::uniform_random_bit_generator, which
+    // would need <random>)
+    template <class E>
+    concept engine = requires(E & e) {
+        typename E::result_type;
+        { e() } -> std::same_as<u64>;
+        { E::min() } -> std::same_as<u64>;
+        { E::max() } -> std::same_as<u64>;
+    } && std::same_as<typename E::result_type, u64>
+        && std::bool_constant<E::min() == 0>::value
+        && std::bool_constant<E::max() == std::numeric_limits<u64>::max()>::value;
+
+    // An engine with a native block path, bulk(u8*, size_t), that continues
+    // the stream of operator()
+    template <class E>
+    concept bulk_engine = engine<E>
+        && requires(E & e, u8 * p, std::size_t n) { e.bulk(p, n); };
+
+    template <class Derived>
+    class engine_base {
+        Derived& derived() noexcept { return static_cast<Derived&>(*this); }
+
+    public:
+        inline u64 draw64() { return derived()(); }
+        inline u32 draw32() { return static_cast<u32>(derived()() >> 32); }
+
+        // Bytes of the following outputs; a partly used last word counts as used
+        void fill(u8* data, std::size_t size)
+        {
+            if constexpr (requires(Derived & d) { d.bulk(data, size); }) {
+                derived().bulk(data, size);
+            }
+            else {
+                u8* p = data;
+                std::size_t left = size;
+                for_each_block(derived(), (size + sizeof(u64) - 1) / sizeof(u64), [&](std::span<const u64> block) {
+                    const std::size_t k = std::min(left, block.size_bytes());
+                    std::memcpy(p, block.data(), k);
+                    p += k;
+                    left -= k;
+                });
+            }
+        }
+
+        void fill(std::span<std::byte> data) { fill(reinterpret_cast<u8*>(data.data()), data.size()); }
+
+        // Any contiguous container: std::array, std::vector, ...
+        template <class C>
+            requires requires(C& c) { c.data(); c.size(); }
+        void fill(C& c) { fill(std::as_writable_bytes(std::span(c.data(), c.size()))); }
+
+        // Uniformly distributed integer in [lo, hi] (bounds in either order),
+        // using Lemire's nearly divisionless method: no bias, and a division
+        // only in the rare case that a rejection is possible.
+        inline u64 unbiased(u64 lo, u64 hi)
+        {
+            if (lo > hi) std::swap(lo, hi);
+            const u64 range = hi - lo + 1;
+            if (range == 0) return derived()();  // full 64-bit range
+
+            u64 p_hi;
+            u64 p_lo = umul128(derived()(), range, &p_hi);
+            if (p_lo < range) [[unlikely]] {
+                const u64 t = (0 - range) % range;  // 2^64 mod range
+                while (p_lo < t)
+                    p_lo = umul128(derived()(), range, &p_hi);
+            }
+            return lo + p_hi;
+        }
+
+        // Doubles in [0, 1) with 53 random bits, one output each
+        void fill_uniform(std::span<double> out)
+        {
+            double* p = out.data();
+            for_each_block(derived(), out.size(), [&](std::span<const u64> block) {
+                for (u64 x : block)
+                    *p++ = static_cast<double>(x >> 11) * 0x1.0p-53;
+            });
+        }
+
+        // Doubles in [a, b)
+        void fill_uniform(std::span<double> out, double a, double b)
+        {
+            const double scale = (b - a) * 0x1.0p-53;
+            double* p = out.data();
+            for_each_block(derived(), out.size(), [&](std::span<const u64> block) {
+                for (u64 x : block)
+                    *p++ = a + static_cast<double>(x >> 11) * scale;
+            });
+        }
+
+        // Floats in [0, 1) with 24 random bits, one output each
+        void fill_uniform(std::span<float> out)
+        {
+            float* p = out.data();
+            for_each_block(derived(), out.size(), [&](std::span<const u64> block) {
+                for (u64 x : block)
+                    *p++ = static_cast<float>(x >> 40) * 0x1.0p-24f;
+            });
+        }
+    };
+
+} // namespace RNG
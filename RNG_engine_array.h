@@ -0,0 +1,242 @@
+#pragma once
+// file RNG_engine_array.h
+//
+// RNG::engine_array<E, N>: N independent streams of engine E (fast or
+// SplitMix64) stored as a structure of arrays, one 64-bit state per entity.
+//
+// One call advances every entity by one output and writes out[i] for entity
+// i, in SIMD over the states. Memory traffic is 8 bytes of state in and out
+// plus the output per entity and step. An array of fast objects also carries
+// each object's 64-byte buffer and its index.
+//
+// Streams
+//      Entity i starts 2^32 outputs after entity i - 1: fast's jump(), applied
+//      to the state instead of to an engine. For fast, entity i is the stream
+//      of RNG::make_stream<fast>(seed, i). For SplitMix64, the streams are
+//      consecutive 2^32-output windows of the SplitMix64 sequence from seed.
+//      engine(i) returns entity i as an ordinary engine at its current position.
+//
+// SIMD
+//      fast needs the 128-bit product of two 64-bit lanes, which no vector
+//      unit has; it is built from 32-bit multiplies, 8 lanes with AVX-512F/DQ,
+//      4 with AVX2 (chosen at compile time from __AVX512F__ / __AVX2__), and
+//      with scalar 128-bit multiplies otherwise. SplitMix64 is a plain loop
+//      that compilers vectorize. All paths give the same outputs.
+//
+// Example
+//      RNG::engine_array<RNG::fast> noise(seed, particles.size());
+//      std::vector<double> u(particles.size());
+//      for (step...) {
+//          noise.next_uniform(u);              // one draw per particle
+//          for (size_t i = 0; ...) particles[i].v += sigma * (u[i] - 0.5);
+//      }
+
+#define NOMINMAX
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <stdexcept>
+#include <type_traits>
+#include <vector>
+
+#include "common.h"
+#include "RNG_SplitMix64.h"
+#include "RNG_fast.h"
+#include "RNG_mix.h"
+
+#if defined(__AVX2__) || defined(__AVX512F__)
+#include <immintrin.h>
+#endif
+
+namespace RNG {
+
+    // Per-engine rules for engine_array: start state of entity i, one SIMD
+    // step over all states, and conversion back to an engine. A friend of the
+    // engines it supports.
+    template <class E> struct soa_kernel;
+
+    namespace engine_array_detail {
+
+        inline constexpr u64 STREAM_STEP_LOG2 = 32; // outputs between entities, as fast::jump()
+
+#if defined(__AVX512F__) && defined(__AVX512DQ__)
+        // lo ^ hi ^ s for the 128-bit products s * (s ^ mix), 8 lanes
+        inline __m512i wymix(__m512i s, __m512i mix) noexcept
+        {
+            using mix_detail::mul32, mix_detail::srli;
+            const __m512i m32 = _mm512_set1_epi64(0xffffffffll);
+            const __m512i b = _mm512_xor_si512(s, mix);
+            const __m512i sh = srli<32>(s), bh = srli<32>(b);
+            const __m512i ll = mul32(s, b), lh = mul32(s, bh);
+            const __m512i hl = mul32(sh, b), hh = mul32(sh, bh);
+            const __m512i mid = _mm512_add_epi64(_mm512_add_epi64(srli<32>(ll),
+                _mm512_and_si512(lh, m32)), _mm512_and_si512(hl, m32));
+            const __m512i lo = _mm512_mullo_epi64(s, b);
+            const __m512i hi = _mm512_add_epi64(_mm512_add_epi64(hh, srli<32>(lh)),
+                _mm512_add_epi64(srli<32>(hl), srli<32>(mid)));
+            return _mm512_ternarylogic_epi64(lo, hi, s, 0x96); // lo ^ hi ^ s
+        }
+#elif defined(__AVX2__)
+        // lo ^ hi ^ s for the 128-bit products s * (s ^ mix), 4 lanes
+        inline __m256i wymix(__m256i s, __m256i mix) noexcept
+        {
+            const __m256i m32 = _mm256_set1_epi64x(0xffffffffll);
+            const __m256i b = _mm256_xor_si256(s, mix);
+            const __m256i sh = _mm256_srli_epi64(s, 32), bh = _mm256_srli_epi64(b, 32);
+            const __m256i ll = _mm256_mul_epu32(s, b), lh = _mm256_mul_epu32(s, bh);
+            const __m256i hl = _mm256_mul_epu32(sh, b), hh = _mm256_mul_epu32(sh, bh);
+            const __m256i mid = _mm256_add_epi64(_mm256_add_epi64(_mm256_srli_epi64(ll, 32),
+                _mm256_and_si256(lh, m32)), _mm256_and_si256(hl, m32));
+            const __m256i lo = _mm256_or_si256(_mm256_and_si256(ll, m32), _mm256_slli_epi64(mid, 32));
+            const __m256i hi = _mm256_add_epi64(_mm256_add_epi64(hh, _mm256_srli_epi64(lh, 32)),
+                _mm256_add_epi64(_mm256_srli_epi64(hl, 32), _mm256_srli_epi64(mid, 32)));
+            return _mm256_xor_si256(_mm256_xor_si256(lo, hi), s);
+        }
+#endif
+
+    } // namespace engine_array_detail
+
+    template <>
+    struct soa_kernel<fast> {
+        static constexpr u64 INCREMENT = fast::INCREMENT;
+        static constexpr u64 MIX = fast::MIX;
+
+        // State of the next output of fast(seed)
+        static u64 origin(u64 seed) noexcept { return fast(seed).next_state(); }
+
+        static fast engine(u64 state) noexcept
+        {
+            fast e(0ull);
+            e.state = state;
+            e.index = fast::BUFFER_SIZE;
+            return e;
+        }
+
+        static void step(u64* __restrict s, u64* __restrict out, std::size_t n) noexcept
+        {
+            // the lanes done with SIMD, a whole number of vectors: with a
+            // constant n (fixed-size arrays) the tail loop below then has a
+            // known trip count, possibly 0
+            std::size_t full = 0;
+#if defined(__AVX512F__) && defined(__AVX512DQ__)
+            full = n & ~std::size_t(7);
+            const __m512i inc = _mm512_set1_epi64(static_cast<long long>(INCREMENT));
+            const __m512i mix = _mm512_set1_epi64(static_cast<long long>(MIX));
+            for (std::size_t i = 0; i < full; i += 8) {
+                const __m512i S = _mm512_add_epi64(_mm512_loadu_si512(s + i), inc);
+                _mm512_storeu_si512(out + i, engine_array_detail::wymix(S, mix));
+                _mm512_storeu_si512(s + i, S);
+            }
+#elif defined(__AVX2__)
+            full = n & ~std::size_t(3);
+            const __m256i inc = _mm256_set1_epi64x(static_cast<long long>(INCREMENT));
+            const __m256i mix = _mm256_set1_epi64x(static_cast<long long>(MIX));
+            for (std::size_t i = 0; i < full; i += 4) {
+                const __m256i S = _mm256_add_epi64(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(s + i)), inc);
+                _mm256_storeu_si256(reinterpret_cast<__m256i*>(out + i), engine_array_detail::wymix(S, mix));
+                _mm256_storeu_si256(reinterpret_cast<__m256i*>(s + i), S);
+            }
+#endif
+            for (std::size_t i = full; i < n; ++i) {
+                const u64 S = s[i] + INCREMENT;
+                u64 hi;
+                const u64 lo = umul128(S, S ^ MIX, &hi);
+                out[i] = lo ^ hi ^ S;
+                s[i] = S;
+            }
+        }
+    };
+
+    template <>
+    struct soa_kernel<SplitMix64> {
+        static constexpr u64 INCREMENT = SplitMix64::INCREMENT;
+
+        static u64 origin(u64 seed) noexcept { return seed; }
+        static SplitMix64 engine(u64 state) noexcept { return SplitMix64(state); }
+
+        static void step(u64* __restrict s, u64* __restrict out, std::size_t n) noexcept
+        {
+            for (std::size_t i = 0; i < n; ++i) {
+                const u64 z = s[i] + INCREMENT;
+                s[i] = z;
+                out[i] = SplitMix64::mix(z);
+            }
+        }
+    };
+
+    template <class E, std::size_t N = std::dynamic_extent>
+    class engine_array {
+        using kernel = soa_kernel<E>;
+        static constexpr std::size_t CHUNK = 256; // words converted per pass in next_uniform()
+
+        struct alignas(64) fixed_states : std::array<u64, N> {};
+        using storage = std::conditional_t<N == std::dynamic_extent, std::vector<u64>, fixed_states>;
+
+        storage states_;
+
+        void init(u64 seed)
+        {
+            const u64 origin = kernel::origin(seed);
+            const u64 stride = kernel::INCREMENT << engine_array_detail::STREAM_STEP_LOG2;
+            for (std::size_t i = 0; i < states_.size(); ++i)
+                states_[i] = origin + i * stride;
+        }
+
+        void check(std::size_t n) const
+        {
+            if (n < states_.size())
+                throw std::invalid_argument("engine_array: output span smaller than the array");
+        }
+
+    public:
+        using engine_type = E;
+
+        explicit engine_array(u64 seed) requires (N != std::dynamic_extent) { init(seed); }
+
+        engine_array(u64 seed, std::size_t count) requires (N == std::dynamic_extent)
+            : states_(count)
+        {
+            init(seed);
+        }
+
+        std::size_t size() const noexcept { return states_.size(); }
+
+        // Advance every entity by one output: out[i] = next output of entity i
+        void next(std::span<u64> out)
+        {
+            check(out.size());
+            kernel::step(states_.data(), out.data(), states_.size());
+        }
+
+        // Same, as doubles in [0, 1) with 53 random bits
+        void next_uniform(std::span<double> out)
+        {
+            check(out.size());
+            alignas(64) u64 words[CHUNK];
+            for (std::size_t b = 0; b < states_.size(); b += CHUNK) {
+                const std::size_t k = std::min(CHUNK, states_.size() - b);
+                kernel::step(states_.data() + b, words, k);
+                for (std::size_t i = 0; i < k; ++i)
+                    out[b + i] = static_cast<double>(words[i] >> 11) * 0x1.0p-53;
+            }
+        }
+
+        // Advance every entity by n outputs
+        void discard(u64 n) noexcept
+        {
+            const u64 d = n * kernel::INCREMENT;
+            for (u64& s : states_)
+                s += d;
+        }
+
+        // Entity i as an engine, at the same position
+        E engine(std::size_t i) const { return kernel::engine(states_[i]); }
+
+        // Raw states, e.g. for checkpoints; state(i) is the engine's state
+        // before entity i's next output
+        std::span<const u64> states() const noexcept { return { states_.data(), states_.size() }; }
+        std::span<u64> states() noexcept { return { states_.data(), states_.size() }; }
+    };
+
+} // namespace RNG
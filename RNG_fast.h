@@ -1,8 +1,13 @@
 #pragma once
 
 #define NOMINMAX
+#include <iosfwd>     // operator<< / >> are templates, <iostream> is only needed where used
+
 #include "common.h"
+#include "RNG_engine.h"
+#include "RNG_mix.h"          // WY_P0, WY_P1
 #include "RNG_random_device.h" // for seeding
+#include "RNG_stats.h"
 
 //==============================================================================================
 // RNG::fast, Fast non-cryptographic generator
@@ -18,7 +23,7 @@ namespace RNG {
 
 
     };
-    class fast {
+    class fast : public engine_base<fast> {
         /*
         fast: A fast non-cryptographic PRNG inspired by wyrand.
         Core idea (additive increment + wide multiplication + hi ⊕ lo output) comes from:
@@ -90,8 +95,10 @@ namespace RNG {
         size_t index = BUFFER_SIZE;  // start empty to force initial fill
 
         // constants from wyrand variant
-        static constexpr uint64_t INCREMENT = 0x2d358dccaa6c78a5ull;
-        static constexpr uint64_t MIX = 0x8bb84b93962eacc9ull;
+        static constexpr uint64_t INCREMENT = WY_P0;
+        static constexpr uint64_t MIX = WY_P1;
+
+        template <class E> friend struct soa_kernel;  // RNG_engine_array.h
 
     public:
         using result_type = uint64_t;
@@ -103,29 +110,31 @@ namespace RNG {
         }
 
         // seed from an integer
-        fast(std::uint64_t seed = 0x2d358dccaa6c78a5ull) noexcept
+        fast(std::uint64_t seed) noexcept
             : state(seed ^ 0x9e3779b97f4a7c15ull)  // optional: better seed mixing
         {
             refill();
         }
 
         // Seed with a seed_seq (standard requirement)
-        template <class SeedSeq>
+        template <seed_sequence SeedSeq>
         explicit fast(SeedSeq& seq) {
-            seed(seq);
+            set_seed(seq);
         }
 
         // Standard seed function using seed_seq
-        template <class SeedSeq>
+        template <seed_sequence SeedSeq>
         void seed(SeedSeq& seq) {
-            uint32_t seeds[2];
-            seq.generate(seeds, seeds + 2);
-            state = (static_cast<uint64_t>(seeds[1]) << 32) | seeds[0];
+            stats::count<fast>(stats::reseeds);
+            set_seed(seq);
         }
 
         // Default seed (e.g., fast gen; without explicit seed)
+        // Same stream as fast(s).
         void seed(result_type s) {
-            state = s;
+            state = s ^ 0x9e3779b97f4a7c15ull;
+            index = BUFFER_SIZE;
+            stats::count<fast>(stats::reseeds);
         }
 
         // non-deterministic seed
@@ -133,12 +142,15 @@ namespace RNG {
             random_device rd;
 
             state = (static_cast<uint64_t>(rd()) << 32) | rd();
+            index = BUFFER_SIZE;
+            stats::count<fast>(stats::reseeds);
         }
 
         // Core generator
         // 5.376 GB/s
         inline std::uint64_t operator()() noexcept
         {
+            stats::count<fast>(stats::draws);
             if (index == BUFFER_SIZE)
                 refill();
 
@@ -148,35 +160,102 @@ namespace RNG {
         // fill a byte buffer with n bytes of random data
         inline void bulk(uint8_t *x, size_t n) noexcept
         {
+            stats::count<fast>(stats::bulk_bytes, n);
             uint8_t* p = x;
-            // fill full buffer-sized chunks. Assume we need a new buffer when we start.
+            // use up what is left in the buffer first, so bulk() continues the
+            // same stream as operator()
+            while (n > 0 && index < BUFFER_SIZE) {
+                size_t k = std::min<size_t>(n, 8);
+                memcpy(p, &buffer[index++], k);
+                n -= k;
+                p += k;
+            }
+            // fill full buffer-sized chunks
             while (n >= 64) {
                 refill();
                 memcpy(p, buffer.data(), 64);
+                index = BUFFER_SIZE;
                 n -= 64;
                 p += 64;
             }
-            // fill any remaining bytes
+            // fill any remaining bytes; a partly used word counts as used
             if (n > 0) {
                 refill();
                 memcpy(p, buffer.data(), n);
+                index = (n + 7) / 8;
             }
-            // invalidate the buffer
-            index = BUFFER_SIZE;
+        }
+
+        // Internal iteration: the next n outputs, the same ones n calls to
+        // operator() would return, passed to f as consecutive blocks
+        // (std::span<const uint64_t>) of at most BUFFER_SIZE words. The state
+        // stays in a local for the whole loop instead of being reloaded after
+        // every output. f must not use this engine; if f throws, the engine's
+        // position is unspecified.
+        template <class F>
+        void for_each_block(uint64_t n, F&& f) {
+            stats::count<fast>(stats::bulk_bytes, n * sizeof(uint64_t));
+            if (n > 0 && index < BUFFER_SIZE) {
+                const size_t k = static_cast<size_t>(std::min<uint64_t>(n, BUFFER_SIZE - index));
+                f(std::span<const uint64_t>(buffer.data() + index, k));
+                index += k;
+                n -= k;
+            }
+            uint64_t s = state;
+            std::array<uint64_t, BUFFER_SIZE> block;
+            for (; n >= BUFFER_SIZE; n -= BUFFER_SIZE) {
+                for (size_t i = 0; i < BUFFER_SIZE; ++i) {
+                    uint64_t S, lo, hi;
+                    S = s + (i + 1) * INCREMENT;
+                    lo = RNG::umul128(S, S ^ MIX, &hi);
+                    block[i] = lo ^ hi ^ S;
+                }
+                s += BUFFER_SIZE * INCREMENT;
+                stats::count<fast>(stats::refills);
+                f(std::span<const uint64_t>(block));
+            }
+            state = s;
+            if (n > 0) {
+                refill();
+                f(std::span<const uint64_t>(buffer.data(), static_cast<size_t>(n)));
+                index = static_cast<size_t>(n);
+            }
+        }
+
+        // f(x) for each of the next n outputs, see for_each_block()
+        template <class F>
+        void generate_n(uint64_t n, F&& f) {
+            for_each_block(n, [&](std::span<const uint64_t> block) {
+                for (uint64_t x : block)
+                    f(x);
+            });
         }
 
         // Discard (jump ahead) - standard requirement
+        // Output k after a refill is computed from state + (k+1)*INCREMENT, so the
+        // position of the next output is state - (unread buffered values)*INCREMENT.
+        // Move that position forward and drop the buffer.
         void discard(unsigned long long nsteps) {
-            state += nsteps * INCREMENT;
+            stats::count<fast>(stats::discards);
+            advance(nsteps);
+        }
+
+        // n-th output from the current position (0 = the next one) without
+        // advancing. Output k of a refill depends only on state + (k+1)*INCREMENT.
+        inline uint64_t at(uint64_t n) const noexcept {
+            const uint64_t S = next_state() + (n + 1) * INCREMENT;
+            uint64_t hi;
+            const uint64_t lo = RNG::umul128(S, S ^ MIX, &hi);
+            return lo ^ hi ^ S;
         }
 
         // Constants required by the concept
         static constexpr result_type min() noexcept { return 0; }
         static constexpr result_type max() noexcept { return std::numeric_limits<result_type>::max(); }
 
-        // Equality comparison (standard)
+        // Equality comparison (standard): same next output, whatever is buffered
         friend bool operator==(const fast& lhs, const fast& rhs) noexcept {
-            return lhs.state == rhs.state;
+            return lhs.next_state() == rhs.next_state();
         }
 
         friend bool operator!=(const fast& lhs, const fast& rhs) noexcept {
@@ -184,98 +263,81 @@ namespace RNG {
         }
 
         // Optional: stream operators for save/restore (makes it a full Engine)
+        // The saved state includes the buffer position.
         template <class CharT, class Traits>
         friend std::basic_ostream<CharT, Traits>& operator<<(std::basic_ostream<CharT, Traits>& os, const fast& rng) {
-            os << rng.state;
+            os << rng.next_state();
             return os;
         }
 
         template <class CharT, class Traits>
         friend std::basic_istream<CharT, Traits>& operator>>(std::basic_istream<CharT, Traits>& is, fast& rng) {
             is >> rng.state;
+            rng.index = BUFFER_SIZE;
             return is;
         }
 
-        // extras
+        // Compact binary checkpoint (see RNG_checkpoint.h): the state the next
+        // output is computed from. The buffer is recomputed after restore().
+        static constexpr size_t CHECKPOINT_BYTES = 8;
 
-        inline uint32_t draw32() {
-            return static_cast<uint32_t>((*this)() >> 32);
+        void checkpoint(uint8_t* out) const noexcept {
+            const uint64_t s = next_state();
+            std::memcpy(out, &s, sizeof(s));
         }
 
-        inline uint64_t draw64() {
-            return (*this)();
+        void restore(const uint8_t* in) noexcept {
+            std::memcpy(&state, in, sizeof(state));
+            index = BUFFER_SIZE;
         }
 
-        // Returns a uniformly distributed integer in [lo, hi] using Lemire's unbiased method.
-        // Handles all edge cases (including full 64-bit_count range) without statistical bias.
-        inline std::uint64_t unbiased(std::uint64_t lo, std::uint64_t hi)
-        {
-            if (lo > hi) std::swap(lo, hi);
-            if (lo == hi) return lo;
-
-            const std::uint64_t range = hi - lo + 1;
-            if (range == 0) return draw64();  // full 64-bit_count range
-
-            uint64_t x = draw64();
-            uint64_t p_lo, p_hi; // lower and upper parts of the product
-            p_lo = _umul128(x, range, &p_hi);
-
-            if (p_lo < range) [[unlikely]] {
-                const std::uint64_t t = (std::numeric_limits<std::uint64_t>::max() - range + p_lo) % range;
-                while (p_lo < t) {
-                    x = draw64();
-                    p_lo = _umul128(x, range, &p_hi);
-                }
-            }
-
-            return p_lo + p_hi;
+        // jump() and long_jump() — consistent with csprng
+        void jump() {
+            stats::count<fast>(stats::jumps);
+            advance(1ULL << 32);
         }
 
-        // fill() overloads — identical to the others
-        inline void fill(std::span<std::byte> data) {
-            std::byte* ptr = data.data();
-            size_t size = data.size();
-
-            while (size >= 8) {
-                uint64_t z = draw64();
-                std::memcpy(ptr, &z, 8);
-                ptr += 8;
-                size -= 8;
-            }
-
-            if (size > 0) {
-                uint64_t z = draw64();
-                std::memcpy(ptr, &z, size);
-            }
+        void long_jump() {
+            stats::count<fast>(stats::jumps);
+            advance(1ULL << 48);
         }
 
-        template <class T, size_t N>
-        inline void fill(std::array<T, N>& arr) {
-            fill(std::as_bytes(std::span(arr)));
+        // jump() 'times' times, in one step
+        void jump(uint64_t times) {
+            stats::count<fast>(stats::jumps);
+            advance(times << 32);
         }
 
-        template <class T>
-        inline void fill(std::vector<T>& arr) {
-            fill(std::as_bytes(std::span(arr)));
+    private:
+        // seed(seq) without the usage count (RNG_stats.h), for the constructor
+        template <seed_sequence SeedSeq>
+        void set_seed(SeedSeq& seq) {
+            uint32_t seeds[2];
+            seq.generate(seeds, seeds + 2);
+            state = (static_cast<uint64_t>(seeds[1]) << 32) | seeds[0];
+            index = BUFFER_SIZE;
         }
 
-        // jump() and long_jump() — consistent with csprng
-        void jump() {
-            discard(1ULL << 32);
+        // State that the next refill would start from, if the buffered but
+        // unread values were dropped (see discard())
+        inline uint64_t next_state() const noexcept {
+            return state - (BUFFER_SIZE - index) * INCREMENT;
         }
 
-        void long_jump() {
-            discard(1ULL << 48);
+        // discard() without the usage count (RNG_stats.h)
+        inline void advance(uint64_t nsteps) noexcept {
+            state += (nsteps - (BUFFER_SIZE - index)) * INCREMENT;
+            index = BUFFER_SIZE;
         }
 
-    private:
         inline void refill() noexcept
         {
+            stats::count<fast>(stats::refills);
             for (size_t i = 0; i < BUFFER_SIZE; ++i)
             {
                 uint64_t S, lo, hi;
                 S = state + (i + 1) * INCREMENT;
-                lo = _umul128(S, S ^ MIX, &hi);
+                lo = RNG::umul128(S, S ^ MIX, &hi);
                 buffer[i] = lo ^ hi ^ S;
             }
             state += 8*INCREMENT;
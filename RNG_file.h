@@ -0,0 +1,122 @@
+#pragma once
+// file RNG_file.h
+//
+// Shared pieces of the binary file formats (RNG_tape.h, RNG_checkpoint.h):
+//
+//      file_name<E>    engine name stored in file headers
+//      mapped_file     whole-file memory mapping, read-only or created
+//                      read-write with a given size
+
+#define NOMINMAX
+#include <cstdint>
+#include <stdexcept>
+#include <string>
+
+#include "common.h"
+#include "RNG_SplitMix64.h"
+#include "RNG_wyrand.h"
+#include "RNG_fast.h"
+#include "Nasam1024.h"
+
+#if defined(_WIN32)
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace RNG {
+
+    // Name written to file headers for the engines of this library
+    template <class E> struct file_name;
+    template <> struct file_name<SplitMix64> { static constexpr const char* value = "splitmix64"; };
+    template <> struct file_name<wyrand> { static constexpr const char* value = "wyrand"; };
+    template <> struct file_name<fast> { static constexpr const char* value = "fast"; };
+    template <> struct file_name<Nasam1024> { static constexpr const char* value = "nasam1024"; };
+
+    // Memory mapping of a whole file. Errors throw std::runtime_error.
+    class mapped_file {
+        u8* data_ = nullptr;
+        std::size_t size_ = 0;
+#if defined(_WIN32)
+        HANDLE file_ = INVALID_HANDLE_VALUE;
+        HANDLE map_ = nullptr;
+#endif
+        void open(const std::string& path, bool create, std::size_t size)
+        {
+#if defined(_WIN32)
+            file_ = CreateFileA(path.c_str(), create ? GENERIC_READ | GENERIC_WRITE : GENERIC_READ,
+                FILE_SHARE_READ, nullptr, create ? CREATE_ALWAYS : OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+            if (file_ == INVALID_HANDLE_VALUE)
+                throw std::runtime_error("cannot open " + path);
+            if (create) {
+                size_ = size;
+            }
+            else {
+                LARGE_INTEGER existing{};
+                if (!GetFileSizeEx(file_, &existing))
+                    throw std::runtime_error("cannot open " + path);
+                size_ = static_cast<std::size_t>(existing.QuadPart);
+            }
+            if (size_ == 0) return;
+            const u64 n = size_;
+            map_ = CreateFileMappingA(file_, nullptr, create ? PAGE_READWRITE : PAGE_READONLY,
+                static_cast<DWORD>(n >> 32), static_cast<DWORD>(n), nullptr);
+            if (map_)
+                data_ = static_cast<u8*>(MapViewOfFile(map_, create ? FILE_MAP_WRITE : FILE_MAP_READ, 0, 0, 0));
+            if (!data_)
+                throw std::runtime_error("cannot map " + path);
+#else
+            const int fd = create ? ::open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0644)
+                : ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+            struct stat st {};
+            if (fd < 0 || (create ? ftruncate(fd, static_cast<off_t>(size)) : fstat(fd, &st)) != 0) {
+                if (fd >= 0) ::close(fd);
+                throw std::runtime_error("cannot open " + path);
+            }
+            size_ = create ? size : static_cast<std::size_t>(st.st_size);
+            void* p = size_ ? mmap(nullptr, size_, create ? PROT_READ | PROT_WRITE : PROT_READ, MAP_SHARED, fd, 0) : nullptr;
+            ::close(fd);
+            if (p == MAP_FAILED)
+                throw std::runtime_error("cannot map " + path);
+            data_ = static_cast<u8*>(p);
+#endif
+        }
+
+        void close() noexcept
+        {
+#if defined(_WIN32)
+            if (data_) UnmapViewOfFile(data_);
+            if (map_) CloseHandle(map_);
+            if (file_ != INVALID_HANDLE_VALUE) CloseHandle(file_);
+#else
+            if (data_) munmap(data_, size_);
+#endif
+        }
+
+    public:
+        // Map an existing file read-only
+        explicit mapped_file(const std::string& path)
+        {
+            try { open(path, false, 0); } catch (...) { close(); throw; }
+        }
+
+        // Create (or truncate) a file of 'size' bytes and map it read-write
+        mapped_file(const std::string& path, std::size_t size)
+        {
+            try { open(path, true, size); } catch (...) { close(); throw; }
+        }
+
+        ~mapped_file() { close(); }
+        mapped_file(const mapped_file&) = delete;
+        mapped_file& operator=(const mapped_file&) = delete;
+
+        const u8* data() const noexcept { return data_; }
+        u8* data() noexcept { return data_; }     // writable only for created files
+        std::size_t size() const noexcept { return size_; }
+    };
+
+} // namespace RNG
@@ -0,0 +1,654 @@
+#pragma once
+// file RNG_fill.h
+//
+// RNG::file_fill - write large amounts of engine output to a file or block device
+// at storage speed: test datasets, scratch-volume wipes, I/O benchmarks.
+//
+// The file holds the engine's output stream as little-endian 64-bit words:
+// byte k of the file is byte k of E(seed) bulk output, whatever the number of
+// threads, block size or I/O backend. Threads position their engine copy
+// with discard(), so the engine must provide it (fast, Nasam1024, SplitMix64).
+// config::offset and config::position place the stream elsewhere in the file
+// or start it later (RNG_tape.h writes its header in front of the data).
+//
+// Pipeline
+//      Generator threads fill aligned block buffers in parallel (bulk path).
+//      On Linux the main thread submits finished blocks to io_uring as
+//      positioned writes, keeping up to queue_depth writes in flight; the
+//      buffers are registered with the ring (WRITE_FIXED), so the kernel does
+//      not map them again per write. Files are opened with O_DIRECT, so the
+//      data goes from the buffers to the device without the page cache.
+//      Buffers can be backed by huge pages (MAP_HUGETLB, or transparent huge
+//      pages when none are reserved).
+//
+//      Fallbacks, each reported in report::backend / report::direct:
+//          io_uring unavailable (old kernel, seccomp)  threads pwrite() their own blocks
+//          buffer registration refused (memlock)       plain IORING_OP_WRITE
+//          O_DIRECT refused (tmpfs, some FUSE)         buffered writes
+//          not Linux                                   threads write through one shared FILE
+//      An O_DIRECT file whose size is not a multiple of 4096 gets its last
+//      partial block written without O_DIRECT.
+//
+// Example
+//      RNG::file_fill::config cfg;
+//      cfg.bytes = 64ull << 30;                     // 64 GiB
+//      auto r = RNG::file_fill::run<RNG::fast>("/scratch/data.bin", cfg);
+//
+//      cfg.bytes = 0;                               // whole device
+//      RNG::file_fill::run<RNG::Nasam1024>("/dev/nvme1n1", cfg);
+//
+// Errors (cannot open, I/O error, no size for a regular file) throw
+// std::runtime_error. See tools/rng_fill.cpp for a command-line driver.
+
+#define NOMINMAX
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "common.h"
+
+#if defined(__linux__)
+#include <errno.h>
+#include <fcntl.h>
+#include <linux/fs.h>       // BLKGETSIZE64
+#include <linux/io_uring.h>
+#include <sys/ioctl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+#include <unistd.h>
+#endif
+
+namespace RNG::file_fill {
+
+    struct config {
+        u64 bytes = 0;           // bytes to write; 0 = size of the block device
+        u64 seed = 12345ull;
+        u64 position = 0;        // stream position (64-bit words) of the first byte written
+        u64 offset = 0;          // file offset of the first byte; O_DIRECT needs a multiple of 4096
+        unsigned threads = std::max(1u, std::thread::hardware_concurrency()); // generator threads
+        std::size_t block_bytes = std::size_t(4) << 20; // bytes per write, rounded up to 4096, at most 1 GiB
+        unsigned queue_depth = 8;   // writes in flight
+        bool direct = true;         // O_DIRECT
+        bool hugepages = false;     // huge-page backed buffers
+        bool io_uring = true;       // false forces the pwrite() backend
+        bool sync = true;           // fsync() before returning
+        // Called from the calling thread, about every 'progress_interval' seconds
+        std::function<void(u64 written, u64 total)> progress;
+        double progress_interval = 1.0;
+    };
+
+    struct report {
+        u64 bytes = 0;
+        double seconds = 0.0;
+        std::string backend;        // "io_uring+fixed", "io_uring", "pwrite", "stdio"
+        bool direct = false;        // O_DIRECT was used
+        bool hugepages = false;     // buffers are on huge pages (MAP_HUGETLB or THP advice)
+
+        double gib_per_second() const noexcept { return seconds > 0 ? static_cast<double>(bytes) / 0x1p30 / seconds : 0.0; }
+    };
+
+    namespace detail {
+
+        constexpr std::size_t ALIGN = 4096; // O_DIRECT alignment, safe for 512e and 4Kn devices
+        // Largest block: below Linux's per-write limit (0x7ffff000) and the
+        // 32-bit length of an io_uring write
+        constexpr std::size_t MAX_BLOCK = std::size_t(1) << 30;
+
+        [[noreturn]] inline void fail(const std::string& what)
+        {
+#if defined(__linux__)
+            throw std::runtime_error("file_fill: " + what + ": " + std::strerror(errno));
+#else
+            throw std::runtime_error("file_fill: " + what);
+#endif
+        }
+
+        // Aligned block buffers, one allocation for all of them
+        class buffers {
+            u8* base_ = nullptr;
+            std::size_t bytes_ = 0;
+            bool huge_ = false;
+#if !defined(__linux__)
+            std::vector<u8> storage_;
+#endif
+        public:
+            buffers(std::size_t count, std::size_t block, bool hugepages)
+            {
+                bytes_ = count * block;
+#if defined(__linux__)
+                if (hugepages) {
+                    constexpr std::size_t HUGE = std::size_t(2) << 20;
+                    const std::size_t rounded = (bytes_ + HUGE - 1) / HUGE * HUGE;
+                    void* p = mmap(nullptr, rounded, PROT_READ | PROT_WRITE,
+                        MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB | MAP_POPULATE, -1, 0);
+                    if (p != MAP_FAILED) {
+                        base_ = static_cast<u8*>(p);
+                        bytes_ = rounded;
+                        huge_ = true;
+                        return;
+                    }
+                }
+                void* p = mmap(nullptr, bytes_, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+                if (p == MAP_FAILED) fail("cannot allocate buffers");
+                base_ = static_cast<u8*>(p);
+                if (hugepages) // no reserved huge pages: ask for transparent ones
+                    huge_ = madvise(p, bytes_, MADV_HUGEPAGE) == 0;
+#else
+                (void)hugepages;
+                storage_.resize(bytes_ + ALIGN);
+                base_ = storage_.data() + (ALIGN - reinterpret_cast<std::uintptr_t>(storage_.data()) % ALIGN) % ALIGN;
+#endif
+            }
+            ~buffers()
+            {
+#if defined(__linux__)
+                if (base_) munmap(base_, bytes_);
+#endif
+            }
+            buffers(const buffers&) = delete;
+            buffers& operator=(const buffers&) = delete;
+
+            u8* data() const noexcept { return base_; }
+            bool huge() const noexcept { return huge_; }
+        };
+
+#if defined(__linux__)
+
+        // Minimal io_uring: positioned writes and their completions, nothing else.
+        // Raw system calls, so there is no liburing dependency.
+        class uring {
+            int fd_ = -1;
+            void* sq_ptr_ = MAP_FAILED;
+            void* cq_ptr_ = MAP_FAILED;
+            std::size_t sq_len_ = 0, cq_len_ = 0, sqes_len_ = 0;
+            io_uring_sqe* sqes_ = static_cast<io_uring_sqe*>(MAP_FAILED);
+            unsigned* sq_tail_ = nullptr;
+            unsigned* sq_mask_ = nullptr;
+            unsigned* sq_array_ = nullptr;
+            unsigned* cq_head_ = nullptr;
+            unsigned* cq_tail_ = nullptr;
+            unsigned* cq_mask_ = nullptr;
+            io_uring_cqe* cqes_ = nullptr;
+            unsigned pending_ = 0; // queued, not yet submitted
+
+        public:
+            uring() = default;
+            uring(const uring&) = delete;
+            uring& operator=(const uring&) = delete;
+
+            ~uring()
+            {
+                if (sqes_ != MAP_FAILED) munmap(sqes_, sqes_len_);
+                if (cq_ptr_ != MAP_FAILED && cq_ptr_ != sq_ptr_) munmap(cq_ptr_, cq_len_);
+                if (sq_ptr_ != MAP_FAILED) munmap(sq_ptr_, sq_len_);
+                if (fd_ >= 0) close(fd_);
+            }
+
+            // False when the kernel has no (usable) io_uring
+            bool open(unsigned entries)
+            {
+                io_uring_params p{};
+                fd_ = static_cast<int>(syscall(__NR_io_uring_setup, entries, &p));
+                if (fd_ < 0) return false;
+
+                sq_len_ = p.sq_off.array + p.sq_entries * sizeof(unsigned);
+                cq_len_ = p.cq_off.cqes + p.cq_entries * sizeof(io_uring_cqe);
+                const bool single = (p.features & IORING_FEAT_SINGLE_MMAP) != 0;
+                if (single) sq_len_ = cq_len_ = std::max(sq_len_, cq_len_);
+
+                sq_ptr_ = mmap(nullptr, sq_len_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd_, IORING_OFF_SQ_RING);
+                if (sq_ptr_ == MAP_FAILED) return false;
+                cq_ptr_ = single ? sq_ptr_
+                    : mmap(nullptr, cq_len_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd_, IORING_OFF_CQ_RING);
+                if (cq_ptr_ == MAP_FAILED) return false;
+                sqes_len_ = p.sq_entries * sizeof(io_uring_sqe);
+                sqes_ = static_cast<io_uring_sqe*>(mmap(nullptr, sqes_len_, PROT_READ | PROT_WRITE,
+                    MAP_SHARED | MAP_POPULATE, fd_, IORING_OFF_SQES));
+                if (sqes_ == MAP_FAILED) return false;
+
+                char* sq = static_cast<char*>(sq_ptr_);
+                char* cq = static_cast<char*>(cq_ptr_);
+                sq_tail_ = reinterpret_cast<unsigned*>(sq + p.sq_off.tail);
+                sq_mask_ = reinterpret_cast<unsigned*>(sq + p.sq_off.ring_mask);
+                sq_array_ = reinterpret_cast<unsigned*>(sq + p.sq_off.array);
+                cq_head_ = reinterpret_cast<unsigned*>(cq + p.cq_off.head);
+                cq_tail_ = reinterpret_cast<unsigned*>(cq + p.cq_off.tail);
+                cq_mask_ = reinterpret_cast<unsigned*>(cq + p.cq_off.ring_mask);
+                cqes_ = reinterpret_cast<io_uring_cqe*>(cq + p.cq_off.cqes);
+                return true;
+            }
+
+            // False when registration is refused (RLIMIT_MEMLOCK on older kernels)
+            bool register_buffers(const iovec* iov, unsigned count)
+            {
+                return syscall(__NR_io_uring_register, fd_, IORING_REGISTER_BUFFERS, iov, count) == 0;
+            }
+
+            // Queue a write of 'len' bytes at 'offset'. buf_index >= 0 selects a
+            // registered buffer. The caller keeps at most 'entries' writes in flight.
+            void write(int file, const void* data, unsigned len, u64 offset, int buf_index, u64 user_data)
+            {
+                const unsigned tail = *sq_tail_;
+                const unsigned idx = tail & *sq_mask_;
+                io_uring_sqe& sqe = sqes_[idx];
+                std::memset(&sqe, 0, sizeof(sqe));
+                sqe.opcode = buf_index >= 0 ? IORING_OP_WRITE_FIXED : IORING_OP_WRITE;
+                sqe.fd = file;
+                sqe.addr = reinterpret_cast<u64>(data);
+                sqe.len = len;
+                sqe.off = offset;
+                sqe.buf_index = static_cast<std::uint16_t>(buf_index >= 0 ? buf_index : 0);
+                sqe.user_data = user_data;
+                sq_array_[idx] = idx;
+                std::atomic_ref<unsigned>(*sq_tail_).store(tail + 1, std::memory_order_release);
+                ++pending_;
+            }
+
+            // Submit queued writes; wait until at least 'wait_for' completions are available
+            void submit(unsigned wait_for)
+            {
+                for (;;) {
+                    const long r = syscall(__NR_io_uring_enter, fd_, pending_, wait_for,
+                        wait_for ? IORING_ENTER_GETEVENTS : 0u, nullptr, 0);
+                    if (r >= 0) { pending_ -= static_cast<unsigned>(r); if (!pending_) return; continue; }
+                    if (errno == EINTR) continue;
+                    if (errno == EAGAIN || errno == EBUSY) { wait_for = 1; continue; }
+                    fail("io_uring_enter");
+                }
+            }
+
+            // Next completion, if any: (user_data, result)
+            bool complete(u64& user_data, int& res)
+            {
+                const unsigned head = *cq_head_;
+                if (head == std::atomic_ref<unsigned>(*cq_tail_).load(std::memory_order_acquire))
+                    return false;
+                const io_uring_cqe& cqe = cqes_[head & *cq_mask_];
+                user_data = cqe.user_data;
+                res = cqe.res;
+                std::atomic_ref<unsigned>(*cq_head_).store(head + 1, std::memory_order_release);
+                return true;
+            }
+        };
+
+        // Target file: open, size, positioned writes
+        class target {
+            int fd_ = -1;
+            bool direct_ = false;
+            bool block_device_ = false;
+
+        public:
+            target(const std::string& path, bool direct)
+            {
+                struct stat st {};
+                block_device_ = ::stat(path.c_str(), &st) == 0 && S_ISBLK(st.st_mode);
+                const int flags = O_WRONLY | O_CREAT | O_CLOEXEC; // truncated in prepare()
+                if (direct) {
+                    fd_ = ::open(path.c_str(), flags | O_DIRECT, 0644);
+                    direct_ = fd_ >= 0;
+                }
+                if (fd_ < 0) // EINVAL: no O_DIRECT on this file system
+                    fd_ = ::open(path.c_str(), flags, 0644);
+                if (fd_ < 0) fail("cannot open " + path);
+            }
+            ~target() { if (fd_ >= 0) close(fd_); }
+            target(const target&) = delete;
+            target& operator=(const target&) = delete;
+
+            int fd() const noexcept { return fd_; }
+            bool direct() const noexcept { return direct_; }
+
+            u64 device_size() const
+            {
+                u64 size = 0;
+                if (!block_device_ || ioctl(fd_, BLKGETSIZE64, &size) != 0) return 0;
+                return size;
+            }
+
+            // Regular files are cut (or extended) to the final size up front
+            void prepare(u64 size)
+            {
+                if (!block_device_ && ftruncate(fd_, static_cast<off_t>(size)) != 0) fail("ftruncate");
+            }
+
+            void write_at(const u8* data, std::size_t len, u64 offset)
+            {
+                while (len > 0) {
+                    const ssize_t n = ::pwrite(fd_, data, len, static_cast<off_t>(offset));
+                    if (n < 0 && errno == EINTR) continue;
+                    if (n <= 0) fail("write");
+                    data += n;
+                    len -= static_cast<std::size_t>(n);
+                    offset += static_cast<u64>(n);
+                }
+            }
+
+            // A partial last block cannot go through O_DIRECT
+            void write_tail(const u8* data, std::size_t len, u64 offset)
+            {
+                if (direct_ && (len % ALIGN) != 0) {
+                    fcntl(fd_, F_SETFL, fcntl(fd_, F_GETFL) & ~O_DIRECT);
+                    direct_ = false;
+                }
+                write_at(data, len, offset);
+            }
+
+            void finish(bool sync)
+            {
+                if (sync && fsync(fd_) != 0) fail("fsync");
+            }
+        };
+
+#else
+
+        // Portable target: one FILE shared by the generator threads
+        class target {
+            std::string path_;
+            std::FILE* f_ = nullptr;
+            std::mutex m_;
+
+        public:
+            target(const std::string& path, bool) : path_(path) {}
+            ~target() { if (f_) std::fclose(f_); }
+            target(const target&) = delete;
+            target& operator=(const target&) = delete;
+
+            bool direct() const noexcept { return false; }
+            u64 device_size() const noexcept { return 0; }
+
+            void prepare(u64)
+            {
+                f_ = std::fopen(path_.c_str(), "wb");
+                if (!f_) fail("cannot open " + path_);
+            }
+
+            void write_at(const u8* data, std::size_t len, u64 offset)
+            {
+                std::lock_guard<std::mutex> lock(m_);
+#if defined(_WIN32)
+                const int sought = _fseeki64(f_, static_cast<long long>(offset), SEEK_SET);
+#else
+                const int sought = std::fseek(f_, static_cast<long>(offset), SEEK_SET);
+#endif
+                if (sought != 0 || std::fwrite(data, 1, len, f_) != len) fail("write");
+            }
+            void write_tail(const u8* data, std::size_t len, u64 offset) { write_at(data, len, offset); }
+
+            void finish(bool sync)
+            {
+                if (std::fflush(f_) != 0 && sync) fail("flush");
+            }
+        };
+
+#endif
+
+        // Generator side: hands out blocks in increasing order, each thread
+        // positions its own engine copy with discard().
+        template <class E>
+        class generator {
+            u64 seed_;
+            u64 position_;
+            std::size_t words_per_block_;
+
+        public:
+            generator(u64 seed, u64 position, std::size_t block_bytes)
+                : seed_(seed), position_(position), words_per_block_(block_bytes / sizeof(u64)) {}
+
+            struct cursor {
+                E engine;
+                u64 position = 0; // in words
+            };
+            cursor start() const { return cursor{ E(seed_), 0 }; }
+
+            // Fill 'bytes' (<= block size) of block 'block'. Blocks handed to
+            // one cursor must be increasing.
+            void fill(cursor& c, u64 block, u8* out, std::size_t bytes) const
+            {
+                const u64 target = position_ + block * words_per_block_;
+                if (target > c.position) c.engine.discard(target - c.position);
+                const std::size_t words = (bytes + sizeof(u64) - 1) / sizeof(u64);
+                fill_words(c.engine, reinterpret_cast<u64*>(out), words);
+                c.position = target + words;
+            }
+        };
+
+    } // namespace detail
+
+    template <class E>
+        requires requires(E & e) { e.discard(1ull); }
+    report run(const std::string& path, const config& cfg)
+    {
+        using clock = std::chrono::steady_clock;
+        const auto t0 = clock::now();
+
+        detail::target out(path, cfg.direct && cfg.offset % detail::ALIGN == 0);
+        const u64 total = cfg.bytes ? cfg.bytes : out.device_size();
+        if (total == 0)
+            throw std::runtime_error("file_fill: no size given for " + path);
+        out.prepare(cfg.offset + total);
+
+        // Block size: multiple of 4096, at most MAX_BLOCK, no larger than the
+        // aligned part of the file
+        const std::size_t block = static_cast<std::size_t>(std::max<u64>(detail::ALIGN, std::min<u64>({
+            (std::min<u64>(cfg.block_bytes, detail::MAX_BLOCK) + detail::ALIGN - 1) / detail::ALIGN * detail::ALIGN,
+            detail::MAX_BLOCK,
+            total / detail::ALIGN * detail::ALIGN })));
+        const unsigned threads = std::max(1u, cfg.threads);
+        const unsigned depth = std::max(1u, cfg.queue_depth);
+        const u64 blocks = (total + block - 1) / block;
+        const std::size_t tail_bytes = static_cast<std::size_t>(total - (blocks - 1) * block);
+
+        // Every block but a partial last one goes through the pipeline; that
+        // one may need O_DIRECT turned off and is written at the end.
+        const u64 piped = tail_bytes == block ? blocks : blocks - 1;
+
+        // Enough buffers for 'depth' writes in flight while every thread fills one
+        const std::size_t slots = static_cast<std::size_t>(std::min<u64>(depth + threads, std::max<u64>(piped, 1)));
+        detail::buffers buf(slots, block, cfg.hugepages);
+        const detail::generator<E> gen(cfg.seed, cfg.position, block);
+
+        report rep;
+        rep.bytes = total;
+        rep.hugepages = buf.huge();
+
+        std::mutex m;
+        std::condition_variable cv_free, cv_ready;
+        std::vector<std::size_t> free_slots;
+        for (std::size_t s = slots; s-- > 0;) free_slots.push_back(s);
+        std::vector<std::pair<std::size_t, u64>> ready; // (slot, block)
+        u64 next_block = 0;
+        std::atomic<u64> written{ 0 };
+        bool aborted = false;
+        std::exception_ptr error;
+
+        auto report_progress = [&, last = clock::now()](bool force) mutable {
+            if (!cfg.progress) return;
+            const auto now = clock::now();
+            if (!force && std::chrono::duration<double>(now - last).count() < cfg.progress_interval) return;
+            last = now;
+            cfg.progress(written.load(), total);
+        };
+
+        auto abort_with = [&](std::exception_ptr e) {
+            std::lock_guard<std::mutex> lock(m);
+            if (!error) error = e;
+            aborted = true;
+            cv_free.notify_all();
+            cv_ready.notify_all();
+        };
+
+        // 'write_self': the generator thread writes its block itself (pwrite backend)
+        auto worker = [&](bool write_self) {
+            try {
+                auto cur = gen.start();
+                for (;;) {
+                    std::size_t slot;
+                    u64 b;
+                    {
+                        std::unique_lock<std::mutex> lock(m);
+                        cv_free.wait(lock, [&] { return aborted || next_block == piped || !free_slots.empty(); });
+                        if (aborted || next_block == piped) return;
+                        b = next_block++;
+                        slot = free_slots.back();
+                        free_slots.pop_back();
+                    }
+                    u8* data = buf.data() + slot * block;
+                    gen.fill(cur, b, data, block);
+                    if (write_self) {
+                        out.write_at(data, block, cfg.offset + b * block);
+                        written += block;
+                    }
+                    std::lock_guard<std::mutex> lock(m);
+                    if (write_self) free_slots.push_back(slot);
+                    else ready.emplace_back(slot, b);
+                    cv_free.notify_one();
+                    cv_ready.notify_one();
+                }
+            }
+            catch (...) {
+                abort_with(std::current_exception());
+            }
+        };
+
+        std::vector<std::thread> pool;
+        auto join_all = [&] {
+            for (auto& t : pool)
+                if (t.joinable()) t.join();
+        };
+
+#if defined(__linux__)
+        detail::uring ring;
+        bool use_ring = cfg.io_uring && piped > 0 && ring.open(depth);
+#else
+        const bool use_ring = false;
+#endif
+
+        if (use_ring) {
+#if defined(__linux__)
+            std::vector<iovec> iov(slots);
+            for (std::size_t s = 0; s < slots; ++s)
+                iov[s] = iovec{ buf.data() + s * block, block };
+            const bool fixed = ring.register_buffers(iov.data(), static_cast<unsigned>(slots));
+            rep.backend = fixed ? "io_uring+fixed" : "io_uring";
+
+            for (unsigned t = 0; t < threads; ++t)
+                pool.emplace_back(worker, false);
+
+            // Submission loop: user_data = slot; per-slot progress handles short writes
+            struct flight { u64 block = 0; std::size_t done = 0; };
+            std::vector<flight> fl(slots);
+            auto submit_slot = [&](std::size_t s) {
+                const std::size_t done = fl[s].done;
+                ring.write(out.fd(), buf.data() + s * block + done, static_cast<unsigned>(std::min<std::size_t>(block - done, detail::MAX_BLOCK)),
+                    cfg.offset + fl[s].block * block + done, fixed ? static_cast<int>(s) : -1, s);
+            };
+            u64 completed = 0;
+            unsigned in_flight = 0;
+            // The kernel may still be writing from the buffers: wait for every
+            // write in flight before leaving (and unmapping them)
+            auto drain = [&] {
+                while (in_flight > 0) {
+                    ring.submit(1);
+                    u64 user;
+                    int res;
+                    while (ring.complete(user, res)) --in_flight;
+                }
+            };
+            try {
+                while (completed < piped) {
+                    std::vector<std::pair<std::size_t, u64>> take;
+                    {
+                        std::unique_lock<std::mutex> lock(m);
+                        if (in_flight == 0)
+                            cv_ready.wait(lock, [&] { return aborted || !ready.empty(); });
+                        if (aborted) break;
+                        // Lowest blocks first, so the device sees a mostly sequential stream
+                        std::sort(ready.begin(), ready.end(), [](auto& a, auto& b) { return a.second < b.second; });
+                        const std::size_t n = std::min<std::size_t>(ready.size(), depth - in_flight);
+                        take.assign(ready.begin(), ready.begin() + n);
+                        ready.erase(ready.begin(), ready.begin() + n);
+                    }
+                    for (auto [s, b] : take) {
+                        fl[s] = flight{ b, 0 };
+                        submit_slot(s);
+                    }
+                    in_flight += static_cast<unsigned>(take.size());
+                    // Block for a completion only when nothing else can make progress
+                    ring.submit(take.empty() && in_flight > 0 ? 1u : 0u);
+
+                    u64 user;
+                    int res;
+                    while (ring.complete(user, res)) {
+                        const std::size_t s = static_cast<std::size_t>(user);
+                        if (res <= 0) { --in_flight; errno = res < 0 ? -res : ENOSPC; detail::fail("write"); }
+                        fl[s].done += static_cast<std::size_t>(res);
+                        written += static_cast<u64>(res);
+                        if (fl[s].done < block) { submit_slot(s); continue; } // short write
+                        --in_flight;
+                        ++completed;
+                        std::lock_guard<std::mutex> lock(m);
+                        free_slots.push_back(s);
+                        cv_free.notify_one();
+                    }
+                    report_progress(false);
+                }
+                drain();
+            }
+            catch (...) {
+                abort_with(std::current_exception());
+                try { drain(); } catch (...) {}
+            }
+#endif
+        }
+        else {
+            rep.backend =
+#if defined(__linux__)
+                "pwrite";
+#else
+                "stdio";
+#endif
+            for (unsigned t = 1; t < threads; ++t)
+                pool.emplace_back(worker, true);
+            // The calling thread reports progress while the pool writes
+            std::thread last(worker, true);
+            for (;;) {
+                std::unique_lock<std::mutex> lock(m);
+                const bool done = cv_free.wait_for(lock, std::chrono::duration<double>(std::min(cfg.progress_interval, 0.1)),
+                    [&] { return aborted || written.load() >= piped * block; });
+                lock.unlock();
+                report_progress(false);
+                if (done) break;
+            }
+            last.join();
+        }
+        join_all();
+        if (error) std::rethrow_exception(error);
+
+        rep.direct = out.direct() && piped > 0;
+        if (piped < blocks) {
+            auto cur = gen.start();
+            gen.fill(cur, piped, buf.data(), tail_bytes);
+            out.write_tail(buf.data(), tail_bytes, cfg.offset + piped * block);
+            written += tail_bytes;
+        }
+        out.finish(cfg.sync);
+        report_progress(true);
+
+        rep.seconds = std::chrono::duration<double>(clock::now() - t0).count();
+        return rep;
+    }
+
+} // namespace RNG::file_fill
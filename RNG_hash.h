@@ -0,0 +1,316 @@
+#pragma once
+// file RNG_hash.h
+//
+// Fast non-cryptographic hashing on the engines' mixers (RNG_mix.h).
+//
+//      hash64(x), hash64(x, seed)      64-bit integers: nasam(), a bijection
+//      hash_bytes(data, len, seed)     byte strings, wyhash-style
+//      hasher<T>                       seeded hasher for std::unordered_map
+//                                      and open-addressing tables
+//      reduce(h, n)                    h mapped to [0, n) without a division
+//      bloom_probes(h, k, m, f)        k filter indices from one hash
+//      hash_counter                    hash64 of a counter as an engine, so that
+//                                      rng_battery / rng_stream test the hash
+//
+// hash_bytes
+//      Up to 256 bytes: the wyhash scheme, wymix() of 16-byte pairs, with the
+//      wyhash constants WY_P0..WY_P3 (WY_P0/WY_P1 are wyrand's). Longer inputs
+//      go through 8 accumulators over 64-byte stripes, one 32x32->64 multiply
+//      and two adds per 8 bytes, in AVX2 when compiled for it (the same
+//      result either way). The keys of the stripes depend on the seed.
+//
+// None of these resist an attacker who wants collisions. A seed from
+// platform entropy makes collisions hard to predict in hash tables:
+//      std::unordered_map<std::string, int, RNG::hasher<std::string>, std::equal_to<>>
+//          m(0, RNG::hasher<std::string>(RNG::random_device{}.draw64()));
+
+#define NOMINMAX
+#include <array>
+#include <bit>
+#include <concepts>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <span>
+#include <string_view>
+#include <type_traits>
+
+#include "common.h"
+#include "RNG_mix.h"
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#endif
+
+namespace RNG {
+
+    namespace hash_detail {
+
+        inline u64 read64(const u8* p) noexcept { u64 v; std::memcpy(&v, p, 8); return v; }
+        inline u64 read32(const u8* p) noexcept { u32 v; std::memcpy(&v, p, 4); return v; }
+        inline u64 read_small(const u8* p, std::size_t k) noexcept  // 1 <= k <= 3
+        {
+            return (u64(p[0]) << 16) | (u64(p[k >> 1]) << 8) | p[k - 1];
+        }
+
+        // is_transparent only for string keys: its presence alone enables
+        // heterogeneous lookup in the standard containers
+        template <bool> struct transparent {};
+        template <> struct transparent<true> { using is_transparent = void; };
+
+        // Keys hashed as their characters. Pointers, const char* included,
+        // are hashed by address, as std::hash does, so they are not
+        // transparent: a const char* key equals another by identity
+        template <class T>
+        inline constexpr bool string_key = std::is_convertible_v<const T&, std::string_view> && !std::is_pointer_v<T>;
+
+        // Key of hash64(x, seed)
+        constexpr u64 seed_key(u64 seed) noexcept { return nasam(seed ^ WY_P0); }
+
+        inline constexpr std::size_t STRIPE = 64;               // bytes
+        inline constexpr std::size_t STRIPES_PER_BLOCK = 16;    // stripes between scrambles
+        inline constexpr std::size_t SECRET_WORDS = STRIPES_PER_BLOCK + 8 + 8; // stripe keys, scramble, last stripe
+        inline constexpr std::size_t BULK_MIN = 256;            // longer inputs use the stripes
+
+        inline constexpr std::array<u64, SECRET_WORDS> SECRET = [] {
+            std::array<u64, SECRET_WORDS> s{};
+            for (std::size_t i = 0; i < SECRET_WORDS; ++i)
+                s[i] = nasam(WY_P0 * (i + 1) ^ WY_P1);
+            return s;
+        }();
+
+        inline constexpr u64 SCRAMBLE_MUL = 0x9E3779B1u;  // 32 bits, as one vector multiply
+
+        // acc[i] += lo32(d ^ k) * hi32(d ^ k) and acc[i ^ 1] += d for the 8 words of a stripe
+        inline void accumulate(u64* __restrict acc, const u8* __restrict p, const u64* __restrict key) noexcept
+        {
+#if defined(__AVX2__)
+            for (int h = 0; h < 2; ++h) {
+                __m256i a = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(acc + 4 * h));
+                const __m256i d = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p + 32 * h));
+                const __m256i dk = _mm256_xor_si256(d, _mm256_loadu_si256(reinterpret_cast<const __m256i*>(key + 4 * h)));
+                const __m256i prod = _mm256_mul_epu32(dk, _mm256_srli_epi64(dk, 32));
+                a = _mm256_add_epi64(a, _mm256_shuffle_epi32(d, _MM_SHUFFLE(1, 0, 3, 2))); // d[i ^ 1]
+                _mm256_storeu_si256(reinterpret_cast<__m256i*>(acc + 4 * h), _mm256_add_epi64(a, prod));
+            }
+#else
+            for (std::size_t i = 0; i < 8; ++i) {
+                const u64 d = read64(p + 8 * i);
+                const u64 dk = d ^ key[i];
+                acc[i ^ 1] += d;
+                acc[i] += (dk & 0xffffffffu) * (dk >> 32);
+            }
+#endif
+        }
+
+        inline void scramble(u64* __restrict acc, const u64* __restrict key) noexcept
+        {
+#if defined(__AVX2__)
+            const __m256i m = _mm256_set1_epi64x(SCRAMBLE_MUL);
+            for (int h = 0; h < 2; ++h) {
+                __m256i a = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(acc + 4 * h));
+                a = _mm256_xor_si256(a, _mm256_srli_epi64(a, 47));
+                a = _mm256_xor_si256(a, _mm256_loadu_si256(reinterpret_cast<const __m256i*>(key + 4 * h)));
+                const __m256i lo = _mm256_mul_epu32(a, m);
+                const __m256i hi = _mm256_slli_epi64(_mm256_mul_epu32(_mm256_srli_epi64(a, 32), m), 32);
+                _mm256_storeu_si256(reinterpret_cast<__m256i*>(acc + 4 * h), _mm256_add_epi64(lo, hi));
+            }
+#else
+            for (std::size_t i = 0; i < 8; ++i) {
+                u64 a = acc[i];
+                a ^= a >> 47;
+                a ^= key[i];
+                acc[i] = a * SCRAMBLE_MUL;
+            }
+#endif
+        }
+
+        // len > BULK_MIN; seed already mixed
+        inline u64 hash_long(const u8* p, std::size_t len, u64 seed) noexcept
+        {
+            std::array<u64, SECRET_WORDS> key;
+            for (std::size_t i = 0; i < SECRET_WORDS; ++i)
+                key[i] = SECRET[i] + ((i & 1) ? seed : 0 - seed);
+
+            alignas(32) u64 acc[8];
+            for (std::size_t i = 0; i < 8; ++i)
+                acc[i] = SECRET[i] ^ seed;
+
+            // every stripe but the last 1..64 bytes
+            const std::size_t stripes = (len - 1) / STRIPE;
+            std::size_t s = 0;
+            for (; s + STRIPES_PER_BLOCK <= stripes; s += STRIPES_PER_BLOCK) {
+                for (std::size_t j = 0; j < STRIPES_PER_BLOCK; ++j)
+                    accumulate(acc, p + (s + j) * STRIPE, key.data() + j);
+                scramble(acc, key.data() + STRIPES_PER_BLOCK);
+            }
+            for (std::size_t j = 0; s + j < stripes; ++j)
+                accumulate(acc, p + (s + j) * STRIPE, key.data() + j);
+            accumulate(acc, p + len - STRIPE, key.data() + STRIPES_PER_BLOCK + 8);
+
+            u64 h = seed ^ (len * WY_P1);
+            h ^= wymix(acc[0] ^ WY_P0, acc[1] ^ WY_P1);
+            h ^= wymix(acc[2] ^ WY_P2, acc[3] ^ WY_P3);
+            h = wymix(h ^ WY_P0, h ^ WY_P2);
+            h ^= wymix(acc[4] ^ WY_P1, acc[5] ^ WY_P2);
+            h ^= wymix(acc[6] ^ WY_P3, acc[7] ^ WY_P0);
+            return nasam(h);
+        }
+
+    } // namespace hash_detail
+
+    // Bijective 64-bit integer hash (distinct inputs, distinct outputs)
+    [[nodiscard]] constexpr u64 hash64(u64 x) noexcept { return nasam(x); }
+
+    // Seeded: a different bijection for every seed
+    [[nodiscard]] constexpr u64 hash64(u64 x, u64 seed) noexcept { return nasam(x ^ hash_detail::seed_key(seed)); }
+
+    // Hash of len bytes at data
+    [[nodiscard]] inline u64 hash_bytes(const void* data, std::size_t len, u64 seed = 0) noexcept
+    {
+        using namespace hash_detail;
+        const u8* p = static_cast<const u8*>(data);
+        seed ^= wymix(seed ^ WY_P0, WY_P1);
+        if (len > BULK_MIN)
+            return hash_long(p, len, seed);
+
+        u64 a, b;
+        if (len <= 16) {
+            if (len >= 4) {
+                const std::size_t m = (len >> 3) << 2;
+                a = (read32(p) << 32) | read32(p + m);
+                b = (read32(p + len - 4) << 32) | read32(p + len - 4 - m);
+            }
+            else if (len > 0) {
+                a = read_small(p, len);
+                b = 0;
+            }
+            else {
+                a = b = 0;
+            }
+        }
+        else {
+            std::size_t i = len;
+            if (i > 48) {
+                u64 see1 = seed, see2 = seed;
+                do {
+                    seed = wymix(read64(p) ^ WY_P1, read64(p + 8) ^ seed);
+                    see1 = wymix(read64(p + 16) ^ WY_P2, read64(p + 24) ^ see1);
+                    see2 = wymix(read64(p + 32) ^ WY_P3, read64(p + 40) ^ see2);
+                    p += 48;
+                    i -= 48;
+                } while (i > 48);
+                seed ^= see1 ^ see2;
+            }
+            while (i > 16) {
+                seed = wymix(read64(p) ^ WY_P1, read64(p + 8) ^ seed);
+                i -= 16;
+                p += 16;
+            }
+            a = read64(p + i - 16);
+            b = read64(p + i - 8);
+        }
+        a ^= WY_P1;
+        b ^= seed;
+        u64 hi;
+        a = umul128(a, b, &hi);
+        b = hi;
+        return wymix(a ^ WY_P0 ^ len, b ^ WY_P1);
+    }
+
+    [[nodiscard]] inline u64 hash_bytes(std::span<const std::byte> data, u64 seed = 0) noexcept
+    {
+        return hash_bytes(data.data(), data.size(), seed);
+    }
+
+    [[nodiscard]] inline u64 hash_bytes(std::string_view s, u64 seed = 0) noexcept
+    {
+        return hash_bytes(s.data(), s.size(), seed);
+    }
+
+    // Seeded hasher: integers, enums, pointers and floating point through
+    // hash64, strings (transparent: find() takes any string_view-convertible
+    // key with std::equal_to<>) and other types without padding through
+    // hash_bytes. A const char* is a pointer, hashed by address; use
+    // std::string_view keys to hash C strings by content. The seed defaults
+    // to 0, the same in every run.
+    template <class T>
+    struct hasher : hash_detail::transparent<hash_detail::string_key<T>> {
+        u64 key;
+
+        constexpr hasher() noexcept : hasher(0) {}
+        constexpr explicit hasher(u64 seed) noexcept : key(hash_detail::seed_key(seed)) {}
+
+        std::size_t operator()(const T& v) const noexcept
+        {
+            if constexpr (std::is_integral_v<T> || std::is_enum_v<T>)
+                return static_cast<std::size_t>(nasam(static_cast<u64>(v) ^ key));
+            else if constexpr (std::is_pointer_v<T>)
+                return static_cast<std::size_t>(nasam(reinterpret_cast<std::uintptr_t>(v) ^ key));
+            else if constexpr (std::is_floating_point_v<T> && sizeof(T) <= 8) {
+                const T x = (v == T(0)) ? T(0) : v;  // -0.0 == 0.0
+                u64 bits = 0;
+                std::memcpy(&bits, &x, sizeof(x));
+                return static_cast<std::size_t>(nasam(bits ^ key));
+            }
+            else if constexpr (hash_detail::string_key<T>)
+                return static_cast<std::size_t>(hash_bytes(std::string_view(v), key));
+            else {
+                static_assert(std::has_unique_object_representations_v<T>,
+                    "RNG::hasher: no hash for this type (padding bits); specialize RNG::hasher");
+                return static_cast<std::size_t>(hash_bytes(&v, sizeof(T), key));
+            }
+        }
+
+        // Heterogeneous lookup for string keys
+        template <class S>
+            requires hash_detail::string_key<T>
+                && std::is_convertible_v<const S&, std::string_view> && (!std::is_same_v<S, T>)
+        std::size_t operator()(const S& s) const noexcept
+        {
+            return static_cast<std::size_t>(hash_bytes(std::string_view(s), key));
+        }
+    };
+
+    // h mapped to [0, n), from the high bits of h (Lemire's multiply-shift):
+    // bucket or slot index for open addressing, no division
+    [[nodiscard]] inline u64 reduce(u64 h, u64 n) noexcept
+    {
+        u64 hi;
+        umul128(h, n, &hi);
+        return hi;
+    }
+
+    // Calls f(index) for the k probe positions of hash h in a Bloom filter of
+    // m bits, with enhanced double hashing (Dillinger and Manolios): two
+    // 64-bit hashes derived from h, a + i*b + (i^3 - i)/6.
+    template <class F>
+    inline void bloom_probes(u64 h, unsigned k, u64 m, F&& f)
+    {
+        u64 a = h;
+        u64 b = nasam(h ^ WY_P2);
+        for (unsigned i = 0; i < k; ++i) {
+            f(reduce(a, m));
+            a += b;
+            b += i;
+        }
+    }
+
+    // Output n is hash64(n, seed), as an engine for the statistical tests
+    class hash_counter {
+        u64 key;
+        u64 n = 0;
+
+    public:
+        using result_type = u64;
+
+        explicit hash_counter(u64 seed) noexcept : key(hash_detail::seed_key(seed)) {}
+
+        u64 operator()() noexcept { return nasam(n++ ^ key); }
+        void discard(u64 k) noexcept { n += k; }
+
+        static constexpr result_type min() noexcept { return 0; }
+        static constexpr result_type max() noexcept { return ~result_type(0); }
+    };
+
+} // namespace RNG
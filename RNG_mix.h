@@ -0,0 +1,143 @@
+#pragma once
+// file RNG_mix.h
+//
+// The 64-bit mixers of the library, shared by the engines and RNG_hash.h:
+//
+//      nasam(v)        bijective mixer of Nasam1024 (and of the hashes)
+//      wymix(a, b)     lo ^ hi of the 128-bit product a * b, the fold of
+//                      wyrand and fast
+//      WY_P0 .. WY_P3  the wyhash / wyrand constants: WY_P0 is the
+//                      increment of wyrand and fast, WY_P1 their MIX
+//
+// nasam() also takes SIMD lanes, for the kernels that hash in bulk
+// (RNG_sketch.h, RNG_noise.h): __m512i with AVX-512F/DQ, __m256i with AVX2,
+// which has no 64-bit multiply (each is built from three 32-bit ones).
+// Every lane gets the scalar result.
+
+#define NOMINMAX
+#include <bit>         // std::rotr
+#include <cstdint>
+
+#include "common.h"
+
+#if defined(__AVX2__) || defined(__AVX512F__)
+#include <immintrin.h>
+#endif
+
+namespace RNG {
+
+    inline constexpr u64 WY_P0 = 0x2d358dccaa6c78a5ull;
+    inline constexpr u64 WY_P1 = 0x8bb84b93962eacc9ull;
+    inline constexpr u64 WY_P2 = 0x4b33a62ed433d4a3ull;
+    inline constexpr u64 WY_P3 = 0x4d5a2da51de1aa47ull;
+
+    inline u64 wymix(u64 a, u64 b) noexcept
+    {
+        u64 hi;
+        const u64 lo = umul128(a, b, &hi);
+        return lo ^ hi;
+    }
+
+    /*
+    NASAM (Not Another Strange Adding Mixer) - 64-bit Variant
+
+    Mixer: Strong triple-multiply 64-bit unary mixer
+        Inspired by Pelle Evensen's high-quality non-cryptographic mixers
+        (rrmxmx constant 0x9FB21C651E98DF25 and overall strong mixing patterns)
+        See: http://mostlymangling.blogspot.com/
+        Golden-ratio-derived multipliers common in hashing/PRNG literature
+    */
+    [[nodiscard]] inline constexpr uint64_t nasam(uint64_t v) noexcept {
+        /*
+        History (ignore if you want):
+
+        Here is the original version by Pelle Evensen.
+        Source: https://mostlymangling.blogspot.com/2020/01/nasam-not-another-strange-acronym-mixer.html
+
+            uint64_t nasam(uint64_t x) {
+                // ror64(a, r) is a 64-bit rotation of a by r bits.
+                x ^= ror64(x, 25) ^ ror64(x, 47);
+                x *= 0x9E6C63D0676A9A99UL;
+                x ^= x >> 23 ^ x >> 51;
+                x *= 0x9E6D62D06F6A9A9BUL;
+                x ^= x >> 23 ^ x >> 51;
+
+                return x;
+            }
+        Note that his version differs from mine in constants and other details,
+        but he gets the credit for developing the general pattern.
+        */
+        v *= 0x9E6F1D9BB2D6C165ULL;
+        v ^= std::rotr(v, 26);
+        v *= 0x9E6F1D9BB2D6C165ULL;
+        v ^= std::rotr(v, 47) ^ std::rotr(v, 21);
+        v *= 0x9FB21C651E98DF25ULL; // Strong multiplier popularized in rrmxmx 
+        // (orig. xxHash prime)
+        return v ^ (v >> 28);
+    }
+
+    namespace mix_detail {
+        inline constexpr u64 NASAM_M1 = 0x9E6F1D9BB2D6C165ULL;
+        inline constexpr u64 NASAM_M2 = 0x9FB21C651E98DF25ULL;
+
+#if defined(__AVX2__)
+        // v * c mod 2^64 from three 32x32->64 multiplies
+        inline __m256i mul_const(__m256i v, u64 c) noexcept
+        {
+            const __m256i lo = _mm256_mul_epu32(v, _mm256_set1_epi64x(static_cast<long long>(c)));
+            const __m256i cross = _mm256_add_epi64(
+                _mm256_mul_epu32(_mm256_srli_epi64(v, 32), _mm256_set1_epi64x(static_cast<long long>(c))),
+                _mm256_mul_epu32(v, _mm256_set1_epi64x(static_cast<long long>(c >> 32))));
+            return _mm256_add_epi64(lo, _mm256_slli_epi64(cross, 32));
+        }
+
+        template <int R>
+        inline __m256i rotr(__m256i v) noexcept
+        {
+            return _mm256_or_si256(_mm256_srli_epi64(v, R), _mm256_slli_epi64(v, 64 - R));
+        }
+#endif
+
+#if defined(__AVX512F__) && defined(__AVX512DQ__)
+        // 64-bit lane shifts, rotation and 32x32->64 multiply for the
+        // AVX-512 kernels (here, RNG_engine_array.h, RNG_noise.h). The maskz
+        // forms with a full mask are the plain instructions; they avoid GCC
+        // 12's spurious -Wmaybe-uninitialized on the unmasked ones.
+        template <int N>
+        inline __m512i srli(__m512i v) noexcept { return _mm512_maskz_srli_epi64(0xff, v, N); }
+        template <int N>
+        inline __m512i slli(__m512i v) noexcept { return _mm512_maskz_slli_epi64(0xff, v, N); }
+        template <int R>
+        inline __m512i rotr(__m512i v) noexcept { return _mm512_maskz_ror_epi64(0xff, v, R); }
+        inline __m512i mul32(__m512i a, __m512i b) noexcept { return _mm512_maskz_mul_epu32(0xff, a, b); }
+#endif
+    } // namespace mix_detail
+
+#if defined(__AVX2__)
+    inline __m256i nasam(__m256i v) noexcept
+    {
+        using namespace mix_detail;
+        v = mul_const(v, NASAM_M1);
+        v = _mm256_xor_si256(v, rotr<26>(v));
+        v = mul_const(v, NASAM_M1);
+        v = _mm256_xor_si256(v, _mm256_xor_si256(rotr<47>(v), rotr<21>(v)));
+        v = mul_const(v, NASAM_M2);
+        return _mm256_xor_si256(v, _mm256_srli_epi64(v, 28));
+    }
+#endif
+
+#if defined(__AVX512F__) && defined(__AVX512DQ__)
+    inline __m512i nasam(__m512i v) noexcept
+    {
+        using namespace mix_detail;
+        const __m512i m1 = _mm512_set1_epi64(static_cast<long long>(NASAM_M1));
+        v = _mm512_mullo_epi64(v, m1);
+        v = _mm512_xor_si512(v, rotr<26>(v));
+        v = _mm512_mullo_epi64(v, m1);
+        v = _mm512_ternarylogic_epi64(v, rotr<47>(v), rotr<21>(v), 0x96);
+        v = _mm512_mullo_epi64(v, _mm512_set1_epi64(static_cast<long long>(NASAM_M2)));
+        return _mm512_xor_si512(v, srli<28>(v));
+    }
+#endif
+
+} // namespace RNG
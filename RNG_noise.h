@@ -0,0 +1,509 @@
+#pragma once
+// file RNG_noise.h
+//
+// Stateless procedural noise: value, gradient (Perlin-style) and simplex
+// noise in 1 to 4 dimensions, with fractal octaves, for terrain, textures
+// and other procedural content.
+//
+// There is no permutation table. The value or gradient at a lattice point is
+// the keyed nasam hash of its integer coordinates (RNG_mix.h), so a noise
+// object is two words, changing the seed costs nothing, and the lookups
+// never miss the cache. Lattice coordinates wrap at 2^32 cells; inputs must
+// stay below 2^51 in magnitude.
+//
+//      RNG::noise n(world_seed);
+//      double h = n.simplex(x, y);                     // in about [-1, 1]
+//      double t = n.fbm(RNG::noise_kind::gradient, { .octaves = 6 }, x, y, z);
+//      n.evaluate(RNG::noise_kind::simplex, xs, ys, heights, { .octaves = 5 });
+//
+// Ranges: value noise is in [-1, 1), gradient noise in [-1, 1] (random
+// gradients in the unit cube, scaled by 2 / dimensions), simplex noise in
+// about [-1, 1]. fbm() divides by the sum of the octave amplitudes and so
+// keeps the range. Each octave has its own key, mixed from the seed and the
+// octave number; there are at most 32 octaves.
+//
+// evaluate() computes a whole array of points in SIMD, 8 per step with
+// AVX-512F/DQ, 4 with AVX2 (chosen at compile time); the hashes are the
+// same as in the scalar calls, the results equal up to rounding.
+
+#define NOMINMAX
+#include <array>
+#include <bit>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <initializer_list>
+#include <span>
+#include <stdexcept>
+#include <utility>
+
+#include "common.h"
+#include "RNG_mix.h"
+#include "RNG_hash.h"
+
+#if defined(__AVX2__) || defined(__AVX512F__)
+#include <immintrin.h>
+#endif
+
+namespace RNG {
+
+    enum class noise_kind { value, gradient, simplex };
+
+    // Octaves of fbm(): frequency times 'lacunarity' and amplitude times
+    // 'gain' from one octave to the next. One octave is the plain noise;
+    // 1 to 32 octaves.
+    struct fractal {
+        unsigned octaves = 1;
+        double lacunarity = 2.0;
+        double gain = 0.5;
+    };
+
+    namespace noise_detail {
+
+        using RNG::nasam;
+
+        inline constexpr u64 LOW32 = 0xffffffffULL;
+        inline constexpr u64 ONE = 0x3ff0000000000000ULL;  // bits of 1.0
+        inline constexpr double ROUND = 0x1.8p52;         // f + ROUND has f mod 2^51 in its low bits
+
+        // Scalar lanes: double and u64. The kernels below are templates
+        // over the lane types and call these by overload.
+        inline double floor_(double x) noexcept { return std::floor(x); }
+        inline double step(double a, double b) noexcept { return static_cast<double>(a >= b); }  // no branch
+        inline u64 bits(double x) noexcept { return std::bit_cast<u64>(x); }
+        inline double from_bits(u64 x) noexcept { return std::bit_cast<double>(x); }
+        template <int N> inline u64 shl(u64 x) noexcept { return x << N; }
+        template <int N> inline u64 shr(u64 x) noexcept { return x >> N; }
+
+#if defined(__AVX512F__) && defined(__AVX512DQ__)
+        inline constexpr std::size_t LANES = 8;
+
+        struct vd {
+            __m512d v;
+            vd() noexcept = default;
+            vd(__m512d a) noexcept : v(a) {}
+            vd(double a) noexcept : v(_mm512_set1_pd(a)) {}
+        };
+        struct vu {
+            __m512i v;
+            vu() noexcept = default;
+            explicit vu(__m512i a) noexcept : v(a) {}
+            explicit vu(u64 a) noexcept : v(_mm512_set1_epi64(static_cast<long long>(a))) {}
+        };
+
+        inline vd operator+(vd a, vd b) noexcept { return _mm512_add_pd(a.v, b.v); }
+        inline vd operator-(vd a, vd b) noexcept { return _mm512_sub_pd(a.v, b.v); }
+        inline vd operator*(vd a, vd b) noexcept { return _mm512_mul_pd(a.v, b.v); }
+        inline vu operator^(vu a, vu b) noexcept { return vu(_mm512_xor_si512(a.v, b.v)); }
+        inline vu operator|(vu a, vu b) noexcept { return vu(_mm512_or_si512(a.v, b.v)); }
+        inline vu operator&(vu a, vu b) noexcept { return vu(_mm512_and_si512(a.v, b.v)); }
+
+        // full-mask maskz forms, as in mix_detail
+        inline vd floor_(vd x) noexcept { return _mm512_maskz_roundscale_pd(0xff, x.v, _MM_FROUND_TO_NEG_INF | _MM_FROUND_NO_EXC); }
+        inline vd step(vd a, vd b) noexcept { return _mm512_maskz_mov_pd(_mm512_cmp_pd_mask(a.v, b.v, _CMP_GE_OQ), _mm512_set1_pd(1.0)); }
+        inline vu bits(vd x) noexcept { return vu(_mm512_castpd_si512(x.v)); }
+        inline vd from_bits(vu x) noexcept { return _mm512_castsi512_pd(x.v); }
+        template <int N> inline vu shl(vu x) noexcept { return vu(mix_detail::slli<N>(x.v)); }
+        template <int N> inline vu shr(vu x) noexcept { return vu(mix_detail::srli<N>(x.v)); }
+        inline vu nasam(vu x) noexcept { return vu(RNG::nasam(x.v)); }
+
+        inline vd load(const double* p) noexcept { return _mm512_loadu_pd(p); }
+        inline void store(double* p, vd x) noexcept { _mm512_storeu_pd(p, x.v); }
+#elif defined(__AVX2__)
+        inline constexpr std::size_t LANES = 4;
+
+        struct vd {
+            __m256d v;
+            vd() noexcept = default;
+            vd(__m256d a) noexcept : v(a) {}
+            vd(double a) noexcept : v(_mm256_set1_pd(a)) {}
+        };
+        struct vu {
+            __m256i v;
+            vu() noexcept = default;
+            explicit vu(__m256i a) noexcept : v(a) {}
+            explicit vu(u64 a) noexcept : v(_mm256_set1_epi64x(static_cast<long long>(a))) {}
+        };
+
+        inline vd operator+(vd a, vd b) noexcept { return _mm256_add_pd(a.v, b.v); }
+        inline vd operator-(vd a, vd b) noexcept { return _mm256_sub_pd(a.v, b.v); }
+        inline vd operator*(vd a, vd b) noexcept { return _mm256_mul_pd(a.v, b.v); }
+        inline vu operator^(vu a, vu b) noexcept { return vu(_mm256_xor_si256(a.v, b.v)); }
+        inline vu operator|(vu a, vu b) noexcept { return vu(_mm256_or_si256(a.v, b.v)); }
+        inline vu operator&(vu a, vu b) noexcept { return vu(_mm256_and_si256(a.v, b.v)); }
+
+        inline vd floor_(vd x) noexcept { return _mm256_floor_pd(x.v); }
+        inline vd step(vd a, vd b) noexcept { return _mm256_and_pd(_mm256_cmp_pd(a.v, b.v, _CMP_GE_OQ), _mm256_set1_pd(1.0)); }
+        inline vu bits(vd x) noexcept { return vu(_mm256_castpd_si256(x.v)); }
+        inline vd from_bits(vu x) noexcept { return _mm256_castsi256_pd(x.v); }
+        template <int N> inline vu shl(vu x) noexcept { return vu(_mm256_slli_epi64(x.v, N)); }
+        template <int N> inline vu shr(vu x) noexcept { return vu(_mm256_srli_epi64(x.v, N)); }
+        inline vu nasam(vu x) noexcept { return vu(RNG::nasam(x.v)); }
+
+        inline vd load(const double* p) noexcept { return _mm256_loadu_pd(p); }
+        inline void store(double* p, vd x) noexcept { _mm256_storeu_pd(p, x.v); }
+#else
+        inline constexpr std::size_t LANES = 1;
+
+        using vd = double;
+        using vu = u64;
+
+        inline double load(const double* p) noexcept { return *p; }
+        inline void store(double* p, double x) noexcept { *p = x; }
+#endif
+
+        // Lattice coordinate of an integral double, mod 2^32
+        template <class D>
+        inline auto lattice(D f) noexcept
+        {
+            using U = decltype(bits(f));
+            return bits(f + ROUND) & U(LOW32);
+        }
+
+        // 52 random bits (the low ones of m) -> [-1, 1)
+        template <class U>
+        inline auto unit(U m) noexcept { return from_bits(m | U(ONE)) * 2.0 - 3.0; }
+
+        // Value at a lattice point: the top 52 bits of its hash
+        template <class U>
+        inline auto value_at(U h) noexcept { return unit(shr<12>(h)); }
+
+        // Component I of the gradient at a lattice point: 16-bit field I of
+        // its hash, in [-1, 1)
+        template <int I, class U>
+        inline auto gradient_at(U h) noexcept
+        {
+            constexpr int S = 36 - 16 * I;
+            const U field(0xffffULL << 36);
+            if constexpr (S >= 0) return unit(shl<S>(h) & field);
+            else return unit(shr<-S>(h) & field);
+        }
+
+        template <int N, class U, class D>
+        inline D dot(U h, const D (&d)[N]) noexcept
+        {
+            D r = gradient_at<0>(h) * d[0];
+            if constexpr (N > 1) r = r + gradient_at<1>(h) * d[1];
+            if constexpr (N > 2) r = r + gradient_at<2>(h) * d[2];
+            if constexpr (N > 3) r = r + gradient_at<3>(h) * d[3];
+            return r;
+        }
+
+        template <class D>
+        inline D fade(D t) noexcept { return t * t * t * (t * (t * 6.0 - 15.0) + 10.0); }
+
+        template <class D>
+        inline D lerp(D a, D b, D t) noexcept { return a + t * (b - a); }
+
+        // f(std::integral_constant<int, I>()) for I = 0 .. N - 1: the loops
+        // over axes and corners, unrolled so that the hashes of all corners
+        // are computed side by side and the corner offsets are constants
+        template <int N, class F>
+        inline void unroll(F&& f)
+        {
+            [&]<int... I>(std::integer_sequence<int, I...>) {
+                (f(std::integral_constant<int, I>()), ...);
+            }(std::make_integer_sequence<int, N>());
+        }
+
+        // Hash of a lattice point: x and y packed in one word, z and w in a
+        // second one, hashed after the first
+        template <int N, class U>
+        inline U corner_hash(U key, const U (&c)[N]) noexcept
+        {
+            if constexpr (N == 1) return nasam(key ^ c[0]);
+            else {
+                const U xy = nasam(key ^ (shl<32>(c[0]) | c[1]));
+                if constexpr (N == 2) return xy;
+                else if constexpr (N == 3) return nasam(xy ^ c[2]);
+                else return nasam(xy ^ (shl<32>(c[2]) | c[3]));
+            }
+        }
+
+        // Value (GRADIENT = false) or gradient noise: 2^N corners, with
+        // quintic interpolation. Corner k is on the high side of axis i if
+        // bit i of k is set.
+        template <bool GRADIENT, int N, class D, class U>
+        inline D lattice_noise(const D (&p)[N], U key) noexcept
+        {
+            constexpr int CORNERS = 1 << N;
+            D t[2][N], s[N];  // offsets from the low and the high side
+            U c[N][2];        // lattice coordinates of both sides
+            unroll<N>([&](auto i) {
+                const D f = floor_(p[i]);
+                t[0][i] = p[i] - f;
+                t[1][i] = t[0][i] - 1.0;
+                s[i] = fade(t[0][i]);
+                c[i][0] = lattice(f);
+                c[i][1] = lattice(f + 1.0);
+            });
+            // corner_hash() for all corners, with the x-y hashes shared
+            U h[CORNERS];
+            if constexpr (N == 1) {
+                unroll<2>([&](auto k) { h[k] = nasam(key ^ c[0][k]); });
+            }
+            else {
+                U xy[4];
+                unroll<4>([&](auto k) { xy[k] = nasam(key ^ (shl<32>(c[0][k & 1]) | c[1][k >> 1])); });
+                if constexpr (N == 2)
+                    unroll<4>([&](auto k) { h[k] = xy[k]; });
+                else if constexpr (N == 3)
+                    unroll<8>([&](auto k) { h[k] = nasam(xy[k & 3] ^ c[2][k >> 2]); });
+                else
+                    unroll<16>([&](auto k) { h[k] = nasam(xy[k & 3] ^ (shl<32>(c[2][(k >> 2) & 1]) | c[3][k >> 3])); });
+            }
+            D n[CORNERS];
+            unroll<CORNERS>([&](auto k) {
+                if constexpr (GRADIENT) {
+                    D d[N];
+                    unroll<N>([&](auto i) { d[i] = t[(k >> i) & 1][i]; });
+                    n[k] = dot(h[k], d);
+                }
+                else {
+                    n[k] = value_at(h[k]);
+                }
+            });
+            // Interpolate along x first: corners 2k and 2k + 1 differ in x
+            unroll<N>([&](auto i) {
+                unroll<(CORNERS >> (decltype(i)::value + 1))>([&](auto k) {
+                    n[k] = lerp(n[2 * k], n[2 * k + 1], s[i]);
+                });
+            });
+            if constexpr (GRADIENT) return n[0] * (2.0 / N);
+            else return n[0];
+        }
+
+        // Skew factors F and G of the simplex grid (F = G = 0 in 1D), the
+        // squared radius of a corner's kernel and the output scale
+        template <int N> struct simplex_constants;
+        template <> struct simplex_constants<1> {
+            static constexpr double F = 0.0, G = 0.0, R2 = 1.0, SCALE = 3.2;
+        };
+        template <> struct simplex_constants<2> {
+            static constexpr double F = 0.36602540378443864676, G = 0.21132486540518711775, R2 = 0.5, SCALE = 70.0;
+        };
+        template <> struct simplex_constants<3> {
+            static constexpr double F = 1.0 / 3.0, G = 1.0 / 6.0, R2 = 0.5, SCALE = 66.0;
+        };
+        template <> struct simplex_constants<4> {
+            static constexpr double F = 0.30901699437494742410, G = 0.13819660112501051518, R2 = 0.5, SCALE = 60.0;
+        };
+
+        // Simplex noise: N + 1 corners, each weighted by (R2 - |d|^2)^4
+        template <int N, class D, class U>
+        inline D simplex_noise(const D (&p)[N], U key) noexcept
+        {
+            using K = simplex_constants<N>;
+            D s = p[0];
+            unroll<N - 1>([&](auto i) { s = s + p[i + 1]; });
+            s = s * K::F;
+            D f[N];
+            unroll<N>([&](auto i) { f[i] = floor_(p[i] + s); });
+            D t = f[0];
+            unroll<N - 1>([&](auto i) { t = t + f[i + 1]; });
+            t = t * K::G;
+            D x0[N], rank[N];
+            unroll<N>([&](auto i) {
+                x0[i] = p[i] - (f[i] - t);
+                rank[i] = 0.0;
+            });
+            // rank[i]: how many other offsets x0[i] exceeds (ties to the lower
+            // index); the simplex steps along the largest first
+            unroll<N>([&](auto i) {
+                unroll<N - 1 - decltype(i)::value>([&](auto jj) {
+                    constexpr int j = decltype(i)::value + 1 + decltype(jj)::value;
+                    const D g = step(x0[i], x0[j]);
+                    rank[i] = rank[i] + g;
+                    rank[j] = rank[j] + (1.0 - g);
+                });
+            });
+            D sum = 0.0;
+            unroll<N + 1>([&](auto k) {
+                U c[N];
+                D d[N];
+                D r2 = K::R2;
+                unroll<N>([&](auto i) {
+                    D o;
+                    if constexpr (k == 0) o = 0.0;
+                    else if constexpr (k == N) o = 1.0;
+                    else o = step(rank[i], D(double(N - k)));
+                    c[i] = lattice(f[i] + o);
+                    d[i] = x0[i] - o + k * K::G;
+                    r2 = r2 - d[i] * d[i];
+                });
+                r2 = r2 * step(r2, D(0.0));   // 0 outside the kernel's radius, without a branch
+                r2 = r2 * r2;
+                sum = sum + r2 * r2 * dot(corner_hash(key, c), d);
+            });
+            return sum * K::SCALE;
+        }
+
+        template <noise_kind K, int N, class D, class U>
+        inline D eval(const D (&p)[N], U key) noexcept
+        {
+            if constexpr (K == noise_kind::value) return lattice_noise<false>(p, key);
+            else if constexpr (K == noise_kind::gradient) return lattice_noise<true>(p, key);
+            else return simplex_noise(p, key);
+        }
+
+        inline constexpr unsigned MAX_OCTAVES = 32;
+
+        // Key of octave o: the plain noise's for o = 0, then from hash64(o,
+        // seed), so that neighbouring seeds do not share octaves
+        constexpr u64 octave_key(u64 seed, unsigned o) noexcept
+        {
+            return hash_detail::seed_key(o == 0 ? seed : hash64(o, seed));
+        }
+
+        // Octave keys and the amplitude normalization of a fractal, on the
+        // stack: fbm() on one point allocates nothing
+        struct octaves {
+            std::array<u64, MAX_OCTAVES> keys;
+            unsigned count;
+            double norm;
+
+            octaves(u64 seed, const fractal& f)
+                : count(f.octaves)
+            {
+                if (f.octaves == 0) throw std::invalid_argument("noise: fractal with zero octaves");
+                if (f.octaves > MAX_OCTAVES) throw std::invalid_argument("noise: fractal with more than 32 octaves");
+                double amplitude = 1.0, total = 0.0;
+                for (unsigned o = 0; o < f.octaves; ++o) {
+                    keys[o] = octave_key(seed, o);
+                    total += amplitude;
+                    amplitude *= f.gain;
+                }
+                norm = 1.0 / total;
+            }
+        };
+
+        template <noise_kind K, int N, class D>
+        inline D fbm(const D (&p)[N], const octaves& o, const fractal& f) noexcept
+        {
+            using U = decltype(bits(p[0]));
+            D sum = eval<K>(p, U(o.keys[0]));
+            double frequency = 1.0, amplitude = 1.0;
+            for (unsigned k = 1; k < o.count; ++k) {
+                frequency *= f.lacunarity;
+                amplitude *= f.gain;
+                D q[N];
+                for (int i = 0; i < N; ++i) q[i] = p[i] * frequency;
+                sum = sum + eval<K>(q, U(o.keys[k])) * amplitude;
+            }
+            return sum * o.norm;
+        }
+
+        // out[j] for the points (c[0][j], ..., c[N-1][j]), LANES at a time;
+        // the tail goes through a padded block
+        template <noise_kind K, int N>
+        inline void evaluate(const double* const (&c)[N], double* out, std::size_t n, const octaves& o, const fractal& f)
+        {
+            std::size_t j = 0;
+            for (; j + LANES <= n; j += LANES) {
+                vd p[N];
+                for (int i = 0; i < N; ++i) p[i] = load(c[i] + j);
+                store(out + j, fbm<K>(p, o, f));
+            }
+            if (j < n) {
+                double tail[N][LANES] = {};
+                double r[LANES];
+                for (int i = 0; i < N; ++i)
+                    for (std::size_t l = 0; l < n - j; ++l) tail[i][l] = c[i][j + l];
+                vd p[N];
+                for (int i = 0; i < N; ++i) p[i] = load(tail[i]);
+                store(r, fbm<K>(p, o, f));
+                for (std::size_t l = 0; l < n - j; ++l) out[j + l] = r[l];
+            }
+        }
+
+    } // namespace noise_detail
+
+    class noise {
+        u64 seed_;
+        u64 key_;   // hash_detail::seed_key(seed_): the first octave's key
+
+        template <noise_kind K, int N>
+        inline double scalar(const double (&p)[N]) const noexcept { return noise_detail::eval<K>(p, key_); }
+
+        template <int N>
+        inline double scalar_fbm(noise_kind k, const fractal& f, const double (&p)[N]) const
+        {
+            const noise_detail::octaves o(seed_, f);
+            switch (k) {
+            case noise_kind::value:    return noise_detail::fbm<noise_kind::value>(p, o, f);
+            case noise_kind::gradient: return noise_detail::fbm<noise_kind::gradient>(p, o, f);
+            default:                   return noise_detail::fbm<noise_kind::simplex>(p, o, f);
+            }
+        }
+
+        template <int N>
+        inline void batch(noise_kind k, const double* const (&c)[N], std::span<double> out, const fractal& f) const
+        {
+            const noise_detail::octaves o(seed_, f);
+            switch (k) {
+            case noise_kind::value:    noise_detail::evaluate<noise_kind::value>(c, out.data(), out.size(), o, f); break;
+            case noise_kind::gradient: noise_detail::evaluate<noise_kind::gradient>(c, out.data(), out.size(), o, f); break;
+            default:                   noise_detail::evaluate<noise_kind::simplex>(c, out.data(), out.size(), o, f); break;
+            }
+        }
+
+        static void check(std::size_t n, std::initializer_list<std::size_t> sizes)
+        {
+            for (std::size_t s : sizes)
+                if (s != n) throw std::invalid_argument("noise::evaluate: coordinate and output spans of different sizes");
+        }
+
+    public:
+        explicit noise(u64 seed) noexcept : seed_(seed), key_(hash_detail::seed_key(seed)) {}
+
+        u64 seed() const noexcept { return seed_; }
+
+        double value(double x) const noexcept { return scalar<noise_kind::value>({ x }); }
+        double value(double x, double y) const noexcept { return scalar<noise_kind::value>({ x, y }); }
+        double value(double x, double y, double z) const noexcept { return scalar<noise_kind::value>({ x, y, z }); }
+        double value(double x, double y, double z, double w) const noexcept { return scalar<noise_kind::value>({ x, y, z, w }); }
+
+        double gradient(double x) const noexcept { return scalar<noise_kind::gradient>({ x }); }
+        double gradient(double x, double y) const noexcept { return scalar<noise_kind::gradient>({ x, y }); }
+        double gradient(double x, double y, double z) const noexcept { return scalar<noise_kind::gradient>({ x, y, z }); }
+        double gradient(double x, double y, double z, double w) const noexcept { return scalar<noise_kind::gradient>({ x, y, z, w }); }
+
+        double simplex(double x) const noexcept { return scalar<noise_kind::simplex>({ x }); }
+        double simplex(double x, double y) const noexcept { return scalar<noise_kind::simplex>({ x, y }); }
+        double simplex(double x, double y, double z) const noexcept { return scalar<noise_kind::simplex>({ x, y, z }); }
+        double simplex(double x, double y, double z, double w) const noexcept { return scalar<noise_kind::simplex>({ x, y, z, w }); }
+
+        // Fractal sum of f.octaves octaves of noise k
+        double fbm(noise_kind k, const fractal& f, double x) const { return scalar_fbm<1>(k, f, { x }); }
+        double fbm(noise_kind k, const fractal& f, double x, double y) const { return scalar_fbm<2>(k, f, { x, y }); }
+        double fbm(noise_kind k, const fractal& f, double x, double y, double z) const { return scalar_fbm<3>(k, f, { x, y, z }); }
+        double fbm(noise_kind k, const fractal& f, double x, double y, double z, double w) const { return scalar_fbm<4>(k, f, { x, y, z, w }); }
+
+        // out[i] = fbm(k, f, x[i], ...) for every point, in SIMD; with the
+        // default fractal, the plain noise
+        void evaluate(noise_kind k, std::span<const double> x, std::span<double> out, const fractal& f = {}) const
+        {
+            check(out.size(), { x.size() });
+            batch<1>(k, { x.data() }, out, f);
+        }
+        void evaluate(noise_kind k, std::span<const double> x, std::span<const double> y,
+            std::span<double> out, const fractal& f = {}) const
+        {
+            check(out.size(), { x.size(), y.size() });
+            batch<2>(k, { x.data(), y.data() }, out, f);
+        }
+        void evaluate(noise_kind k, std::span<const double> x, std::span<const double> y, std::span<const double> z,
+            std::span<double> out, const fractal& f = {}) const
+        {
+            check(out.size(), { x.size(), y.size(), z.size() });
+            batch<3>(k, { x.data(), y.data(), z.data() }, out, f);
+        }
+        void evaluate(noise_kind k, std::span<const double> x, std::span<const double> y, std::span<const double> z,
+            std::span<const double> w, std::span<double> out, const fractal& f = {}) const
+        {
+            check(out.size(), { x.size(), y.size(), z.size(), w.size() });
+            batch<4>(k, { x.data(), y.data(), z.data(), w.data() }, out, f);
+        }
+    };
+
+} // namespace RNG
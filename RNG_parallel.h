@@ -0,0 +1,37 @@
+#pragma once
+// file RNG_parallel.h
+//
+// Shared threading helper of the batch operations (RNG_checkpoint.h,
+// RNG_bootstrap.h):
+//
+//      parallel_ranges(n, threads, f)      f(begin, end) over [0, n) split
+//                                          between threads
+
+#define NOMINMAX
+#include <algorithm>
+#include <cstddef>
+#include <thread>
+#include <vector>
+
+namespace RNG {
+
+    namespace parallel_detail {
+
+        // Run f(begin, end) over [0, n) split into contiguous ranges, one per
+        // thread; the first runs on the calling thread. At most one thread per
+        // min_per_thread items, so that small batches stay on the calling thread.
+        template <class F>
+        void parallel_ranges(std::size_t n, unsigned threads, F&& f, std::size_t min_per_thread = 1)
+        {
+            const std::size_t t = std::max<std::size_t>(1, std::min<std::size_t>(threads, n / min_per_thread));
+            std::vector<std::thread> pool;
+            for (std::size_t i = 1; i < t; ++i)
+                pool.emplace_back([&, i] { f(n * i / t, n * (i + 1) / t); });
+            f(0, n / t);
+            for (auto& th : pool)
+                th.join();
+        }
+
+    } // namespace parallel_detail
+
+} // namespace RNG
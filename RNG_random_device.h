@@ -37,7 +37,7 @@ namespace RNG {
                     Default constructor. Initializes the generator using the platform's
                     default entropy source.
 
-                (2) explicit random_device(const std::string& token)
+                (2) template<class Token> explicit random_device(const Token& token)
                     Constructs the generator, ignoring the token parameter.
                     Provided for compatibility with std::random_device, which accepts
                     a token to select a specific entropy source on some implementations.
@@ -73,13 +73,10 @@ namespace RNG {
                     Fills the specified byte span with cryptographically secure random bytes.
                     Optimized for large buffers by requesting 64-bit_count chunks when possible.
 
-                 template<class T, size_t N>
-                 void fill(std::array<T, N>& arr)
-                    Fills the array with random values by treating it as a byte span.
-
-                 template<class T>
-                 void fill(std::vector<T>& vec)
-                    Fills the vector with random values by treating its data as a byte span.
+                 template<class C>
+                 void fill(C& container)
+                    Fills a contiguous container (std::array, std::vector, ...) with random
+                    values by treating its data as a byte span.
 
             Observers
                 double entropy() const noexcept
@@ -133,8 +130,11 @@ namespace RNG {
         random_device(const random_device&) = delete;
         random_device& operator=(const random_device&) = delete;
 
-        // Explicitly allow construction with a "token" string (ignored, for compatibility)
-        explicit random_device(const std::string&) {}
+        // Explicitly allow construction with a "token" string (ignored, for compatibility).
+        // A template so that this header does not need <string>.
+        template <class Token>
+            requires (!std::is_same_v<std::remove_cvref_t<Token>, random_device>)
+        explicit random_device(const Token&) {}
 
         // The core: return secure random 32-bit_count value
         uint32_t operator()() noexcept(false)
@@ -203,13 +203,12 @@ namespace RNG {
                 memcpy(ptr, &z, size);
             }
         }
-        template <class T, size_t N> inline void fill(std::array<T, N>& arr)
-        {
-            fill(std::as_bytes(std::span(arr)));
-        }
-        template <class T> inline void fill(std::vector<T>& arr)
+        // Any contiguous container: std::array, std::vector, ...
+        template <class C>
+            requires requires(C& c) { c.data(); c.size(); }
+        inline void fill(C& c)
         {
-            fill(std::as_bytes(std::span(arr)));
+            fill(std::as_writable_bytes(std::span(c.data(), c.size())));
         }
         bool operator==(const random_device&) const noexcept { return true; } // all same source
     };
@@ -0,0 +1,277 @@
+#pragma once
+// file RNG_sketch.h
+//
+// Hash-based sketches for near-duplicate detection and sampling, on the
+// keyed nasam hash of RNG_hash.h. Tokens are 64-bit values, e.g. hash_bytes()
+// of shingles; equal seeds give equal hashes, so sketches of different
+// documents can be compared.
+//
+//      minhash(tokens, signature, seed)
+//          signature[j] = min over the tokens of hash64(token, seed_j), for
+//          k = signature.size() hash functions. All k are evaluated per token
+//          in SIMD: 8 lanes with AVX-512F/DQ, 4 with AVX2 (64-bit multiplies
+//          from 32-bit ones), scalar otherwise; the same signature either way.
+//      minhash_similarity(a, b)
+//          fraction of equal entries: estimates the Jaccard similarity
+//
+//      bottom_k        the k smallest distinct hashes of a set: cardinality
+//                      and Jaccard estimates, mergeable
+//      priority_sample weighted sample of k items with priority w / u(token),
+//                      u from the hash: the same items are chosen wherever
+//                      they occur; unbiased subset-sum estimates
+//
+//      std::vector<u64> sig(128);
+//      RNG::minhash(shingle_hashes, sig, 42);
+
+#define NOMINMAX
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <stdexcept>
+#include <vector>
+
+#include "common.h"
+#include "RNG_mix.h"
+#include "RNG_hash.h"
+
+#if defined(__AVX2__) || defined(__AVX512F__)
+#include <immintrin.h>
+#endif
+
+namespace RNG {
+
+    namespace sketch_detail {
+
+        // Key of hash function j, hash64(x, hash64(j, seed)). The seed of
+        // function j is mixed rather than seed + j, so that the functions of
+        // neighbouring seeds are not the same ones shifted by one
+        constexpr u64 key(u64 seed, std::size_t j) noexcept { return hash_detail::seed_key(hash64(j, seed)); }
+
+#if defined(__AVX512F__) && defined(__AVX512DQ__)
+        inline constexpr std::size_t LANES = 8;
+
+        // mins[j] = min(mins[j], nasam(t ^ keys[j])) over the tokens, 8 keys
+        inline void min_hashes(std::span<const u64> tokens, const u64* keys, u64* mins) noexcept
+        {
+            const __m512i k = _mm512_loadu_si512(keys);
+            __m512i m = _mm512_loadu_si512(mins);
+            for (u64 t : tokens)
+                m = _mm512_maskz_min_epu64(0xff, m, nasam(_mm512_xor_si512(k, _mm512_set1_epi64(static_cast<long long>(t)))));
+            _mm512_storeu_si512(mins, m);
+        }
+#elif defined(__AVX2__)
+        inline constexpr std::size_t LANES = 4;
+
+        inline void min_hashes(std::span<const u64> tokens, const u64* keys, u64* mins) noexcept
+        {
+            const __m256i sign = _mm256_set1_epi64x(static_cast<long long>(0x8000000000000000ULL));
+            const __m256i k = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(keys));
+            __m256i m = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(mins));
+            __m256i ms = _mm256_xor_si256(m, sign);   // unsigned order as signed
+            for (u64 t : tokens) {
+                const __m256i h = nasam(_mm256_xor_si256(k, _mm256_set1_epi64x(static_cast<long long>(t))));
+                const __m256i hs = _mm256_xor_si256(h, sign);
+                ms = _mm256_blendv_epi8(ms, hs, _mm256_cmpgt_epi64(ms, hs));
+            }
+            m = _mm256_xor_si256(ms, sign);
+            _mm256_storeu_si256(reinterpret_cast<__m256i*>(mins), m);
+        }
+#else
+        inline constexpr std::size_t LANES = 4;
+
+        inline void min_hashes(std::span<const u64> tokens, const u64* keys, u64* mins) noexcept
+        {
+            u64 m0 = mins[0], m1 = mins[1], m2 = mins[2], m3 = mins[3];
+            for (u64 t : tokens) {
+                m0 = std::min(m0, nasam(t ^ keys[0]));
+                m1 = std::min(m1, nasam(t ^ keys[1]));
+                m2 = std::min(m2, nasam(t ^ keys[2]));
+                m3 = std::min(m3, nasam(t ^ keys[3]));
+            }
+            mins[0] = m0; mins[1] = m1; mins[2] = m2; mins[3] = m3;
+        }
+#endif
+
+    } // namespace sketch_detail
+
+    // signature[j] = min over tokens of hash64(token, hash64(j, seed)).
+    // Tokens that do not fit in the cache are best passed in chunks of a few
+    // thousand: the signature is updated, so minhash_update() over the chunks in turn
+    // gives the signature of the whole set if 'signature' starts at ~0.
+    inline void minhash_update(std::span<const u64> tokens, std::span<u64> signature, u64 seed) noexcept
+    {
+        using namespace sketch_detail;
+        const std::size_t k = signature.size();
+        alignas(64) u64 keys[LANES];
+        alignas(64) u64 mins[LANES];
+        std::size_t j = 0;
+        for (; j + LANES <= k; j += LANES) {
+            for (std::size_t l = 0; l < LANES; ++l) keys[l] = key(seed, j + l);
+            std::copy_n(signature.data() + j, LANES, mins);
+            min_hashes(tokens, keys, mins);
+            std::copy_n(mins, LANES, signature.data() + j);
+        }
+        for (; j < k; ++j) {
+            const u64 kj = key(seed, j);
+            u64 m = signature[j];
+            for (u64 t : tokens)
+                m = std::min(m, nasam(t ^ kj));
+            signature[j] = m;
+        }
+    }
+
+    inline void minhash(std::span<const u64> tokens, std::span<u64> signature, u64 seed)
+    {
+        std::fill(signature.begin(), signature.end(), ~u64(0));
+        constexpr std::size_t CHUNK = 4096;  // 32 KB of tokens, stays in L1 across the key groups
+        for (std::size_t i = 0; i < tokens.size(); i += CHUNK)
+            minhash_update(tokens.subspan(i, std::min(CHUNK, tokens.size() - i)), signature, seed);
+    }
+
+    // Estimated Jaccard similarity of the sets behind two signatures
+    inline double minhash_similarity(std::span<const u64> a, std::span<const u64> b)
+    {
+        if (a.size() != b.size() || a.empty())
+            throw std::invalid_argument("minhash_similarity: signatures of different or zero length");
+        std::size_t equal = 0;
+        for (std::size_t i = 0; i < a.size(); ++i)
+            equal += a[i] == b[i];
+        return static_cast<double>(equal) / static_cast<double>(a.size());
+    }
+
+    // The k smallest distinct values of hash64(token, seed) over a set
+    class bottom_k {
+        std::size_t k_;
+        u64 seed_;
+        std::vector<u64> heap_;   // max-heap of the kept hashes
+
+        void add_hash(u64 h)
+        {
+            if (heap_.size() == k_) {
+                if (h >= heap_.front()) return;
+                if (std::find(heap_.begin(), heap_.end(), h) != heap_.end()) return;
+                std::pop_heap(heap_.begin(), heap_.end());
+                heap_.back() = h;
+            }
+            else {
+                if (std::find(heap_.begin(), heap_.end(), h) != heap_.end()) return;
+                heap_.push_back(h);
+            }
+            std::push_heap(heap_.begin(), heap_.end());
+        }
+
+    public:
+        bottom_k(std::size_t k, u64 seed) : k_(k), seed_(seed)
+        {
+            if (k == 0) throw std::invalid_argument("bottom_k: k must be positive");
+            heap_.reserve(k);
+        }
+
+        std::size_t k() const noexcept { return k_; }
+        u64 seed() const noexcept { return seed_; }
+
+        void insert(u64 token) { add_hash(hash64(token, seed_)); }
+        void insert(std::span<const u64> tokens) { for (u64 t : tokens) insert(t); }
+
+        // Kept hashes, ascending
+        std::vector<u64> values() const
+        {
+            std::vector<u64> v = heap_;
+            std::sort(v.begin(), v.end());
+            return v;
+        }
+
+        // Estimated number of distinct tokens: exact below k, else (k-1) / u_k
+        double cardinality() const
+        {
+            if (heap_.size() < k_) return static_cast<double>(heap_.size());
+            const double u = (static_cast<double>(heap_.front()) + 1.0) * 0x1.0p-64;
+            return static_cast<double>(k_ - 1) / u;
+        }
+
+        // Sketch of the union of both sets
+        void merge(const bottom_k& other)
+        {
+            if (other.seed_ != seed_) throw std::invalid_argument("bottom_k::merge: different seeds");
+            for (u64 h : other.heap_) add_hash(h);
+        }
+
+        // Estimated Jaccard similarity: among the k smallest hashes of the
+        // union, the fraction present in both sketches
+        friend double jaccard(const bottom_k& a, const bottom_k& b)
+        {
+            if (a.seed_ != b.seed_ || a.k_ != b.k_) throw std::invalid_argument("jaccard: sketches with different seed or k");
+            const std::vector<u64> va = a.values(), vb = b.values();
+            std::size_t i = 0, j = 0, n = 0, both = 0;
+            while (n < a.k_ && (i < va.size() || j < vb.size())) {
+                if (j == vb.size() || (i < va.size() && va[i] < vb[j])) ++i;
+                else if (i == va.size() || vb[j] < va[i]) ++j;
+                else { ++i; ++j; ++both; }
+                ++n;
+            }
+            return n ? static_cast<double>(both) / static_cast<double>(n) : 1.0;
+        }
+    };
+
+    // Priority sampling (Duffield, Lund, Thorup): item priority w / u with u
+    // in (0, 1] from hash64(token, seed); the k highest priorities are kept.
+    class priority_sample {
+    public:
+        struct item {
+            u64 token;
+            double weight;
+            double priority;
+        };
+
+    private:
+        std::size_t k_;
+        u64 seed_;
+        std::vector<item> heap_;      // min-heap on priority, k + 1 entries (the last is the threshold)
+
+        static bool later(const item& a, const item& b) noexcept { return a.priority > b.priority; }
+
+    public:
+        priority_sample(std::size_t k, u64 seed) : k_(k), seed_(seed)
+        {
+            if (k == 0) throw std::invalid_argument("priority_sample: k must be positive");
+            heap_.reserve(k + 1);
+        }
+
+        // Tokens are distinct items; inserting the same token twice counts it twice
+        void insert(u64 token, double weight)
+        {
+            if (!(weight > 0)) return;
+            const double u = (static_cast<double>(hash64(token, seed_) >> 11) + 1.0) * 0x1.0p-53;
+            const item it{ token, weight, weight / u };
+            if (heap_.size() == k_ + 1) {
+                if (it.priority <= heap_.front().priority) return;
+                std::pop_heap(heap_.begin(), heap_.end(), later);
+                heap_.back() = it;
+            }
+            else {
+                heap_.push_back(it);
+            }
+            std::push_heap(heap_.begin(), heap_.end(), later);
+        }
+
+        // The (k+1)-th highest priority, 0 while at most k items were seen
+        double threshold() const noexcept { return heap_.size() == k_ + 1 ? heap_.front().priority : 0.0; }
+
+        // Sampled items with their weight estimates max(w, threshold): the sum
+        // over the items of a subset estimates that subset's total weight
+        std::vector<item> sample() const
+        {
+            const double tau = threshold();
+            std::vector<item> out;
+            out.reserve(k_);
+            for (const item& it : heap_) {
+                if (heap_.size() == k_ + 1 && &it == &heap_.front()) continue;
+                out.push_back({ it.token, std::max(it.weight, tau), it.priority });
+            }
+            std::sort(out.begin(), out.end(), later);
+            return out;
+        }
+    };
+
+} // namespace RNG
@@ -0,0 +1,253 @@
+#pragma once
+// file RNG_stats.h
+//
+// Opt-in usage counters for the engines, to find which parts of a program
+// consume the most random numbers and which draw one value at a time where
+// a block call would do.
+//
+// Define RNG_STATS (for the whole program, e.g. -DRNG_STATS) to enable them.
+// Without it the hooks in the engines are empty constexpr functions and
+// compile to nothing, and snapshot() and this_thread() return zero counts.
+//
+// Counted per thread and per engine type (SplitMix64, wyrand, fast, Nasam1024):
+//      draws       values returned by operator() (draw32/draw64 included)
+//      refills     output blocks computed (fast and Nasam1024: 8 words each)
+//      bulk_bytes  bytes delivered by bulk(), for_each_block() and generate_n(),
+//                  and so by fill(), fill_uniform(), any_engine, views::random
+//      discards    calls to discard()
+//      jumps       calls to jump(), long_jump() and Nasam1024's jumpNNN()
+//      reseeds     calls to seed() and reseed() on an existing engine
+//
+// A counter is updated only by its own thread, with a relaxed load and store
+// (a plain add, no lock prefix); snapshot() reads every thread's counters
+// while they run. Counts of threads that have exited are kept in 'exited'.
+//
+//      const auto before = RNG::stats::snapshot().total();
+//      run_subsystem();
+//      const auto used = RNG::stats::snapshot().total() - before;
+//      const auto& f = used[RNG::stats::index<RNG::fast>];
+//      std::cout << f.draws << " single draws, " << f.bulk_bytes << " bytes in blocks\n";
+
+#define NOMINMAX
+#include <array>
+#include <cstddef>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+#include "common.h"
+
+#if defined(RNG_STATS)
+#include <atomic>
+#include <mutex>
+#endif
+
+namespace RNG {
+
+    class SplitMix64;
+    struct wyrand;
+    class fast;
+    class Nasam1024;
+
+    namespace stats {
+
+#if defined(RNG_STATS)
+        inline constexpr bool enabled = true;
+#else
+        inline constexpr bool enabled = false;
+#endif
+
+        enum counter : unsigned { draws, refills, bulk_bytes, discards, jumps, reseeds, COUNTERS };
+
+        // Engines are counted separately; other engines are not counted
+        template <class E> inline constexpr std::size_t index = std::size_t(-1);
+        template <> inline constexpr std::size_t index<SplitMix64> = 0;
+        template <> inline constexpr std::size_t index<wyrand> = 1;
+        template <> inline constexpr std::size_t index<fast> = 2;
+        template <> inline constexpr std::size_t index<Nasam1024> = 3;
+        inline constexpr std::size_t ENGINES = 4;
+
+        inline constexpr const char* engine_names[ENGINES] = { "SplitMix64", "wyrand", "fast", "Nasam1024" };
+
+#if defined(RNG_STATS)
+        namespace detail {
+
+            struct thread_counters {
+                std::array<std::array<std::atomic<u64>, COUNTERS>, ENGINES> c{};
+                std::thread::id id = std::this_thread::get_id();
+            };
+
+            inline void attach();
+
+            inline constinit thread_local thread_counters* current = nullptr;
+
+            inline void add(std::size_t engine, counter k, u64 n) noexcept
+            {
+                if (current == nullptr) [[unlikely]]
+                    attach();
+                std::atomic<u64>& a = current->c[engine][k];
+                a.store(a.load(std::memory_order_relaxed) + n, std::memory_order_relaxed);
+            }
+
+        } // namespace detail
+#endif
+
+        // Hook called by the engines; nothing unless RNG_STATS is defined
+        template <class E>
+        constexpr void count([[maybe_unused]] counter k, [[maybe_unused]] u64 n = 1) noexcept
+        {
+#if defined(RNG_STATS)
+            if constexpr (index<E> < ENGINES) {
+                if (!std::is_constant_evaluated())
+                    detail::add(index<E>, k, n);
+            }
+#endif
+        }
+
+        struct counts {
+            u64 draws = 0, refills = 0, bulk_bytes = 0, discards = 0, jumps = 0, reseeds = 0;
+
+            u64& operator[](counter k) noexcept
+            {
+                u64* p[COUNTERS] = { &draws, &refills, &bulk_bytes, &discards, &jumps, &reseeds };
+                return *p[k];
+            }
+            u64 operator[](counter k) const noexcept { return const_cast<counts&>(*this)[k]; }
+
+            counts& operator+=(const counts& o) noexcept
+            {
+                for (unsigned k = 0; k < COUNTERS; ++k)
+                    (*this)[counter(k)] += o[counter(k)];
+                return *this;
+            }
+            counts& operator-=(const counts& o) noexcept
+            {
+                for (unsigned k = 0; k < COUNTERS; ++k)
+                    (*this)[counter(k)] -= o[counter(k)];
+                return *this;
+            }
+        };
+
+        // Indexed by stats::index<E>
+        struct engine_counts : std::array<counts, ENGINES> {
+            engine_counts& operator+=(const engine_counts& o) noexcept
+            {
+                for (std::size_t e = 0; e < ENGINES; ++e) (*this)[e] += o[e];
+                return *this;
+            }
+            engine_counts& operator-=(const engine_counts& o) noexcept
+            {
+                for (std::size_t e = 0; e < ENGINES; ++e) (*this)[e] -= o[e];
+                return *this;
+            }
+            friend engine_counts operator+(engine_counts a, const engine_counts& b) noexcept { return a += b; }
+            friend engine_counts operator-(engine_counts a, const engine_counts& b) noexcept { return a -= b; }
+        };
+
+        struct thread_snapshot {
+            std::thread::id id;
+            engine_counts engines;
+        };
+
+        struct usage {
+            std::vector<thread_snapshot> threads;   // live threads that have used an engine
+            engine_counts exited;                   // threads that have exited, summed
+
+            engine_counts total() const
+            {
+                engine_counts t = exited;
+                for (const auto& th : threads) t += th.engines;
+                return t;
+            }
+        };
+
+#if defined(RNG_STATS)
+        namespace detail {
+
+            inline engine_counts read(const thread_counters& tc) noexcept
+            {
+                engine_counts r;
+                for (std::size_t e = 0; e < ENGINES; ++e)
+                    for (unsigned k = 0; k < COUNTERS; ++k)
+                        r[e][counter(k)] = tc.c[e][k].load(std::memory_order_relaxed);
+                return r;
+            }
+
+            struct registry {
+                std::mutex mutex;
+                std::vector<thread_counters*> live;
+                engine_counts exited{};
+
+                static registry& instance()
+                {
+                    static registry r;
+                    return r;
+                }
+            };
+
+            // Target of counts made after the thread's guard is gone; never read.
+            // Leaked, so that threads still exiting after main() can write to it
+            inline thread_counters& dropped()
+            {
+                static thread_counters& d = *new thread_counters;
+                return d;
+            }
+
+            // Folds the thread's counts into 'exited' when the thread ends
+            struct thread_guard {
+                thread_counters* tc = new thread_counters;
+
+                thread_guard()
+                {
+                    auto& r = registry::instance();
+                    std::lock_guard<std::mutex> lock(r.mutex);
+                    r.live.push_back(tc);
+                }
+
+                ~thread_guard()
+                {
+                    auto& r = registry::instance();
+                    {
+                        std::lock_guard<std::mutex> lock(r.mutex);
+                        r.exited += read(*tc);
+                        std::erase(r.live, tc);
+                    }
+                    current = &dropped(); // engines used by later thread_local destructors
+                    delete tc;
+                }
+            };
+
+            inline void attach()
+            {
+                registry::instance(); // constructed first, so destroyed after every thread_guard
+                static thread_local thread_guard guard;
+                current = guard.tc;
+            }
+
+        } // namespace detail
+
+        // Counts of every thread, taken while they run
+        inline usage snapshot()
+        {
+            auto& r = detail::registry::instance();
+            std::lock_guard<std::mutex> lock(r.mutex);
+            usage s;
+            s.exited = r.exited;
+            for (const detail::thread_counters* tc : r.live)
+                s.threads.push_back({ tc->id, detail::read(*tc) });
+            return s;
+        }
+
+        // Counts of the calling thread
+        inline engine_counts this_thread()
+        {
+            return detail::current ? detail::read(*detail::current) : engine_counts{};
+        }
+#else
+        inline usage snapshot() { return {}; }
+        inline engine_counts this_thread() { return {}; }
+#endif
+
+    } // namespace stats
+
+} // namespace RNG
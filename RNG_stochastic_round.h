@@ -0,0 +1,319 @@
+#pragma once
+// file RNG_stochastic_round.h
+//
+// Stochastic rounding of fp32 buffers to bfloat16, IEEE half and int8: each
+// value is rounded to one of its two neighbours, up with probability equal to
+// its distance from the lower one, so that the rounding is unbiased on
+// average. Low-precision training uses it to keep small updates that
+// round-to-nearest would drop.
+//
+//      stochastic_round_bf16(in, out, engine)          out: u16 bit patterns
+//      stochastic_round_fp16(in, out, engine)
+//      stochastic_round_int8(in, out, scale, engine)   round(in * scale),
+//                                                      saturated to [-128, 127]
+//
+// The random bits come from an engine, in blocks through fill_words() (bulk()
+// for fast and Nasam1024): one 64-bit output per 4 elements for bf16 and fp16
+// (16 and 13 random bits each, as many as the dropped fraction has), per 2
+// for int8 (24 bits). Or from the stateless overloads, which take a seed and
+// the index of in[0] in the whole tensor: element i's bits are a hash of
+// (seed, i), so a tensor rounds the same way however it is split between
+// threads or calls.
+//
+//      std::vector<std::uint16_t> w16(w.size());
+//      RNG::stochastic_round_bf16(w, w16, rng);
+//      RNG::stochastic_round_bf16(shard, w16_shard, step_seed, shard_offset);
+//
+// Infinities stay infinite and NaNs stay NaN (quiet); values beyond the
+// largest finite half round to infinity. The kernels run 8 elements per step
+// with AVX2 and give the same results as the scalar code otherwise.
+
+#define NOMINMAX
+#include <algorithm>
+#include <bit>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <span>
+#include <stdexcept>
+
+#include "common.h"
+#include "RNG_engine.h"
+#include "RNG_mix.h"
+#include "RNG_hash.h"
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#endif
+
+namespace RNG {
+
+    // One value, with the random bits r (the low 16 for bf16, 13 for fp16,
+    // the high 24 for int8)
+    inline u16 stochastic_bf16(float x, u32 r) noexcept
+    {
+        u32 b = std::bit_cast<u32>(x);
+        if ((b & 0x7f800000u) == 0x7f800000u)  // inf or NaN: truncate, keep NaN quiet
+            return static_cast<u16>((b >> 16) | ((b & 0x7fffffu) ? 0x40u : 0u));
+        b += r & 0xffffu;                       // carries into the kept bits
+        return static_cast<u16>(b >> 16);
+    }
+
+    inline u16 stochastic_fp16(float x, u32 r) noexcept
+    {
+        const u32 b = std::bit_cast<u32>(x);
+        const u32 sign = (b >> 16) & 0x8000u;
+        const u32 a = b & 0x7fffffffu;
+        r &= 0x1fffu;
+        if (a >= 0x7f800000u)
+            return static_cast<u16>(sign | 0x7c00u | (a > 0x7f800000u ? 0x200u : 0u));
+        if (a >= 0x38800000u) {                 // 2^-14 and up: normal halves
+            const u32 h = ((a + r) >> 13) - (112u << 10);  // exponent bias 127 -> 15
+            return static_cast<u16>(sign | std::min(h, 0x7c00u));
+        }
+        // Subnormal halves, in units of 2^-24 with 13 fraction bits
+        const u32 f = static_cast<u32>(std::bit_cast<float>(a) * 0x1.0p37f);
+        return static_cast<u16>(sign | ((f + r) >> 13));
+    }
+
+    inline std::int8_t stochastic_int8(float x, float scale, u32 r) noexcept
+    {
+        const float y = x * scale;
+        const float q = std::floor(y);
+        const float u = static_cast<float>(r >> 8) * 0x1.0p-24f;
+        float v = q + (u < y - q ? 1.0f : 0.0f);
+        if (v != v) v = 0.0f;                   // NaN
+        v = std::min(std::max(v, -128.0f), 127.0f);
+        return static_cast<std::int8_t>(v);
+    }
+
+    namespace stochastic_round_detail {
+
+        // Elements per call of a kernel, a multiple of 4
+        inline constexpr std::size_t CHUNK = 1024;
+
+#if defined(__AVX2__)
+        // 8 u32 lanes -> 8 u16 (values below 2^16)
+        inline void store_u16x8(u16* out, __m256i h) noexcept
+        {
+            const __m256i p = _mm256_permute4x64_epi64(_mm256_packus_epi32(h, h), 0x08);
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(out), _mm256_castsi256_si128(p));
+        }
+
+        // Fields j .. j+7 of words (see field()), widened to u32 lanes
+        template <class T>
+        inline __m256i load_x8(const u64* words, std::size_t j) noexcept
+        {
+            const unsigned char* p = reinterpret_cast<const unsigned char*>(words) + j * sizeof(T);
+            if constexpr (sizeof(T) == 2)
+                return _mm256_cvtepu16_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i*>(p)));
+            else
+                return _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p));
+        }
+#endif
+
+        // Field j of words, T wide: bits 8 sizeof(T) (j % per word) and up of
+        // words[j / per word]. Shifts, not a T* into the words, which would
+        // break strict aliasing.
+        template <class T>
+        inline T field(const u64* words, std::size_t j) noexcept
+        {
+            constexpr std::size_t PER_WORD = sizeof(u64) / sizeof(T);
+            return static_cast<T>(words[j / PER_WORD] >> (8 * sizeof(T) * (j % PER_WORD)));
+        }
+
+        // The kernels: element i takes field r + i of the words
+
+        inline void bf16(const float* in, u16* out, const u64* words, std::size_t r, std::size_t n) noexcept
+        {
+            std::size_t i = 0;
+#if defined(__AVX2__)
+            const __m256i exp = _mm256_set1_epi32(0x7f800000);
+            const __m256i man = _mm256_set1_epi32(0x7fffff);
+            const __m256i zero = _mm256_setzero_si256();
+            for (; i + 8 <= n; i += 8) {
+                const __m256i b = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(in + i));
+                const __m256i special = _mm256_cmpeq_epi32(_mm256_and_si256(b, exp), exp);
+                const __m256i nan = _mm256_andnot_si256(_mm256_cmpeq_epi32(_mm256_and_si256(b, man), zero), special);
+                const __m256i s = _mm256_add_epi32(b, _mm256_andnot_si256(special, load_x8<u16>(words, r + i)));
+                const __m256i h = _mm256_or_si256(_mm256_srli_epi32(s, 16),
+                    _mm256_and_si256(nan, _mm256_set1_epi32(0x40)));
+                store_u16x8(out + i, h);
+            }
+#endif
+            for (; i < n; ++i)
+                out[i] = stochastic_bf16(in[i], field<u16>(words, r + i));
+        }
+
+        inline void fp16(const float* in, u16* out, const u64* words, std::size_t r, std::size_t n) noexcept
+        {
+            std::size_t i = 0;
+#if defined(__AVX2__)
+            const __m256i abs = _mm256_set1_epi32(0x7fffffff);
+            const __m256i low13 = _mm256_set1_epi32(0x1fff);
+            for (; i + 8 <= n; i += 8) {
+                const __m256i b = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(in + i));
+                const __m256i a = _mm256_and_si256(b, abs);
+                const __m256i sign = _mm256_and_si256(_mm256_srli_epi32(b, 16), _mm256_set1_epi32(0x8000));
+                const __m256i rn = _mm256_and_si256(load_x8<u16>(words, r + i), low13);
+                // both ranges, then the one that applies
+                __m256i normal = _mm256_sub_epi32(_mm256_srli_epi32(_mm256_add_epi32(a, rn), 13), _mm256_set1_epi32(112 << 10));
+                normal = _mm256_min_epu32(normal, _mm256_set1_epi32(0x7c00));
+                const __m256i f = _mm256_cvttps_epi32(_mm256_mul_ps(_mm256_castsi256_ps(a), _mm256_set1_ps(0x1.0p37f)));
+                const __m256i sub = _mm256_srli_epi32(_mm256_add_epi32(f, rn), 13);
+                __m256i h = _mm256_blendv_epi8(sub, normal, _mm256_cmpgt_epi32(a, _mm256_set1_epi32(0x387fffff)));
+                const __m256i special = _mm256_cmpgt_epi32(a, _mm256_set1_epi32(0x7f7fffff));
+                const __m256i nan = _mm256_cmpgt_epi32(a, _mm256_set1_epi32(0x7f800000));
+                const __m256i inf_nan = _mm256_or_si256(_mm256_set1_epi32(0x7c00), _mm256_and_si256(nan, _mm256_set1_epi32(0x200)));
+                h = _mm256_blendv_epi8(h, inf_nan, special);
+                store_u16x8(out + i, _mm256_or_si256(h, sign));
+            }
+#endif
+            for (; i < n; ++i)
+                out[i] = stochastic_fp16(in[i], field<u16>(words, r + i));
+        }
+
+        inline void int8(const float* in, std::int8_t* out, const u64* words, std::size_t r, std::size_t n, float scale) noexcept
+        {
+            std::size_t i = 0;
+#if defined(__AVX2__)
+            const __m256 s = _mm256_set1_ps(scale);
+            const __m256i order = _mm256_setr_epi32(0, 4, 0, 0, 0, 0, 0, 0);
+            for (; i + 8 <= n; i += 8) {
+                const __m256 y = _mm256_mul_ps(_mm256_loadu_ps(in + i), s);
+                const __m256 q = _mm256_floor_ps(y);
+                const __m256i rb = _mm256_srli_epi32(load_x8<u32>(words, r + i), 8);
+                const __m256 u = _mm256_mul_ps(_mm256_cvtepi32_ps(rb), _mm256_set1_ps(0x1.0p-24f));
+                __m256 v = _mm256_add_ps(q, _mm256_and_ps(_mm256_cmp_ps(u, _mm256_sub_ps(y, q), _CMP_LT_OQ), _mm256_set1_ps(1.0f)));
+                v = _mm256_and_ps(v, _mm256_cmp_ps(v, v, _CMP_ORD_Q));
+                v = _mm256_min_ps(_mm256_max_ps(v, _mm256_set1_ps(-128.0f)), _mm256_set1_ps(127.0f));
+                const __m256i w = _mm256_cvttps_epi32(v);
+                const __m256i p16 = _mm256_packs_epi32(w, w);
+                const __m256i p8 = _mm256_packs_epi16(p16, p16);   // in bytes 0-3 of each 128-bit half
+                const __m256i b = _mm256_permutevar8x32_epi32(p8, order);
+                _mm_storel_epi64(reinterpret_cast<__m128i*>(out + i), _mm256_castsi256_si128(b));
+            }
+#endif
+            for (; i < n; ++i)
+                out[i] = stochastic_int8(in[i], scale, field<u32>(words, r + i));
+        }
+
+        // r = bits(words, element offset, n) then kernel(first, n, words, r)
+        // per chunk: element first + j takes field r + j of the words.
+        // R = bytes of random bits per element.
+        template <std::size_t R, class Bits, class Kernel>
+        inline void chunks(std::size_t n, Bits&& bits, Kernel&& kernel)
+        {
+            constexpr std::size_t PER_WORD = sizeof(u64) / R;
+            u64 words[CHUNK / PER_WORD + 1];
+            for (std::size_t i = 0; i < n; i += CHUNK) {
+                const std::size_t m = std::min(CHUNK, n - i);
+                const std::size_t r = bits(words, i, m);
+                kernel(i, m, words, r);
+            }
+        }
+
+        // Random bits from an engine: element j of the chunk takes field j,
+        // the R bytes from bit 8 R (j % PER_WORD) of word j / PER_WORD
+        template <std::size_t R, class E>
+        inline auto engine_bits(E& e)
+        {
+            return [&e](u64* words, std::size_t, std::size_t m) {
+                fill_words(e, words, (m * R + sizeof(u64) - 1) / sizeof(u64));
+                return std::size_t(0);
+            };
+        }
+
+        // Stateless bits: element g of the tensor takes field g % PER_WORD
+        // of nasam(key ^ g / PER_WORD)
+        template <std::size_t R>
+        inline auto keyed_bits(u64 seed, u64 first)
+        {
+            constexpr std::size_t PER_WORD = sizeof(u64) / R;
+            return [key = hash_detail::seed_key(seed), first](u64* words, std::size_t i, std::size_t m) {
+                const u64 g = first + i;
+                const u64 w0 = g / PER_WORD;
+                const std::size_t skip = static_cast<std::size_t>(g % PER_WORD);
+                const std::size_t count = (skip + m + PER_WORD - 1) / PER_WORD;
+                std::size_t w = 0;
+#if defined(__AVX2__)
+                const __m256i k = _mm256_set1_epi64x(static_cast<long long>(key));
+                for (; w + 4 <= count; w += 4) {
+                    const __m256i c = _mm256_add_epi64(_mm256_set1_epi64x(static_cast<long long>(w0 + w)),
+                        _mm256_setr_epi64x(0, 1, 2, 3));
+                    _mm256_storeu_si256(reinterpret_cast<__m256i*>(words + w), nasam(_mm256_xor_si256(c, k)));
+                }
+#endif
+                for (; w < count; ++w)
+                    words[w] = nasam((w0 + w) ^ key);
+                return skip;
+            };
+        }
+
+        inline void check(std::size_t in, std::size_t out)
+        {
+            if (in != out) throw std::invalid_argument("stochastic_round: input and output of different sizes");
+        }
+
+    } // namespace stochastic_round_detail
+
+    template <engine E>
+    inline void stochastic_round_bf16(std::span<const float> in, std::span<u16> out, E& e)
+    {
+        using namespace stochastic_round_detail;
+        check(in.size(), out.size());
+        chunks<2>(in.size(), engine_bits<2>(e), [&](std::size_t i, std::size_t m, const u64* words, std::size_t r) {
+            bf16(in.data() + i, out.data() + i, words, r, m);
+        });
+    }
+
+    // Stateless: 'first' is the index of in[0] in the whole tensor
+    inline void stochastic_round_bf16(std::span<const float> in, std::span<u16> out, u64 seed, u64 first = 0)
+    {
+        using namespace stochastic_round_detail;
+        check(in.size(), out.size());
+        chunks<2>(in.size(), keyed_bits<2>(seed, first), [&](std::size_t i, std::size_t m, const u64* words, std::size_t r) {
+            bf16(in.data() + i, out.data() + i, words, r, m);
+        });
+    }
+
+    template <engine E>
+    inline void stochastic_round_fp16(std::span<const float> in, std::span<u16> out, E& e)
+    {
+        using namespace stochastic_round_detail;
+        check(in.size(), out.size());
+        chunks<2>(in.size(), engine_bits<2>(e), [&](std::size_t i, std::size_t m, const u64* words, std::size_t r) {
+            fp16(in.data() + i, out.data() + i, words, r, m);
+        });
+    }
+
+    inline void stochastic_round_fp16(std::span<const float> in, std::span<u16> out, u64 seed, u64 first = 0)
+    {
+        using namespace stochastic_round_detail;
+        check(in.size(), out.size());
+        chunks<2>(in.size(), keyed_bits<2>(seed, first), [&](std::size_t i, std::size_t m, const u64* words, std::size_t r) {
+            fp16(in.data() + i, out.data() + i, words, r, m);
+        });
+    }
+
+    template <engine E>
+    inline void stochastic_round_int8(std::span<const float> in, std::span<std::int8_t> out, float scale, E& e)
+    {
+        using namespace stochastic_round_detail;
+        check(in.size(), out.size());
+        chunks<4>(in.size(), engine_bits<4>(e), [&](std::size_t i, std::size_t m, const u64* words, std::size_t r) {
+            int8(in.data() + i, out.data() + i, words, r, m, scale);
+        });
+    }
+
+    inline void stochastic_round_int8(std::span<const float> in, std::span<std::int8_t> out, float scale, u64 seed, u64 first = 0)
+    {
+        using namespace stochastic_round_detail;
+        check(in.size(), out.size());
+        chunks<4>(in.size(), keyed_bits<4>(seed, first), [&](std::size_t i, std::size_t m, const u64* words, std::size_t r) {
+            int8(in.data() + i, out.data() + i, words, r, m, scale);
+        });
+    }
+
+} // namespace RNG
@@ -0,0 +1,205 @@
+#pragma once
+// file RNG_tape.h
+//
+// Random tapes: engine output recorded to a file once and replayed from a
+// memory mapping. Replaying from the page cache beats regenerating when the
+// engine is expensive, and a tape written by another library replays here
+// word for word for cross-library comparisons.
+//
+// Format (little-endian)
+//      0       tape_header (72 bytes), zero-padded to TAPE_HEADER_BYTES
+//      4096    'words' 64-bit words: the engine's output stream starting at
+//              stream position 'position' (the word E(seed) returns after
+//              discard(position))
+//
+// Writing
+//      RNG::write_tape<RNG::Nasam1024>("nasam.tape", 1ull << 30);          // 8 GiB, all threads
+//
+//      RNG::file_fill::config cfg;                                      // seed, position, threads, ...
+//      cfg.seed = 42; cfg.position = 1000000;
+//      RNG::write_tape<RNG::fast>("fast.tape", 1ull << 24, cfg);
+//
+//      RNG::write_tape("pcg.tape", "pcg64", seed, 0, words);            // any recorded words
+//
+// Replay
+//      RNG::tape_engine t("nasam.tape");       // a UniformRandomBitGenerator
+//      std::uniform_real_distribution<double> u;
+//      double x = u(t);
+//      t.seek(t.start() + 123456789);          // random access, stream positions
+//      t.fill(buf, n);                         // straight copy from the mapping
+//
+// Copies of a tape_engine share the mapping and have their own read position.
+// Reading past the end of the tape throws std::out_of_range.
+
+#define NOMINMAX
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <memory>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "common.h"
+#include "RNG_file.h"
+#include "RNG_fill.h"
+
+namespace RNG {
+
+    inline constexpr std::size_t TAPE_HEADER_BYTES = 4096; // keeps the data O_DIRECT and page aligned
+    inline constexpr std::uint32_t TAPE_VERSION = 1;
+
+    struct tape_header {
+        char magic[8];              // "RNGTAPE\0"
+        std::uint32_t version;      // TAPE_VERSION
+        std::uint32_t header_bytes; // offset of the data
+        char engine[32];            // engine name, '\0' padded
+        u64 seed;
+        u64 position;               // stream position of the first word
+        u64 words;                  // number of 64-bit words
+    };
+    static_assert(sizeof(tape_header) == 72, "tape_header layout");
+
+    namespace tape_detail {
+
+        inline tape_header make_header(std::string_view engine, u64 seed, u64 position, u64 words)
+        {
+            tape_header h{};
+            std::memcpy(h.magic, "RNGTAPE", 8);
+            h.version = TAPE_VERSION;
+            h.header_bytes = static_cast<std::uint32_t>(TAPE_HEADER_BYTES);
+            std::memcpy(h.engine, engine.data(), std::min(engine.size(), sizeof(h.engine) - 1));
+            h.seed = seed;
+            h.position = position;
+            h.words = words;
+            return h;
+        }
+
+    } // namespace tape_detail
+
+    // Record 'words' outputs of E(cfg.seed), starting at stream position
+    // cfg.position, with the parallel writer of RNG_fill.h (cfg.bytes and
+    // cfg.offset are set here).
+    template <class E>
+    file_fill::report write_tape(const std::string& path, u64 words, file_fill::config cfg = {})
+    {
+        if (words == 0)
+            throw std::invalid_argument("write_tape: empty tape");
+        cfg.bytes = words * sizeof(u64);
+        cfg.offset = TAPE_HEADER_BYTES;
+        const file_fill::report r = file_fill::run<E>(path, cfg);
+
+        // The header goes last: a tape whose writing failed has no valid header
+        const tape_header h = tape_detail::make_header(file_name<E>::value, cfg.seed, cfg.position, words);
+        std::fstream f(path, std::ios::in | std::ios::out | std::ios::binary);
+        if (!f.write(reinterpret_cast<const char*>(&h), sizeof(h)) || !f.flush())
+            throw std::runtime_error("write_tape: cannot write header to " + path);
+        return r;
+    }
+
+    // Record words produced elsewhere, e.g. by another library
+    inline void write_tape(const std::string& path, std::string_view engine, u64 seed, u64 position,
+        std::span<const u64> words)
+    {
+        std::vector<char> header(TAPE_HEADER_BYTES, 0);
+        const tape_header h = tape_detail::make_header(engine, seed, position, words.size());
+        std::memcpy(header.data(), &h, sizeof(h));
+        std::ofstream f(path, std::ios::binary | std::ios::trunc);
+        f.write(header.data(), static_cast<std::streamsize>(header.size()));
+        f.write(reinterpret_cast<const char*>(words.data()), static_cast<std::streamsize>(words.size_bytes()));
+        if (!f.flush())
+            throw std::runtime_error("write_tape: cannot write " + path);
+    }
+
+    // A mapped tape file
+    class tape {
+        std::shared_ptr<const mapped_file> map_;
+        tape_header header_{};
+
+    public:
+        explicit tape(const std::string& path)
+            : map_(std::make_shared<const mapped_file>(path))
+        {
+            if (map_->size() < sizeof(tape_header))
+                throw std::runtime_error("tape: " + path + " is too short");
+            std::memcpy(&header_, map_->data(), sizeof(header_));
+            if (std::memcmp(header_.magic, "RNGTAPE", 8) != 0)
+                throw std::runtime_error("tape: " + path + " is not a tape");
+            if (header_.version != TAPE_VERSION)
+                throw std::runtime_error("tape: " + path + " has unsupported version " + std::to_string(header_.version));
+            if (header_.header_bytes % sizeof(u64) != 0 || header_.header_bytes > map_->size()
+                || header_.words > (map_->size() - header_.header_bytes) / sizeof(u64))
+                throw std::runtime_error("tape: " + path + " is truncated");
+        }
+
+        const tape_header& header() const noexcept { return header_; }
+        std::string engine() const { return std::string(header_.engine, strnlen(header_.engine, sizeof(header_.engine))); }
+        u64 seed() const noexcept { return header_.seed; }
+        u64 start() const noexcept { return header_.position; }  // stream position of words()[0]
+        u64 size() const noexcept { return header_.words; }
+
+        std::span<const u64> words() const noexcept
+        {
+            return { reinterpret_cast<const u64*>(map_->data() + header_.header_bytes), static_cast<std::size_t>(header_.words) };
+        }
+
+        // Keeps the mapping alive for tape_engine
+        const std::shared_ptr<const mapped_file>& mapping() const noexcept { return map_; }
+    };
+
+    // UniformRandomBitGenerator replaying a tape
+    class tape_engine {
+        std::shared_ptr<const mapped_file> map_;
+        const u64* words_ = nullptr;
+        u64 size_ = 0;
+        u64 start_ = 0;  // stream position of words_[0]
+        u64 index_ = 0;  // next word
+
+        [[noreturn]] static void end_of_tape() { throw std::out_of_range("tape_engine: end of tape"); }
+
+    public:
+        using result_type = u64;
+
+        explicit tape_engine(const tape& t)
+            : map_(t.mapping()), words_(t.words().data()), size_(t.size()), start_(t.start()) {}
+        explicit tape_engine(const std::string& path) : tape_engine(tape(path)) {}
+
+        u64 operator()()
+        {
+            if (index_ == size_) end_of_tape();
+            return words_[index_++];
+        }
+
+        // Bytes of the following outputs; a partial last word counts as used,
+        // as with the engines' bulk()
+        void fill(u8* data, std::size_t bytes)
+        {
+            const u64 words = (bytes + sizeof(u64) - 1) / sizeof(u64);
+            if (words > size_ - index_) end_of_tape();
+            std::memcpy(data, words_ + index_, bytes);
+            index_ += words;
+        }
+        void bulk(u8* data, std::size_t bytes) { fill(data, bytes); }
+
+        // Random access by stream position: the next output is the one the
+        // recorded engine gives after discard(position)
+        void seek(u64 position)
+        {
+            if (position < start_ || position - start_ > size_)
+                throw std::out_of_range("tape_engine: seek outside the tape");
+            index_ = position - start_;
+        }
+        u64 tell() const noexcept { return start_ + index_; }
+        void discard(unsigned long long n) { seek(tell() + n); }
+
+        u64 start() const noexcept { return start_; }
+        u64 remaining() const noexcept { return size_ - index_; }
+
+        static constexpr result_type min() noexcept { return 0; }
+        static constexpr result_type max() noexcept { return UINT64_MAX; }
+    };
+
+} // namespace RNG
@@ -0,0 +1,148 @@
+#pragma once
+// file RNG_traits.h
+//
+// Compile-time description of engines, and engine selection from it.
+//
+// engine_traits<E>
+//      state_bytes     minimal state, position included (CHECKPOINT_BYTES)
+//      period_log2     log2 of the period in outputs (0 = unknown)
+//      block_words     outputs produced per refill (1 = unbuffered)
+//      bulk_words      preferred batch for fill_words / for_each_block: a
+//                      multiple of block_words large enough to amortize the
+//                      call; containers use it to size their buffers
+//      random_access   output n is computed, and skipped, in O(1): at(n)
+//                      and discard(n)
+//      jump_log2       jump() advances 2^jump_log2 outputs (0 = no jump())
+//      streams_log2    log2 of the number of non-overlapping jump() streams
+//                      (0 = none: make_stream() falls back to seeding)
+//
+// The primary template describes any engine from what it provides; the
+// library's engines are specialized with their exact values.
+//
+// select_engine<requirements>
+//      The first engine of the preference list fast, SplitMix64, wyrand,
+//      Nasam1024 that meets the requirements. No match is a compile error.
+//
+//      // 2^20 streams of 2^30 outputs, random access, at most 64 bytes of state
+//      using E = RNG::select_engine<{ .streams_log2 = 20, .stream_length_log2 = 30,
+//                                     .random_access = true, .max_state_bytes = 64 }>;
+//      // -> RNG::fast; stream id is RNG::make_stream<E>(seed, id), a single
+//      //    jump(id) from E(seed), so its cost does not depend on id
+
+#define NOMINMAX
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <type_traits>
+
+#include "common.h"
+#include "RNG_SplitMix64.h"
+#include "RNG_wyrand.h"
+#include "RNG_fast.h"
+#include "Nasam1024.h"
+
+namespace RNG {
+
+    template <class E>
+    struct engine_traits {
+        static constexpr std::size_t state_bytes = [] {
+            if constexpr (requires { E::CHECKPOINT_BYTES; }) return std::size_t(E::CHECKPOINT_BYTES);
+            else return sizeof(E);
+        }();
+        static constexpr unsigned period_log2 = 0;
+        static constexpr std::size_t block_words = 1;
+        static constexpr std::size_t bulk_words = 64;
+        static constexpr bool random_access = requires(const E & c, E & e) { c.at(u64{}); e.discard(u64{}); };
+        static constexpr unsigned jump_log2 = 0;
+        static constexpr unsigned streams_log2 = 0;
+    };
+
+    template <>
+    struct engine_traits<SplitMix64> {
+        static constexpr std::size_t state_bytes = SplitMix64::CHECKPOINT_BYTES;
+        static constexpr unsigned period_log2 = 64;
+        static constexpr std::size_t block_words = 1;
+        static constexpr std::size_t bulk_words = 64;  // for_each_block() block
+        static constexpr bool random_access = true;
+        static constexpr unsigned jump_log2 = 0;
+        static constexpr unsigned streams_log2 = 0;
+    };
+
+    template <>
+    struct engine_traits<wyrand> {
+        static constexpr std::size_t state_bytes = wyrand::CHECKPOINT_BYTES;
+        static constexpr unsigned period_log2 = 64;
+        static constexpr std::size_t block_words = 1;
+        static constexpr std::size_t bulk_words = 64;  // for_each_block() block
+        static constexpr bool random_access = true;    // at(n), discard(n)
+        static constexpr unsigned jump_log2 = 0;
+        static constexpr unsigned streams_log2 = 0;
+    };
+
+    template <>
+    struct engine_traits<fast> {
+        static constexpr std::size_t state_bytes = fast::CHECKPOINT_BYTES;
+        static constexpr unsigned period_log2 = 64;
+        static constexpr std::size_t block_words = 8;
+        static constexpr std::size_t bulk_words = 64;
+        static constexpr bool random_access = true;
+        static constexpr unsigned jump_log2 = 32;      // discard(2^32)
+        static constexpr unsigned streams_log2 = 32;
+    };
+
+    template <>
+    struct engine_traits<Nasam1024> {
+        static constexpr std::size_t state_bytes = Nasam1024::CHECKPOINT_BYTES;
+        static constexpr unsigned period_log2 = 1024 + 3;  // 2^1024 counter steps of 8 outputs
+        static constexpr std::size_t block_words = 8;
+        static constexpr std::size_t bulk_words = 64;
+        static constexpr bool random_access = true;    // discard(n) is one 1024-bit add
+        static constexpr unsigned jump_log2 = 131;     // jump128(): 2^128 counter steps of 8 outputs
+        static constexpr unsigned streams_log2 = 896;
+        static_assert(streams_log2 == period_log2 - jump_log2, "streams of 2^jump_log2 outputs fill the period");
+    };
+
+    // What select_engine must satisfy. The defaults ask for nothing.
+    struct engine_requirements {
+        unsigned streams_log2 = 0;          // non-overlapping streams needed
+        unsigned stream_length_log2 = 0;    // outputs each stream must supply
+        unsigned min_period_log2 = 0;
+        bool random_access = false;
+        std::size_t max_state_bytes = std::numeric_limits<std::size_t>::max();  // engine_traits::state_bytes
+        std::size_t max_object_bytes = std::numeric_limits<std::size_t>::max(); // sizeof(E), buffer included
+    };
+
+    template <class E>
+    constexpr bool meets(const engine_requirements& r) noexcept
+    {
+        using T = engine_traits<E>;
+        if (T::state_bytes > r.max_state_bytes || sizeof(E) > r.max_object_bytes) return false;
+        if (T::period_log2 < r.min_period_log2) return false;
+        if (r.random_access && !T::random_access) return false;
+        if (r.streams_log2 > 0 || r.stream_length_log2 > 0)
+            return T::streams_log2 >= r.streams_log2 && T::jump_log2 >= r.stream_length_log2 && T::jump_log2 > 0;
+        return true;
+    }
+
+    namespace traits_detail {
+
+        template <engine_requirements R>
+        inline constexpr bool no_match = false;
+
+        template <engine_requirements R, class... E>
+        struct first_meeting {
+            static_assert(no_match<R>, "select_engine: no library engine meets the requirements");
+        };
+
+        // The rest of the list is only instantiated when E does not match
+        template <engine_requirements R, class E, class... Rest>
+        struct first_meeting<R, E, Rest...>
+            : std::conditional_t<meets<E>(R), std::type_identity<E>, first_meeting<R, Rest...>> {};
+
+    } // namespace traits_detail
+
+    // Preference order: fastest first, Nasam1024 for what only it provides
+    template <engine_requirements R>
+    using select_engine = typename traits_detail::first_meeting<R, fast, SplitMix64, wyrand, Nasam1024>::type;
+
+} // namespace RNG
@@ -0,0 +1,175 @@
+#pragma once
+// file RNG_views.h
+//
+// C++20 range views over engine output.
+//
+//      RNG::views::random(engine)
+//          Infinite input range over the engine's stream. Reads the engine in
+//          blocks of 64 words through its bulk path, so
+//              views::random(rng) | std::views::take(n) | std::views::transform(f)
+//          costs an array read per element instead of an operator() call.
+//          The engine is referenced, not copied, and must outlive the view.
+//          Words read ahead into the block but not consumed are lost: after
+//          the view is gone the engine is up to 63 words further on than the
+//          number of elements read.
+//
+//      RNG::views::random_at(seed, RNG::engine_kind<E>)
+//          Random-access, sized view: element i is output i of E(seed),
+//          computed directly from the counter (E::at(i)) rather than by
+//          stepping the engine. Slicing (std::views::drop / take, slice())
+//          is O(1), and elements can be computed in any order and on any
+//          thread: split a range by index to parallelize it.
+//          Size: 2^63 - 1 elements (the largest difference_type).
+//
+// Example
+//      RNG::fast rng(42);
+//      for (double x : RNG::views::random(rng) | std::views::take(1000)
+//                      | std::views::transform([](u64 w) { return (w >> 11) * 0x1.0p-53; }))
+//          ...
+//
+//      auto v = RNG::views::random_at(42, RNG::engine_kind<RNG::fast>);
+//      u64 w = v[1'000'000'000];                   // no stepping
+//      auto part = v.slice(t * n, n);              // thread t's share
+
+#define NOMINMAX
+#include <array>
+#include <compare>
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <limits>
+#include <ranges>
+
+#include "common.h"
+
+namespace RNG {
+
+    // Selects the engine of views::random_at
+    template <class E> struct engine_kind_t { using type = E; };
+    template <class E> inline constexpr engine_kind_t<E> engine_kind{};
+
+    namespace views {
+
+        // ------------------------------------------------------------------
+        // random(engine): infinite input range, block buffered
+        // ------------------------------------------------------------------
+        template <class E>
+        class random_view : public std::ranges::view_interface<random_view<E>> {
+            static constexpr std::size_t BLOCK = 64;
+
+            E* engine_ = nullptr;
+            std::array<u64, BLOCK> block_{};
+            std::size_t pos_ = BLOCK;
+
+            void refill()
+            {
+                fill_words(*engine_, block_.data(), BLOCK);
+                pos_ = 0;
+            }
+
+        public:
+            random_view() = default;
+            explicit random_view(E& engine) : engine_(&engine) {}
+
+            class iterator {
+                random_view* view_ = nullptr;
+
+            public:
+                using iterator_concept = std::input_iterator_tag;
+                using value_type = u64;
+                using difference_type = std::ptrdiff_t;
+
+                iterator() = default;
+                explicit iterator(random_view* view) noexcept : view_(view) {}
+
+                u64 operator*() const noexcept { return view_->block_[view_->pos_]; }
+                iterator& operator++()
+                {
+                    if (++view_->pos_ == BLOCK)
+                        view_->refill();
+                    return *this;
+                }
+                void operator++(int) { ++*this; }
+            };
+
+            iterator begin()
+            {
+                if (pos_ == BLOCK)
+                    refill();
+                return iterator(this);
+            }
+            std::unreachable_sentinel_t end() const noexcept { return {}; }
+        };
+
+        template <class E>
+        random_view<E> random(E& engine) { return random_view<E>(engine); }
+
+        // ------------------------------------------------------------------
+        // random_at(seed, kind): random-access, counter mode
+        // ------------------------------------------------------------------
+        template <class E>
+            requires requires(const E & e, u64 n) { { e.at(n) } -> std::convertible_to<u64>; }
+        class random_at_view : public std::ranges::view_interface<random_at_view<E>> {
+            E origin_{ 0ull }; // engine positioned at element 0
+            u64 first_ = 0;
+            u64 last_ = static_cast<u64>(std::numeric_limits<std::ptrdiff_t>::max());
+
+        public:
+            random_at_view() = default;
+            explicit random_at_view(const E& origin) : origin_(origin) {}
+            random_at_view(const E& origin, u64 first, u64 last) : origin_(origin), first_(first), last_(last) {}
+
+            class iterator {
+                const E* origin_ = nullptr;
+                u64 i_ = 0;
+
+            public:
+                using iterator_concept = std::random_access_iterator_tag;
+                using iterator_category = std::input_iterator_tag; // operator* returns by value
+                using value_type = u64;
+                using difference_type = std::ptrdiff_t;
+
+                iterator() = default;
+                iterator(const E* origin, u64 i) noexcept : origin_(origin), i_(i) {}
+
+                u64 operator*() const noexcept { return origin_->at(i_); }
+                u64 operator[](difference_type d) const noexcept { return origin_->at(i_ + static_cast<u64>(d)); }
+                u64 index() const noexcept { return i_; }
+
+                iterator& operator++() noexcept { ++i_; return *this; }
+                iterator operator++(int) noexcept { iterator t = *this; ++i_; return t; }
+                iterator& operator--() noexcept { --i_; return *this; }
+                iterator operator--(int) noexcept { iterator t = *this; --i_; return t; }
+                iterator& operator+=(difference_type d) noexcept { i_ += static_cast<u64>(d); return *this; }
+                iterator& operator-=(difference_type d) noexcept { i_ -= static_cast<u64>(d); return *this; }
+
+                friend iterator operator+(iterator it, difference_type d) noexcept { return it += d; }
+                friend iterator operator+(difference_type d, iterator it) noexcept { return it += d; }
+                friend iterator operator-(iterator it, difference_type d) noexcept { return it -= d; }
+                friend difference_type operator-(const iterator& a, const iterator& b) noexcept {
+                    return static_cast<difference_type>(a.i_ - b.i_);
+                }
+                friend bool operator==(const iterator& a, const iterator& b) noexcept { return a.i_ == b.i_; }
+                friend std::strong_ordering operator<=>(const iterator& a, const iterator& b) noexcept { return a.i_ <=> b.i_; }
+            };
+
+            iterator begin() const noexcept { return iterator(&origin_, first_); }
+            iterator end() const noexcept { return iterator(&origin_, last_); }
+            u64 size() const noexcept { return last_ - first_; }
+
+            // Elements [first, first + count) of this view
+            random_at_view slice(u64 first, u64 count) const noexcept
+            {
+                return random_at_view(origin_, first_ + first, first_ + first + count);
+            }
+        };
+
+        template <class E>
+        random_at_view<E> random_at(u64 seed, engine_kind_t<E> = {})
+        {
+            return random_at_view<E>(E(seed));
+        }
+
+    } // namespace views
+
+} // namespace RNG
@@ -1,7 +1,12 @@
 #pragma once
 #define NOMINMAX
 #include "common.h"
+#include "RNG_engine.h"
+#include "RNG_mix.h"
+#include "RNG_stats.h"
+#if defined(_MSC_VER)
 #include <intrin.h>
+#endif
 namespace RNG {
     /* Ultra-minimal wyrand variant
      *
@@ -13,27 +18,30 @@ namespace RNG {
      * Not cryptographically secure.
      * Thread-safe if each thread has its own instance.
      */
-    struct wyrand {
+    struct wyrand : engine_base<wyrand> {
         std::uint64_t state;
 
+        using result_type = std::uint64_t;
+
         wyrand() {
             RNG_platform::get_entropy((unsigned char*) & state, sizeof(state));
         }
-        constexpr wyrand(std::uint64_t seed = 0x2d358dccaa6c78a5ull) noexcept
+        constexpr wyrand(std::uint64_t seed) noexcept
             : state(seed) {
         }
 
         inline std::uint64_t operator()() noexcept
         {
-            state += 0x2d358dccaa6c78a5ull;
+            stats::count<wyrand>(stats::draws);
+            state += WY_P0;
 
             std::uint64_t lo, hi;
 
 #if defined(_MSC_VER)
-            lo = _umul128(state, state ^ 0x8bb84b93962eacc9ull, &hi);
+            lo = _umul128(state, state ^ WY_P1, &hi);
 #elif defined(__SIZEOF_INT128__)
             unsigned __int128 product = static_cast<unsigned __int128>(state) *
-                (state ^ 0x8bb84b93962eacc9ull);
+                (state ^ WY_P1);
             lo = static_cast<std::uint64_t>(product);
             hi = static_cast<std::uint64_t>(product >> 64);
 #else
@@ -43,6 +51,68 @@ namespace RNG {
             return lo ^ hi ^ state;
         }
 
+        // Internal iteration: the next n outputs, the same ones n calls to
+        // operator() would return, with the state in a local for the whole
+        // loop. for_each_block() passes them to f in blocks
+        // (std::span<const std::uint64_t>) of at most 64 words, generate_n()
+        // one at a time. f must not use this engine.
+        template <class F>
+        void for_each_block(std::uint64_t n, F&& f)
+        {
+            stats::count<wyrand>(stats::bulk_bytes, n * sizeof(std::uint64_t));
+            std::uint64_t s = state;
+            std::array<std::uint64_t, 64> block;
+            while (n > 0) {
+                const std::size_t k = static_cast<std::size_t>(std::min<std::uint64_t>(n, block.size()));
+                for (std::size_t i = 0; i < k; ++i)
+                    block[i] = mix(s += WY_P0);
+                state = s;
+                f(std::span<const std::uint64_t>(block.data(), k));
+                n -= k;
+            }
+        }
+
+        template <class F>
+        void generate_n(std::uint64_t n, F&& f)
+        {
+            stats::count<wyrand>(stats::bulk_bytes, n * sizeof(std::uint64_t));
+            std::uint64_t s = state;
+            for (std::uint64_t i = 0; i < n; ++i)
+                f(mix(s += WY_P0));
+            state = s;
+        }
+
+        // n-th output from the current position (0 = the next one) without advancing
+        inline std::uint64_t at(std::uint64_t n) const noexcept
+        {
+            return mix(state + (n + 1) * WY_P0);
+        }
+
+        // Skip n outputs: the state is a Weyl sequence, so one multiply-add
+        wyrand& discard(std::uint64_t n) noexcept
+        {
+            stats::count<wyrand>(stats::discards);
+            state += n * WY_P0;
+            return *this;
+        }
+
+        static constexpr result_type min() noexcept { return 0; }
+        static constexpr result_type max() noexcept { return std::numeric_limits<result_type>::max(); }
+
+        // Compact binary checkpoint (see RNG_checkpoint.h)
+        static constexpr std::size_t CHECKPOINT_BYTES = 8;
+        void checkpoint(std::uint8_t* out) const noexcept { std::memcpy(out, &state, sizeof(state)); }
+        void restore(const std::uint8_t* in) noexcept { std::memcpy(&state, in, sizeof(state)); }
+
+    private:
+        // Output for an already advanced state s
+        static std::uint64_t mix(std::uint64_t s) noexcept
+        {
+            std::uint64_t hi;
+            const std::uint64_t lo = RNG::umul128(s, s ^ WY_P1, &hi);
+            return lo ^ hi ^ s;
+        }
+
     };
 
 } // namespace RNG
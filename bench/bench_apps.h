@@ -0,0 +1,374 @@
+#pragma once
+// file bench/bench_apps.h
+//
+// End-to-end application benchmarks. Each one is a complete, small workload
+// shaped like a real hot loop, run on every engine at every thread count, and
+// reports wall-clock seconds for the whole job (thread start-up included).
+//
+//      option_pricing   Monte-Carlo price of an arithmetic Asian call,
+//                       Gaussian GBM paths via std::normal_distribution
+//      pi               pi estimate from points in the unit square
+//      random_walk      2D lattice random walks, one draw per step
+//      shuffle          Fisher-Yates shuffle of 10^8 uint32 values
+//                       (multi-threaded: random bucket scatter, then one
+//                       Fisher-Yates per bucket, which is still a uniform
+//                       permutation)
+//      zipf             Zipf(s = 0.99) keys over 10^7 items, rejection-inversion
+//
+// Work per job is fixed so that times are comparable across thread counts;
+// opt.app_scale shrinks or grows every job (e.g. --scale 0.01 for a quick run).
+// Every thread uses its own engine from RNG::make_stream().
+
+#define NOMINMAX
+#include <cmath>
+#include <cstdint>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "bench_common.h"
+#include "bench_engines.h"
+
+namespace RNG_bench {
+
+    namespace app_detail {
+
+        // Run f(thread_index) on 'threads' threads and wait for all of them.
+        template <class F>
+        void run_threads(unsigned threads, F&& f)
+        {
+            if (threads == 1) {
+                f(0u);
+                return;
+            }
+            std::vector<std::thread> pool;
+            pool.reserve(threads);
+            for (unsigned t = 0; t < threads; ++t)
+                pool.emplace_back([&f, t] { f(t); });
+            for (auto& th : pool)
+                th.join();
+        }
+
+        // [begin, end) of part t when n items are split into 'parts' parts
+        inline std::size_t part_begin(std::size_t n, unsigned parts, unsigned t) noexcept {
+            return (n / parts) * t + ((n % parts) * t) / parts;
+        }
+
+        // Double in [0, 1) from the top 53 bits
+        inline double to_unit(std::uint64_t x) noexcept {
+            return static_cast<double>(x >> 11) * 0x1.0p-53;
+        }
+
+        // Unbiased integer in [0, range) - Lemire's multiply-shift with rejection
+        template <class G>
+        inline std::uint64_t bounded(G& g, std::uint64_t range) noexcept
+        {
+            std::uint64_t hi;
+            std::uint64_t lo = RNG::umul128(g(), range, &hi);
+            if (lo < range) [[unlikely]] {
+                const std::uint64_t t = (0 - range) % range;
+                while (lo < t)
+                    lo = RNG::umul128(g(), range, &hi);
+            }
+            return hi;
+        }
+
+        // -------------------------------------------------------------------
+        // Workloads. Each takes (engine, share of the job) and returns a value
+        // that depends on every draw, so nothing can be optimized away.
+        // -------------------------------------------------------------------
+
+        // Arithmetic-average Asian call, S0 = K = 100, r = 5%, sigma = 20%, T = 1
+        template <class E>
+        double option_pricing(E& g, std::size_t paths)
+        {
+            constexpr int STEPS = 64;
+            constexpr double S0 = 100.0, K = 100.0, r = 0.05, sigma = 0.2, T = 1.0;
+            constexpr double dt = T / STEPS;
+            const double drift = (r - 0.5 * sigma * sigma) * dt;
+            const double vol = sigma * std::sqrt(dt);
+
+            std::normal_distribution<double> normal(0.0, 1.0);
+            double payoff_sum = 0.0;
+            for (std::size_t p = 0; p < paths; ++p) {
+                double log_s = std::log(S0);
+                double sum = 0.0;
+                for (int s = 0; s < STEPS; ++s) {
+                    log_s += drift + vol * normal(g);
+                    sum += std::exp(log_s);
+                }
+                const double avg = sum / STEPS;
+                payoff_sum += (avg > K) ? (avg - K) : 0.0;
+            }
+            return std::exp(-r * T) * payoff_sum;
+        }
+
+        template <class E>
+        std::uint64_t pi(E& g, std::size_t points)
+        {
+            std::uint64_t inside = 0;
+            for (std::size_t i = 0; i < points; ++i) {
+                const std::uint64_t z = g();
+                // two 32-bit coordinates from one draw
+                const double x = static_cast<double>(static_cast<std::uint32_t>(z)) * 0x1.0p-32;
+                const double y = static_cast<double>(z >> 32) * 0x1.0p-32;
+                inside += (x * x + y * y < 1.0);
+            }
+            return inside;
+        }
+
+        template <class E>
+        std::int64_t random_walk(E& g, std::size_t walkers, std::size_t steps)
+        {
+            static constexpr int DX[4] = { 1, -1, 0, 0 };
+            static constexpr int DY[4] = { 0, 0, 1, -1 };
+            std::int64_t dist2 = 0;
+            for (std::size_t w = 0; w < walkers; ++w) {
+                std::int64_t x = 0, y = 0;
+                for (std::size_t s = 0; s < steps; ++s) {
+                    const unsigned dir = static_cast<unsigned>(g() >> 62);
+                    x += DX[dir];
+                    y += DY[dir];
+                }
+                dist2 += x * x + y * y;
+            }
+            return dist2;
+        }
+
+        // Zipf sampler by rejection-inversion (Hoermann & Derflinger, 1996),
+        // following the formulation in Apache Commons RNG. O(1) per sample, no tables.
+        class zipf_sampler {
+            double s_, h_x1_, h_n_, sv_;
+            std::uint64_t n_;
+
+            static double helper1(double x) noexcept { // log1p(x)/x
+                return std::abs(x) > 1e-8 ? std::log1p(x) / x : 1.0 - x * (0.5 - x * (1.0 / 3.0 - 0.25 * x));
+            }
+            static double helper2(double x) noexcept { // expm1(x)/x
+                return std::abs(x) > 1e-8 ? std::expm1(x) / x : 1.0 + x * 0.5 * (1.0 + x / 3.0 * (1.0 + 0.25 * x));
+            }
+            double h(double x) const noexcept { return std::exp(-s_ * std::log(x)); }
+            double h_integral(double x) const noexcept {
+                const double lx = std::log(x);
+                return helper2((1.0 - s_) * lx) * lx;
+            }
+            double h_integral_inverse(double x) const noexcept {
+                double t = x * (1.0 - s_);
+                if (t < -1.0) t = -1.0;
+                return std::exp(helper1(t) * x);
+            }
+
+        public:
+            zipf_sampler(std::uint64_t n, double s) : s_(s), n_(n) {
+                h_x1_ = h_integral(1.5) - 1.0;
+                h_n_ = h_integral(static_cast<double>(n) + 0.5);
+                sv_ = 2.0 - h_integral_inverse(h_integral(2.5) - h(2.0));
+            }
+
+            template <class E>
+            std::uint64_t operator()(E& g) const noexcept {
+                for (;;) {
+                    const double u = h_n_ + to_unit(g()) * (h_x1_ - h_n_);
+                    const double x = h_integral_inverse(u);
+                    double k = std::floor(x + 0.5);
+                    if (k < 1.0) k = 1.0;
+                    else if (k > static_cast<double>(n_)) k = static_cast<double>(n_);
+                    if (k - x <= sv_ || u >= h_integral(k + 0.5) - h(k))
+                        return static_cast<std::uint64_t>(k);
+                }
+            }
+        };
+
+        template <class E>
+        std::uint64_t zipf(E& g, std::size_t keys)
+        {
+            static const zipf_sampler sampler(10'000'000, 0.99);
+            std::uint64_t acc = 0;
+            for (std::size_t i = 0; i < keys; ++i)
+                acc += sampler(g);
+            return acc;
+        }
+
+        // Shuffle 'data' with 'threads' threads.
+        //
+        // One thread: plain Fisher-Yates. Several threads: every thread sends
+        // each element of its slice to a uniformly random bucket (two passes:
+        // count, then scatter), then each thread Fisher-Yates-shuffles one
+        // bucket. Uniform bucket assignment followed by uniform permutations
+        // of the buckets yields a uniform permutation of the whole array.
+        template <class E>
+        void shuffle(std::vector<std::uint32_t>& data, std::vector<std::uint32_t>& scratch,
+            std::vector<E>& engines, unsigned threads)
+        {
+            auto fisher_yates = [](E& g, std::uint32_t* p, std::size_t n) {
+                for (std::size_t i = n; i > 1; --i) {
+                    const std::size_t j = static_cast<std::size_t>(bounded(g, i));
+                    std::swap(p[i - 1], p[j]);
+                }
+            };
+
+            if (threads == 1) {
+                fisher_yates(engines[0], data.data(), data.size());
+                return;
+            }
+
+            const std::size_t n = data.size();
+            // counts[t * threads + b]: elements thread t sends to bucket b
+            std::vector<std::size_t> counts(static_cast<std::size_t>(threads) * threads, 0);
+            std::vector<std::uint8_t> bucket_of(n);
+
+            run_threads(threads, [&](unsigned t) {
+                E& g = engines[t];
+                for (std::size_t i = part_begin(n, threads, t); i < part_begin(n, threads, t + 1); ++i) {
+                    const auto b = static_cast<std::uint8_t>(bounded(g, threads));
+                    bucket_of[i] = b;
+                    ++counts[t * threads + b];
+                }
+            });
+
+            // Exclusive prefix sums in bucket-major order give each (thread, bucket)
+            // its write offset; bucket b spans [start[b], start[b + 1]).
+            std::vector<std::size_t> offset(counts.size());
+            std::vector<std::size_t> start(threads + 1, 0);
+            std::size_t pos = 0;
+            for (unsigned b = 0; b < threads; ++b) {
+                start[b] = pos;
+                for (unsigned t = 0; t < threads; ++t) {
+                    offset[t * threads + b] = pos;
+                    pos += counts[t * threads + b];
+                }
+            }
+            start[threads] = pos;
+
+            run_threads(threads, [&](unsigned t) {
+                std::size_t* off = &offset[static_cast<std::size_t>(t) * threads];
+                for (std::size_t i = part_begin(n, threads, t); i < part_begin(n, threads, t + 1); ++i)
+                    scratch[off[bucket_of[i]]++] = data[i];
+            });
+
+            run_threads(threads, [&](unsigned b) {
+                fisher_yates(engines[b], scratch.data() + start[b], start[b + 1] - start[b]);
+            });
+
+            data.swap(scratch);
+        }
+
+        inline std::vector<unsigned> thread_counts(const options& opt)
+        {
+            std::vector<unsigned> counts;
+            for (unsigned t = 1; t < opt.max_threads; t *= 2)
+                counts.push_back(t);
+            counts.push_back(opt.max_threads);
+            return counts;
+        }
+
+        inline std::size_t scaled(const options& opt, double n) {
+            return std::max<std::size_t>(1, static_cast<std::size_t>(n * opt.app_scale));
+        }
+
+        template <class E>
+        std::vector<E> make_streams(unsigned threads)
+        {
+            std::vector<E> engines;
+            engines.reserve(threads);
+            for (unsigned t = 0; t < threads; ++t)
+                engines.push_back(RNG::make_stream<E>(SEED, t));
+            return engines;
+        }
+
+        // Time one job: fresh streams per repetition, 'work(engine, t)' on every thread.
+        template <class E, class Work>
+        void run_job(reporter& rep, const options& opt, const std::string& name, unsigned threads, Work work)
+        {
+            result r;
+            r.suite = "apps";
+            r.name = name;
+            r.engine = engine_name<E>::value;
+            r.mode = "end-to-end";
+            r.threads = threads;
+            r.unit = "s";
+            r.higher_is_better = false;
+
+            for (int rep_i = 0; rep_i < opt.repetitions; ++rep_i) {
+                std::vector<E> engines = make_streams<E>(threads);
+                std::vector<double> sinks(threads, 0.0);
+                const auto t0 = clock::now();
+                run_threads(threads, [&](unsigned t) {
+                    sinks[t] = static_cast<double>(work(engines[t], threads, t));
+                });
+                r.values.push_back(seconds_since(t0));
+                do_not_optimize(sinks.data());
+                clobber_memory();
+            }
+            rep.add(std::move(r));
+        }
+
+    } // namespace app_detail
+
+    // Runs the application suite. Returns the number of failed checks (always 0).
+    inline int run_apps(reporter& rep, const options& opt)
+    {
+        using namespace app_detail;
+
+        const std::size_t PATHS = scaled(opt, 1e6);
+        const std::size_t POINTS = scaled(opt, 4e8);
+        const std::size_t WALKERS = scaled(opt, 1e4), WALK_STEPS = 10'000;
+        const std::size_t SHUFFLE_N = scaled(opt, 1e8);
+        const std::size_t KEYS = scaled(opt, 1e8);
+
+        auto share = [](std::size_t n, unsigned threads, unsigned t) {
+            return part_begin(n, threads, t + 1) - part_begin(n, threads, t);
+        };
+
+        for_each_engine(opt, [&]<class E>(std::type_identity<E>) {
+            for (unsigned threads : thread_counts(opt)) {
+                if constexpr (std_usable<E>) {
+                    if (opt.wants_name("option_pricing"))
+                        run_job<E>(rep, opt, "option_pricing", threads, [&](E& g, unsigned T, unsigned t) {
+                            return option_pricing(g, share(PATHS, T, t));
+                        });
+                }
+                if (opt.wants_name("pi"))
+                    run_job<E>(rep, opt, "pi", threads, [&](E& g, unsigned T, unsigned t) {
+                        return pi(g, share(POINTS, T, t));
+                    });
+                if (opt.wants_name("random_walk"))
+                    run_job<E>(rep, opt, "random_walk", threads, [&](E& g, unsigned T, unsigned t) {
+                        return random_walk(g, share(WALKERS, T, t), WALK_STEPS);
+                    });
+                if (opt.wants_name("zipf"))
+                    run_job<E>(rep, opt, "zipf", threads, [&](E& g, unsigned T, unsigned t) {
+                        return zipf(g, share(KEYS, T, t));
+                    });
+
+                if (opt.wants_name("shuffle") && threads <= 256) {
+                    result r;
+                    r.suite = "apps";
+                    r.name = "shuffle";
+                    r.engine = engine_name<E>::value;
+                    r.mode = "end-to-end";
+                    r.threads = threads;
+                    r.unit = "s";
+                    r.higher_is_better = false;
+
+                    std::vector<std::uint32_t> data(SHUFFLE_N), scratch(threads > 1 ? SHUFFLE_N : 0);
+                    for (int rep_i = 0; rep_i < opt.repetitions; ++rep_i) {
+                        for (std::size_t i = 0; i < SHUFFLE_N; ++i)
+                            data[i] = static_cast<std::uint32_t>(i);
+                        std::vector<E> engines = make_streams<E>(threads);
+                        const auto t0 = clock::now();
+                        shuffle(data, scratch, engines, threads);
+                        r.values.push_back(seconds_since(t0));
+                        do_not_optimize(data.data());
+                        clobber_memory();
+                    }
+                    rep.add(std::move(r));
+                }
+            }
+        });
+
+        return 0;
+    }
+
+} // namespace RNG_bench
@@ -0,0 +1,204 @@
+#pragma once
+// file bench/bench_common.h
+//
+// Shared infrastructure for the RNG benchmark suites: timing, calibration,
+// result collection and JSON output. Every suite reports through
+// RNG_bench::reporter so that one run produces one table and one JSON file.
+//
+// A result is identified by (suite, name, engine, mode, threads). Each result
+// keeps every repetition, not just a summary, so that runs can be compared
+// statistically later.
+
+#define NOMINMAX
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#if defined(_MSC_VER)
+#include <intrin.h> // _ReadWriteBarrier
+#endif
+
+namespace RNG_bench {
+
+    using clock = std::chrono::steady_clock;
+
+    // Keep 'value' alive without letting the compiler see how it is used.
+    template <class T>
+    inline void do_not_optimize(const T& value) noexcept
+    {
+#if defined(_MSC_VER)
+        static volatile const void* sink;
+        sink = &value;
+        _ReadWriteBarrier();
+#else
+        asm volatile("" : : "r,m"(value) : "memory");
+#endif
+    }
+
+    // Force pending stores to be treated as observable.
+    inline void clobber_memory() noexcept
+    {
+#if defined(_MSC_VER)
+        _ReadWriteBarrier();
+#else
+        asm volatile("" : : : "memory");
+#endif
+    }
+
+    inline double seconds_since(clock::time_point start) noexcept
+    {
+        return std::chrono::duration<double>(clock::now() - start).count();
+    }
+
+    // Run-wide settings, filled in from the command line by rng_bench.cpp
+    struct options {
+        int repetitions = 5;          // timed repetitions per benchmark
+        double min_seconds = 0.05;    // minimum duration of one repetition
+        std::string engine_filter;    // only engines whose name contains this
+        std::string name_filter;      // only benchmarks whose name contains this
+        double inline_threshold = 1.10; // see bench_distributions.h
+        bool strict_inline = false;     // a low inline gain fails the run
+        double app_scale = 1.0;         // work multiplier for bench_apps.h
+        unsigned max_threads = std::max(1u, std::thread::hardware_concurrency());
+
+        bool wants_engine(const std::string& engine) const {
+            return engine_filter.empty() || engine.find(engine_filter) != std::string::npos;
+        }
+        bool wants_name(const std::string& name) const {
+            return name_filter.empty() || name.find(name_filter) != std::string::npos;
+        }
+    };
+
+    struct result {
+        std::string suite;           // e.g. "distributions"
+        std::string name;            // e.g. "normal_distribution<double>"
+        std::string engine;          // e.g. "Nasam1024"
+        std::string mode;            // e.g. "scalar", "bulk"
+        unsigned threads = 1;
+        std::string unit;            // e.g. "samples/s", "s"
+        bool higher_is_better = true;
+        std::vector<double> values;  // one entry per repetition
+
+        std::string id() const {
+            return suite + "/" + name + "/" + engine + "/" + mode + "/t" + std::to_string(threads);
+        }
+
+        double median() const {
+            if (values.empty()) return 0.0;
+            std::vector<double> v = values;
+            std::sort(v.begin(), v.end());
+            const std::size_t m = v.size() / 2;
+            return (v.size() % 2) ? v[m] : 0.5 * (v[m - 1] + v[m]);
+        }
+    };
+
+    // Format a value with an SI prefix, e.g. 1.234e9 -> "1.234 G"
+    inline std::string si(double v)
+    {
+        static const char* prefix[] = { "", "k", "M", "G", "T" };
+        int p = 0;
+        while (v >= 1000.0 && p < 4) { v /= 1000.0; ++p; }
+        std::ostringstream os;
+        os << std::fixed << std::setprecision(3) << v << ' ' << prefix[p];
+        return os.str();
+    }
+
+    // Rates ("x/s") get an SI prefix, everything else is printed as is.
+    inline std::string format(double v, const std::string& unit)
+    {
+        if (unit.size() > 2 && unit.compare(unit.size() - 2, 2, "/s") == 0)
+            return si(v);
+        std::ostringstream os;
+        os << std::fixed << std::setprecision(3) << v << ' ';
+        return os.str();
+    }
+
+    // Collects results, prints one line per result as it arrives and writes JSON at the end.
+    class reporter {
+        std::vector<result> results_;
+        std::ostream* out_;
+
+    public:
+        explicit reporter(std::ostream& out = std::cout) : out_(&out) {}
+
+        void add(result r) {
+            *out_ << std::left
+                << std::setw(14) << r.suite << ' '
+                << std::setw(44) << r.name << ' '
+                << std::setw(12) << r.engine << ' '
+                << std::setw(11) << r.mode << ' '
+                << std::setw(3) << r.threads << ' '
+                << std::right << std::setw(12) << format(r.median(), r.unit) << r.unit << '\n';
+            results_.push_back(std::move(r));
+        }
+
+        const std::vector<result>& results() const noexcept { return results_; }
+
+        void write_json(std::ostream& os, const std::string& machine) const {
+            os << "{\n  \"format\": \"rng_bench/1\",\n  \"machine\": " << quoted(machine)
+                << ",\n  \"results\": [\n";
+            for (std::size_t i = 0; i < results_.size(); ++i) {
+                const result& r = results_[i];
+                os << "    {\"suite\": " << quoted(r.suite)
+                    << ", \"name\": " << quoted(r.name)
+                    << ", \"engine\": " << quoted(r.engine)
+                    << ", \"mode\": " << quoted(r.mode)
+                    << ", \"threads\": " << r.threads
+                    << ", \"unit\": " << quoted(r.unit)
+                    << ", \"higher_is_better\": " << (r.higher_is_better ? "true" : "false")
+                    << ", \"values\": [";
+                for (std::size_t k = 0; k < r.values.size(); ++k)
+                    os << (k ? ", " : "") << std::setprecision(17) << r.values[k];
+                os << "]}" << (i + 1 < results_.size() ? "," : "") << '\n';
+            }
+            os << "  ]\n}\n";
+        }
+
+    private:
+        static std::string quoted(const std::string& s) {
+            std::string q = "\"";
+            for (char c : s) {
+                if (c == '"' || c == '\\') q += '\\';
+                q += c;
+            }
+            return q + '"';
+        }
+    };
+
+    // Measure the throughput of body(n), which must perform n units of work.
+    //
+    // n is first calibrated so that one call takes at least opt.min_seconds,
+    // then the call is repeated opt.repetitions times. Returns units/second
+    // for every repetition.
+    template <class Body>
+    std::vector<double> measure_rate(const options& opt, Body&& body)
+    {
+        std::size_t n = 1024;
+        for (;;) {
+            const auto t0 = clock::now();
+            body(n);
+            const double dt = seconds_since(t0);
+            if (dt >= opt.min_seconds) break;
+            // Grow towards the target, at most 10x at a time.
+            const double factor = (dt > 0) ? std::min(10.0, 1.2 * opt.min_seconds / dt) : 10.0;
+            n = static_cast<std::size_t>(static_cast<double>(n) * std::max(2.0, factor));
+        }
+
+        std::vector<double> rates;
+        rates.reserve(opt.repetitions);
+        for (int r = 0; r < opt.repetitions; ++r) {
+            const auto t0 = clock::now();
+            body(n);
+            rates.push_back(static_cast<double>(n) / seconds_since(t0));
+        }
+        return rates;
+    }
+
+} // namespace RNG_bench
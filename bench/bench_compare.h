@@ -0,0 +1,333 @@
+#pragma once
+// file bench/bench_compare.h
+//
+// Regression check against a stored baseline.
+//
+// A baseline is an ordinary rng_bench JSON file, saved per machine as
+// <baseline-dir>/<machine>.json (see rng_bench.cpp: --save-baseline, --compare).
+// Every result present in both runs is compared repetition by repetition:
+//
+//      change   relative change of the median, signed so that negative is worse
+//      p        one-sided Mann-Whitney U p-value for "the current run is worse"
+//
+// A result is a regression when change < -threshold AND p < alpha. Requiring
+// both keeps noisy-but-unchanged results and tiny-but-real shifts from
+// failing the run. With 5 repetitions on each side the smallest attainable
+// p is 1/252, so alpha = 0.01 needs at least 5 repetitions; use more on noisy
+// machines.
+
+#define NOMINMAX
+#include <algorithm>
+#include <cctype>
+#include <cmath>
+#include <cstdlib>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#if !defined(_WIN32)
+#include <unistd.h> // gethostname
+#endif
+
+#include "bench_common.h"
+
+namespace RNG_bench {
+
+    // Name used for the per-machine baseline file
+    inline std::string machine_name()
+    {
+#if defined(_WIN32)
+        if (const char* name = std::getenv("COMPUTERNAME"))
+            return name;
+#else
+        char buf[256] = {};
+        if (gethostname(buf, sizeof(buf) - 1) == 0 && buf[0] != '\0')
+            return buf;
+#endif
+        return "unknown";
+    }
+
+    // ---------------------------------------------------------------------
+    // Minimal JSON reader - enough for the files reporter::write_json writes
+    // ---------------------------------------------------------------------
+    namespace json {
+
+        struct value {
+            enum kind_t { null_v, bool_v, number_v, string_v, array_v, object_v } kind = null_v;
+            bool boolean = false;
+            double number = 0.0;
+            std::string string;
+            std::vector<value> array;
+            std::map<std::string, value> object;
+
+            const value& operator[](const std::string& key) const {
+                auto it = object.find(key);
+                if (kind != object_v || it == object.end())
+                    throw std::runtime_error("json: missing key '" + key + "'");
+                return it->second;
+            }
+            bool has(const std::string& key) const {
+                return kind == object_v && object.count(key) != 0;
+            }
+        };
+
+        class parser {
+            const std::string& s_;
+            std::size_t i_ = 0;
+
+            [[noreturn]] void fail(const char* what) const {
+                throw std::runtime_error(std::string("json: ") + what + " at offset " + std::to_string(i_));
+            }
+            void skip_ws() {
+                while (i_ < s_.size() && std::isspace(static_cast<unsigned char>(s_[i_]))) ++i_;
+            }
+            bool consume(char c) {
+                skip_ws();
+                if (i_ < s_.size() && s_[i_] == c) { ++i_; return true; }
+                return false;
+            }
+            void expect(char c) {
+                if (!consume(c)) fail("unexpected character");
+            }
+            bool literal(const char* word) {
+                const std::size_t n = std::char_traits<char>::length(word);
+                if (s_.compare(i_, n, word) == 0) { i_ += n; return true; }
+                return false;
+            }
+
+            std::string parse_string() {
+                expect('"');
+                std::string out;
+                while (i_ < s_.size() && s_[i_] != '"') {
+                    char c = s_[i_++];
+                    if (c == '\\') {
+                        if (i_ >= s_.size()) fail("bad escape");
+                        c = s_[i_++];
+                        switch (c) {
+                        case 'n': c = '\n'; break;
+                        case 't': c = '\t'; break;
+                        case 'r': c = '\r'; break;
+                        case 'b': c = '\b'; break;
+                        case 'f': c = '\f'; break;
+                        case 'u': fail("\\u escapes are not supported");
+                        default: break; // '"', '\\', '/'
+                        }
+                    }
+                    out += c;
+                }
+                if (i_ >= s_.size()) fail("unterminated string");
+                ++i_;
+                return out;
+            }
+
+        public:
+            explicit parser(const std::string& s) : s_(s) {}
+
+            value parse() {
+                value v = parse_value();
+                skip_ws();
+                if (i_ != s_.size()) fail("trailing characters");
+                return v;
+            }
+
+            value parse_value() {
+                skip_ws();
+                if (i_ >= s_.size()) fail("unexpected end");
+                value v;
+                const char c = s_[i_];
+                if (c == '{') {
+                    v.kind = value::object_v;
+                    ++i_;
+                    if (consume('}')) return v;
+                    do {
+                        skip_ws();
+                        std::string key = parse_string();
+                        expect(':');
+                        v.object[key] = parse_value();
+                    } while (consume(','));
+                    expect('}');
+                }
+                else if (c == '[') {
+                    v.kind = value::array_v;
+                    ++i_;
+                    if (consume(']')) return v;
+                    do {
+                        v.array.push_back(parse_value());
+                    } while (consume(','));
+                    expect(']');
+                }
+                else if (c == '"') {
+                    v.kind = value::string_v;
+                    v.string = parse_string();
+                }
+                else if (literal("true")) { v.kind = value::bool_v; v.boolean = true; }
+                else if (literal("false")) { v.kind = value::bool_v; v.boolean = false; }
+                else if (literal("null")) { v.kind = value::null_v; }
+                else {
+                    const char* begin = s_.c_str() + i_;
+                    char* end = nullptr;
+                    v.kind = value::number_v;
+                    v.number = std::strtod(begin, &end);
+                    if (end == begin) fail("bad value");
+                    i_ += static_cast<std::size_t>(end - begin);
+                }
+                return v;
+            }
+        };
+
+    } // namespace json
+
+    // Read a file written by reporter::write_json
+    inline std::vector<result> load_results(const std::string& path)
+    {
+        std::ifstream in(path, std::ios::binary);
+        if (!in)
+            throw std::runtime_error("cannot open " + path);
+        std::ostringstream ss;
+        ss << in.rdbuf();
+        const std::string text = ss.str();
+        const json::value root = json::parser(text).parse();
+
+        std::vector<result> out;
+        for (const json::value& j : root["results"].array) {
+            result r;
+            r.suite = j["suite"].string;
+            r.name = j["name"].string;
+            r.engine = j["engine"].string;
+            r.mode = j["mode"].string;
+            r.threads = static_cast<unsigned>(j["threads"].number);
+            r.unit = j["unit"].string;
+            r.higher_is_better = j["higher_is_better"].boolean;
+            for (const json::value& v : j["values"].array)
+                r.values.push_back(v.number);
+            out.push_back(std::move(r));
+        }
+        return out;
+    }
+
+    // ---------------------------------------------------------------------
+    // Mann-Whitney U
+    // ---------------------------------------------------------------------
+
+    // One-sided p-value for H1: values in 'a' tend to be smaller than values in 'b'.
+    //
+    // U counts pairs (a_i, b_j) with a_i > b_j (ties count 1/2); small U supports H1.
+    // Without ties and for small samples the exact null distribution is used,
+    // otherwise the normal approximation with tie and continuity correction.
+    inline double mann_whitney_less(const std::vector<double>& a, const std::vector<double>& b)
+    {
+        const std::size_t n = a.size(), m = b.size();
+        if (n == 0 || m == 0) return 1.0;
+
+        double U = 0.0;
+        bool ties = false;
+        for (double x : a)
+            for (double y : b) {
+                if (x > y) U += 1.0;
+                else if (x == y) { U += 0.5; ties = true; }
+            }
+
+        if (!ties && n <= 30 && m <= 30) {
+            // f(i, j, u): orderings of i a's and j b's with statistic u. The largest
+            // value is either an a (beating all j b's) or a b, so
+            //      f(i, j, u) = f(i - 1, j, u - j) + f(i, j - 1, u).
+            // f[j][u] holds row i - 1 while row i is built in g.
+            const std::size_t max_u = n * m;
+            std::vector<std::vector<double>> f(m + 1, std::vector<double>(max_u + 1, 0.0));
+            for (std::size_t j = 0; j <= m; ++j) f[j][0] = 1.0; // i = 0
+            for (std::size_t i = 1; i <= n; ++i) {
+                std::vector<std::vector<double>> g(m + 1, std::vector<double>(max_u + 1, 0.0));
+                g[0][0] = 1.0;
+                for (std::size_t j = 1; j <= m; ++j)
+                    for (std::size_t u = 0; u <= i * j; ++u)
+                        g[j][u] = (u >= j ? f[j][u - j] : 0.0) + g[j - 1][u];
+                f.swap(g);
+            }
+            double total = 0.0, at_most = 0.0;
+            for (std::size_t u = 0; u <= max_u; ++u) {
+                total += f[m][u];
+                if (static_cast<double>(u) <= U) at_most += f[m][u];
+            }
+            return at_most / total;
+        }
+
+        // Normal approximation
+        std::vector<double> all(a);
+        all.insert(all.end(), b.begin(), b.end());
+        std::sort(all.begin(), all.end());
+        double tie_term = 0.0;
+        for (std::size_t i = 0; i < all.size();) {
+            std::size_t j = i;
+            while (j < all.size() && all[j] == all[i]) ++j;
+            const double t = static_cast<double>(j - i);
+            tie_term += t * t * t - t;
+            i = j;
+        }
+        const double N = static_cast<double>(n + m);
+        const double mean = 0.5 * static_cast<double>(n * m);
+        const double var = static_cast<double>(n * m) / 12.0 * ((N + 1.0) - tie_term / (N * (N - 1.0)));
+        if (var <= 0.0) return 1.0;
+        const double z = (U + 0.5 - mean) / std::sqrt(var);
+        return 0.5 * std::erfc(-z / std::sqrt(2.0));
+    }
+
+    struct compare_options {
+        double threshold = 0.10; // relative median change that counts as a regression
+        double alpha = 0.01;     // significance level
+    };
+
+    // Compare 'current' against 'baseline', print one line per compared result
+    // that changed, and return the number of regressions.
+    inline int compare_results(const std::vector<result>& baseline, const std::vector<result>& current,
+        const compare_options& copt, std::ostream& os = std::cout)
+    {
+        std::map<std::string, const result*> base;
+        for (const result& r : baseline)
+            base[r.id()] = &r;
+
+        int regressions = 0, improvements = 0, compared = 0, unmatched = 0;
+
+        os << "\ncomparison against baseline (threshold " << copt.threshold * 100.0
+            << "%, alpha " << copt.alpha << ")\n";
+
+        for (const result& cur : current) {
+            auto it = base.find(cur.id());
+            if (it == base.end()) { ++unmatched; continue; }
+            const result& old = *it->second;
+            ++compared;
+
+            // Orient so that larger is better
+            const double sign = cur.higher_is_better ? 1.0 : -1.0;
+            std::vector<double> a, b;
+            for (double v : cur.values) a.push_back(sign * v);
+            for (double v : old.values) b.push_back(sign * v);
+
+            const double m_old = old.median(), m_cur = cur.median();
+            if (m_old == 0.0) continue;
+            const double change = sign * (m_cur - m_old) / std::abs(m_old);
+            const double p_worse = mann_whitney_less(a, b);
+            const double p_better = mann_whitney_less(b, a);
+
+            const char* verdict = nullptr;
+            if (change < -copt.threshold && p_worse < copt.alpha) { verdict = "REGRESSION"; ++regressions; }
+            else if (change > copt.threshold && p_better < copt.alpha) { verdict = "improved"; ++improvements; }
+            if (!verdict) continue;
+
+            os << std::left << std::setw(11) << verdict << ' ' << std::setw(72) << cur.id() << std::right
+                << std::fixed << std::setprecision(1) << std::setw(8) << change * 100.0 << "%  p="
+                << std::setprecision(4) << (change < 0 ? p_worse : p_better)
+                << std::defaultfloat << "  (" << format(m_old, cur.unit) << "-> " << format(m_cur, cur.unit)
+                << cur.unit << ")\n";
+        }
+
+        os << compared << " compared, " << regressions << " regression(s), " << improvements
+            << " improvement(s), " << unmatched << " without baseline\n";
+        return regressions;
+    }
+
+} // namespace RNG_bench
@@ -0,0 +1,253 @@
+#pragma once
+// file bench/bench_distributions.h
+//
+// Distribution-level benchmarks: samples per second of the std:: distributions
+// and of the library's own samplers, driven by every engine.
+//
+// Modes
+//      scalar    distribution(engine) - the way most code uses an engine
+//      bulk      distribution(bulk_feed) - the engine fills 256-word blocks
+//                through its fastest block path and the distribution draws
+//                from the block
+//      noinline  distribution(noinline_feed) - same as scalar, but every
+//                engine call goes through a non-inlinable function
+//      generate_n  "store u64[4096]" only: the words come from the engine's
+//                internal iteration instead of a loop over engine()
+//
+// Inline check
+//      For buffered engines (those with a bulk() path), operator() is meant to
+//      inline into the distribution loop so the buffer index stays in a
+//      register. For the cheap consumers the ratio scalar/noinline is reported
+//      as an extra "inline-gain" result. It is stored with the other results,
+//      so a drop shows up when a run is compared against a baseline. A gain
+//      below opt.inline_threshold prints a warning; with --strict-inline it
+//      also counts as a failed check.
+//
+//      The absolute gain depends on how expensive the engine's refill is: for
+//      fast the call overhead is a large part of each sample, for Nasam1024 it
+//      is lost in the cost of the mixer, so compare gains per engine over
+//      time rather than across engines.
+
+#define NOMINMAX
+#include <algorithm>
+#include <cstdint>
+#include <random>
+#include <span>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+#include "bench_common.h"
+#include "bench_engines.h"
+
+namespace RNG_bench {
+
+    namespace dist_detail {
+
+        template <class E>
+        concept has_unbiased = requires(E & e) { { e.unbiased(0ull, 1ull) } -> std::convertible_to<std::uint64_t>; };
+
+        // samples/s of dist(g), n samples per call
+        template <class G, class Dist>
+        std::vector<double> rate_of(const options& opt, G& g, Dist dist)
+        {
+            using R = decltype(dist(g));
+            using Acc = std::conditional_t<std::is_floating_point_v<R>, double, std::uint64_t>;
+            return measure_rate(opt, [&](std::size_t n) {
+                Acc acc = 0;
+                for (std::size_t i = 0; i < n; ++i)
+                    acc += static_cast<Acc>(dist(g));
+                do_not_optimize(acc);
+            });
+        }
+
+        template <class E, class Dist>
+        void run_one(reporter& rep, const options& opt, const std::string& name,
+            const Dist& proto, bool inline_check, int& failures)
+        {
+            if (!opt.wants_name(name)) return;
+            const std::string engine = engine_name<E>::value;
+
+            result base;
+            base.suite = "distributions";
+            base.name = name;
+            base.engine = engine;
+            base.unit = "samples/s";
+
+            E e(SEED);
+
+            result scalar = base;
+            scalar.mode = "scalar";
+            scalar.values = rate_of(opt, e, proto);
+            const std::vector<double> scalar_values = scalar.values;
+            rep.add(std::move(scalar));
+
+            bulk_feed<E> feed(e);
+            result bulk = base;
+            bulk.mode = "bulk";
+            bulk.values = rate_of(opt, feed, proto);
+            rep.add(std::move(bulk));
+
+            if (!inline_check) return;
+
+            noinline_feed<E> slow(e);
+            result noinline = base;
+            noinline.mode = "noinline";
+            noinline.values = rate_of(opt, slow, proto);
+
+            result gain = base;
+            gain.mode = "inline-gain";
+            gain.unit = "x";
+            for (std::size_t i = 0; i < noinline.values.size(); ++i)
+                gain.values.push_back(scalar_values[i] / noinline.values[i]);
+            const double g = gain.median();
+            rep.add(std::move(noinline));
+            rep.add(std::move(gain));
+
+            if (g < opt.inline_threshold) {
+                std::cout << (opt.strict_inline ? "INLINE CHECK FAILED: " : "warning: ")
+                    << engine << " / " << name << ": scalar is only " << g
+                    << "x the non-inlined call (threshold " << opt.inline_threshold
+                    << "x). Is " << engine << "::operator() still inlined?\n";
+                if (opt.strict_inline) ++failures;
+            }
+        }
+
+        // Library sampler: engine.unbiased(lo, hi)
+        template <class E>
+        void run_unbiased(reporter& rep, const options& opt, std::uint64_t lo, std::uint64_t hi)
+        {
+            const std::string name = "unbiased[" + std::to_string(lo) + "," + std::to_string(hi) + "]";
+            if (!opt.wants_name(name)) return;
+
+            E e(SEED);
+            result r;
+            r.suite = "distributions";
+            r.name = name;
+            r.engine = engine_name<E>::value;
+            r.mode = "scalar";
+            r.unit = "samples/s";
+            r.values = measure_rate(opt, [&](std::size_t n) {
+                std::uint64_t acc = 0;
+                for (std::size_t i = 0; i < n; ++i)
+                    acc += e.unbiased(lo, hi);
+                do_not_optimize(acc);
+            });
+            rep.add(std::move(r));
+        }
+
+        // Writing words to a u64 array: a loop over engine() against the
+        // engine's internal iteration (RNG::generate_n). The stores may alias
+        // the engine state, so the loop reloads it after every word.
+        template <class E>
+        void run_store(reporter& rep, const options& opt)
+        {
+            const std::string name = "store u64[4096]";
+            if (!opt.wants_name(name)) return;
+
+            std::vector<std::uint64_t> out(4096);
+            auto run = [&](const char* mode, auto body) {
+                E e(SEED);
+                result r;
+                r.suite = "distributions";
+                r.name = name;
+                r.engine = engine_name<E>::value;
+                r.mode = mode;
+                r.unit = "samples/s";
+                r.values = measure_rate(opt, [&](std::size_t n) {
+                    for (std::size_t done = 0; done < n; done += out.size()) {
+                        body(e, out.data(), std::min(out.size(), n - done));
+                        clobber_memory();
+                    }
+                });
+                rep.add(std::move(r));
+            };
+            run("scalar", [](E& e, std::uint64_t* p, std::size_t n) {
+                for (std::size_t i = 0; i < n; ++i)
+                    p[i] = e();
+            });
+            run("generate_n", [](E& e, std::uint64_t* p, std::size_t n) {
+                RNG::generate_n(e, n, [&](std::uint64_t x) { *p++ = x; });
+            });
+        }
+
+        // Library sampler: engine.fill_uniform(span<double>) against a loop
+        // converting engine() to [0, 1)
+        template <class E>
+        void run_fill_uniform(reporter& rep, const options& opt)
+        {
+            const std::string name = "fill_uniform<double>[4096]";
+            if (!opt.wants_name(name)) return;
+
+            std::vector<double> out(4096);
+            auto run = [&](const char* mode, auto body) {
+                E e(SEED);
+                result r;
+                r.suite = "distributions";
+                r.name = name;
+                r.engine = engine_name<E>::value;
+                r.mode = mode;
+                r.unit = "samples/s";
+                r.values = measure_rate(opt, [&](std::size_t n) {
+                    for (std::size_t done = 0; done < n; done += out.size()) {
+                        body(e, std::span<double>(out.data(), std::min(out.size(), n - done)));
+                        clobber_memory();
+                    }
+                });
+                rep.add(std::move(r));
+            };
+            run("scalar", [](E& e, std::span<double> v) {
+                for (double& x : v)
+                    x = static_cast<double>(e() >> 11) * 0x1.0p-53;
+            });
+            run("bulk", [](E& e, std::span<double> v) { e.fill_uniform(v); });
+        }
+
+    } // namespace dist_detail
+
+    // Runs the distribution suite. Returns the number of failed inline checks.
+    inline int run_distributions(reporter& rep, const options& opt)
+    {
+        int failures = 0;
+
+        for_each_engine(opt, [&]<class E>(std::type_identity<E>) {
+            using namespace dist_detail;
+
+            if constexpr (std_usable<E>) {
+                const bool buffered = has_bulk<E>;
+
+                run_one<E>(rep, opt, "engine()",
+                    [](auto& g) { return g(); }, buffered, failures);
+                run_one<E>(rep, opt, "uniform_int_distribution<int>[0,99]",
+                    std::uniform_int_distribution<int>(0, 99), buffered, failures);
+                run_one<E>(rep, opt, "uniform_int_distribution<u64>[0,1e9]",
+                    std::uniform_int_distribution<std::uint64_t>(0, 1000000000ull), false, failures);
+                run_one<E>(rep, opt, "uniform_real_distribution<double>",
+                    std::uniform_real_distribution<double>(0.0, 1.0), buffered, failures);
+                run_one<E>(rep, opt, "normal_distribution<double>",
+                    std::normal_distribution<double>(0.0, 1.0), false, failures);
+                run_one<E>(rep, opt, "bernoulli_distribution(0.25)",
+                    std::bernoulli_distribution(0.25), false, failures);
+                run_one<E>(rep, opt, "discrete_distribution<int>(8)",
+                    std::discrete_distribution<int>{ 1, 2, 3, 4, 5, 6, 7, 8 }, false, failures);
+            }
+            else {
+                std::cout << "distributions: skipping std:: distributions for " << engine_name<E>::value
+                    << " (not a UniformRandomBitGenerator)\n";
+            }
+
+            run_store<E>(rep, opt);
+
+            if constexpr (has_unbiased<E>) {
+                run_unbiased<E>(rep, opt, 0, 99);
+                run_unbiased<E>(rep, opt, 0, 1000000000ull);
+            }
+
+            if constexpr (requires(E & e, std::span<double> v) { e.fill_uniform(v); })
+                run_fill_uniform<E>(rep, opt);
+        });
+
+        return failures;
+    }
+
+} // namespace RNG_bench
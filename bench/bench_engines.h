@@ -0,0 +1,109 @@
+#pragma once
+// file bench/bench_engines.h
+//
+// The list of engines every benchmark suite runs over, plus small adaptors
+// used to feed std:: distributions in different ways.
+
+#define NOMINMAX
+#include <array>
+#include <concepts>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <random>
+#include <string>
+#include <tuple>
+#include <type_traits>
+
+#include "../RNG_SplitMix64.h"
+#include "../RNG_wyrand.h"
+#include "../RNG_fast.h"
+#include "../Nasam1024.h"
+
+#include "bench_common.h"
+
+namespace RNG_bench {
+
+    // Deterministic seed used by every benchmark, so runs are repeatable.
+    inline constexpr std::uint64_t SEED = 12345ull;
+
+    template <class E> struct engine_name;
+    template <> struct engine_name<RNG::SplitMix64> { static constexpr const char* value = "SplitMix64"; };
+    template <> struct engine_name<RNG::wyrand>     { static constexpr const char* value = "wyrand"; };
+    template <> struct engine_name<RNG::fast>       { static constexpr const char* value = "fast"; };
+    template <> struct engine_name<RNG::Nasam1024>  { static constexpr const char* value = "Nasam1024"; };
+
+    using engine_list = std::tuple<RNG::SplitMix64, RNG::wyrand, RNG::fast, RNG::Nasam1024>;
+
+    // Calls f(std::type_identity<E>{}) for every engine E in engine_list
+    // whose name passes the engine filter.
+    template <class F>
+    void for_each_engine(const options& opt, F&& f)
+    {
+        [&]<class... E>(std::tuple<E...>*) {
+            ([&] {
+                if (opt.wants_engine(engine_name<E>::value))
+                    f(std::type_identity<E>{});
+            }(), ...);
+        }(static_cast<engine_list*>(nullptr));
+    }
+
+    // Engines the std:: distributions accept
+    template <class E>
+    concept std_usable = std::uniform_random_bit_generator<E>;
+
+    // Engines that expose a native block path: bulk(uint8_t*, size_t)
+    template <class E>
+    concept has_bulk = requires(E & e, std::uint8_t * p, std::size_t n) { e.bulk(p, n); };
+
+    // UniformRandomBitGenerator that serves values from a local block which is
+    // refilled from the wrapped engine's bulk path. Used for the "bulk" mode:
+    // the distribution sees a trivially inlinable generator, and the engine
+    // only ever runs its block loop.
+    template <class E, std::size_t N = 256>
+    class bulk_feed {
+        E* engine_;
+        std::array<std::uint64_t, N> block_;
+        std::size_t pos_ = N;
+
+    public:
+        using result_type = std::uint64_t;
+        static constexpr result_type min() noexcept { return 0; }
+        static constexpr result_type max() noexcept { return std::numeric_limits<result_type>::max(); }
+
+        explicit bulk_feed(E& e) noexcept : engine_(&e) {}
+
+        inline result_type operator()() {
+            if (pos_ == N) {
+                RNG::fill_words(*engine_, block_.data(), N);
+                pos_ = 0;
+            }
+            return block_[pos_++];
+        }
+    };
+
+    // UniformRandomBitGenerator that forwards to E::operator() through a call
+    // the optimizer may not inline. Compared against the direct engine it
+    // shows how much the distribution loop gains from inlining operator().
+    template <class E>
+    class noinline_feed {
+        E* engine_;
+
+#if defined(_MSC_VER)
+        __declspec(noinline)
+#else
+        [[gnu::noinline]]
+#endif
+        static std::uint64_t call(E* e) { return (*e)(); }
+
+    public:
+        using result_type = std::uint64_t;
+        static constexpr result_type min() noexcept { return 0; }
+        static constexpr result_type max() noexcept { return std::numeric_limits<result_type>::max(); }
+
+        explicit noinline_feed(E& e) noexcept : engine_(&e) {}
+
+        inline result_type operator()() { return call(engine_); }
+    };
+
+} // namespace RNG_bench
@@ -0,0 +1,186 @@
+#pragma once
+// file bench/bench_setup.h
+//
+// Setup-cost benchmarks: what it costs to create, seed, copy and position an
+// engine before the first useful output. Reported in nanoseconds per operation.
+//
+//      ctor()            default constructor (platform entropy)
+//      ctor(u64)         single 64-bit seed
+//      ctor(seed_seq)    std::seed_seq with 8 words
+//      reseed(u64)       reseed(), or seed() for engines without reseed()
+//      copy              copy construction
+//      move ctor         move construction, from an engine moved into the
+//                        other of two slots in the previous iteration
+//      move assign       move assignment between two engines
+//      big_jump          1024-bit jump with a dense random step
+//      jump64..jump256   Nasam1024 fixed jumps
+//      jump, long_jump   engines that provide them
+//      discard(n)        n = 1, 8, 1000, 10^6, 10^12
+//
+// An operation is only benchmarked on engines that provide it. Nasam1024
+// construction from a seed runs SplitMix64 + big_jump; compare ctor(u64) with
+// big_jump to see how much of it that is.
+
+#define NOMINMAX
+#include <cstdint>
+#include <optional>
+#include <random>
+#include <string>
+#include <type_traits>
+#include <utility>
+
+#include "bench_common.h"
+#include "bench_engines.h"
+
+namespace RNG_bench {
+
+    namespace setup_detail {
+
+        // ns per operation of body(n), which performs n operations
+        template <class Body>
+        std::vector<double> ns_per_op(const options& opt, Body&& body)
+        {
+            std::vector<double> v = measure_rate(opt, body);
+            for (double& x : v)
+                x = 1e9 / x;
+            return v;
+        }
+
+        template <class E, class Body>
+        void run_op(reporter& rep, const options& opt, const std::string& name, Body&& body)
+        {
+            if (!opt.wants_name(name)) return;
+            result r;
+            r.suite = "setup";
+            r.name = name;
+            r.engine = engine_name<E>::value;
+            r.mode = "scalar";
+            r.unit = "ns";
+            r.higher_is_better = false;
+            r.values = ns_per_op(opt, body);
+            rep.add(std::move(r));
+        }
+
+    } // namespace setup_detail
+
+    // Runs the setup-cost suite. Returns the number of failed checks (always 0).
+    inline int run_setup(reporter& rep, const options& opt)
+    {
+        using namespace setup_detail;
+
+        for_each_engine(opt, [&]<class E>(std::type_identity<E>) {
+
+            if constexpr (std::is_default_constructible_v<E>)
+                run_op<E>(rep, opt, "ctor()", [&](std::size_t n) {
+                    for (std::size_t i = 0; i < n; ++i) {
+                        E e;
+                        do_not_optimize(e);
+                    }
+                });
+
+            run_op<E>(rep, opt, "ctor(u64)", [&](std::size_t n) {
+                for (std::size_t i = 0; i < n; ++i) {
+                    E e(SEED + i);
+                    do_not_optimize(e);
+                }
+            });
+
+            if constexpr (std::is_constructible_v<E, std::seed_seq&>)
+                run_op<E>(rep, opt, "ctor(seed_seq)", [&](std::size_t n) {
+                    std::seed_seq seq{ 1u, 2u, 3u, 4u, 5u, 6u, 7u, 8u };
+                    for (std::size_t i = 0; i < n; ++i) {
+                        E e(seq);
+                        do_not_optimize(e);
+                    }
+                });
+
+            if constexpr (requires(E & e) { e.reseed(SEED); }) {
+                E e(SEED);
+                run_op<E>(rep, opt, "reseed(u64)", [&](std::size_t n) {
+                    for (std::size_t i = 0; i < n; ++i) {
+                        e.reseed(SEED + i);
+                        do_not_optimize(e);
+                    }
+                });
+            }
+            else if constexpr (requires(E & e) { e.seed(SEED); }) {
+                E e(SEED);
+                run_op<E>(rep, opt, "reseed(u64)", [&](std::size_t n) {
+                    for (std::size_t i = 0; i < n; ++i) {
+                        e.seed(SEED + i);
+                        do_not_optimize(e);
+                    }
+                });
+            }
+
+            {
+                E src(SEED);
+                run_op<E>(rep, opt, "copy", [&](std::size_t n) {
+                    for (std::size_t i = 0; i < n; ++i) {
+                        E e(src);
+                        do_not_optimize(e);
+                    }
+                });
+                // each iteration constructs one engine from the other slot's;
+                // emplace() also destroys the engine left there, as a scope would
+                std::optional<E> slot[2] = { src, src };
+                run_op<E>(rep, opt, "move ctor", [&](std::size_t n) {
+                    for (std::size_t i = 0; i < n; ++i) {
+                        slot[~i & 1].emplace(std::move(*slot[i & 1]));
+                        do_not_optimize(*slot[~i & 1]);
+                    }
+                });
+                E a(src), b(src);
+                run_op<E>(rep, opt, "move assign", [&](std::size_t n) {
+                    for (std::size_t i = 0; i < n; ++i) {
+                        E& to = (i & 1) ? a : b;
+                        to = std::move((i & 1) ? b : a);
+                        do_not_optimize(to);
+                    }
+                });
+            }
+
+            if constexpr (requires(E & e, std::uint64_t * step) { e.big_jump(step); }) {
+                E e(SEED);
+                std::uint64_t step[16];
+                RNG::SplitMix64 sm(SEED);
+                for (auto& s : step) s = sm();
+                run_op<E>(rep, opt, "big_jump", [&](std::size_t n) {
+                    for (std::size_t i = 0; i < n; ++i) {
+                        e.big_jump(step);
+                        do_not_optimize(e);
+                    }
+                });
+            }
+
+            auto run_jump = [&](const std::string& name, auto jump) {
+                E e(SEED);
+                run_op<E>(rep, opt, name, [&](std::size_t n) {
+                    for (std::size_t i = 0; i < n; ++i) {
+                        jump(e);
+                        do_not_optimize(e);
+                    }
+                });
+            };
+            if constexpr (requires(E & e) { e.jump64(); e.jump128(); e.jump192(); e.jump256(); }) {
+                run_jump("jump64", [](E& e) { e.jump64(); });
+                run_jump("jump128", [](E& e) { e.jump128(); });
+                run_jump("jump192", [](E& e) { e.jump192(); });
+                run_jump("jump256", [](E& e) { e.jump256(); });
+            }
+            if constexpr (requires(E & e) { e.jump(); e.long_jump(); }) {
+                run_jump("jump", [](E& e) { e.jump(); });
+                run_jump("long_jump", [](E& e) { e.long_jump(); });
+            }
+
+            if constexpr (requires(E & e) { e.discard(1ull); }) {
+                for (std::uint64_t k : { 1ull, 8ull, 1000ull, 1000000ull, 1000000000000ull }) {
+                    run_jump("discard(" + std::to_string(k) + ")", [k](E& e) { e.discard(k); });
+                }
+            }
+        });
+
+        return 0;
+    }
+
+} // namespace RNG_bench
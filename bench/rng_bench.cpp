@@ -0,0 +1,177 @@
+// file bench/rng_bench.cpp
+//
+// RNG benchmark runner.
+//
+// Build (from the bench directory)
+//      g++ -std=c++20 -O3 -march=native -I.. rng_bench.cpp ../platform_entropy.cpp -o rng_bench
+//      cl /std:c++20 /O2 /EHsc /I.. rng_bench.cpp ..\platform_entropy.cpp
+//
+// Usage
+//      rng_bench [options]
+//
+//      --suite NAME        run only this suite (may be repeated); default: all
+//                          suites: distributions, apps, setup
+//      --engine SUBSTR     run only engines whose name contains SUBSTR
+//      --filter SUBSTR     run only benchmarks whose name contains SUBSTR
+//      --reps N            timed repetitions per benchmark (default 5)
+//      --min-time SEC      minimum duration of one repetition (default 0.05)
+//      --inline-threshold X  minimum scalar/noinline speedup for buffered
+//                          engines (default 1.10), see bench_distributions.h
+//      --strict-inline     treat an inline gain below the threshold as a failure
+//      --threads N         largest thread count for multi-threaded suites
+//                          (default: hardware concurrency)
+//      --scale X           multiply the work of every application benchmark by X
+//      --json FILE         write all results to FILE as JSON
+//
+//  Regression check (see bench_compare.h)
+//      --save-baseline     write the results to <baseline-dir>/<machine>.json
+//      --compare           compare the results with <baseline-dir>/<machine>.json
+//      --baseline FILE     compare the results with FILE
+//      --baseline-dir DIR  where per-machine baselines live (default: baselines)
+//      --machine NAME      baseline name (default: host name)
+//      --threshold PCT     median change that counts as a regression (default 10)
+//      --alpha P           Mann-Whitney significance level (default 0.01)
+//
+//  Typical use: commit bench/baselines/<machine>.json once with
+//      rng_bench --reps 10 --save-baseline
+//  then before a release run
+//      rng_bench --reps 10 --compare
+//  which exits 1 if any result got significantly worse than the threshold.
+//
+// Exit status is 0 on success, 1 if any check failed or a regression was found,
+// 2 on a usage or I/O error.
+
+#define NOMINMAX
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <set>
+#include <string>
+
+#include "bench_common.h"
+#include "bench_apps.h"
+#include "bench_compare.h"
+#include "bench_distributions.h"
+#include "bench_setup.h"
+
+namespace {
+
+    void usage(const char* argv0)
+    {
+        std::cerr << "usage: " << argv0 << " [--suite NAME]... [--engine SUBSTR] [--filter SUBSTR]\n"
+            "       [--reps N] [--min-time SEC] [--inline-threshold X] [--strict-inline]\n"
+            "       [--threads N] [--scale X] [--json FILE]\n"
+            "       [--save-baseline] [--compare] [--baseline FILE] [--baseline-dir DIR]\n"
+            "       [--machine NAME] [--threshold PCT] [--alpha P]\n";
+    }
+
+} // namespace
+
+int main(int argc, char** argv)
+{
+    RNG_bench::options opt;
+    std::set<std::string> suites;
+    std::string json_path;
+    RNG_bench::compare_options copt;
+    bool save_baseline = false, compare = false;
+    std::string baseline_path, baseline_dir = "baselines", machine = RNG_bench::machine_name();
+
+    for (int i = 1; i < argc; ++i) {
+        const std::string arg = argv[i];
+        auto value = [&]() -> std::string {
+            if (i + 1 >= argc) {
+                usage(argv[0]);
+                std::exit(2);
+            }
+            return argv[++i];
+        };
+
+        try {
+            if (arg == "--suite") suites.insert(value());
+            else if (arg == "--engine") opt.engine_filter = value();
+            else if (arg == "--filter") opt.name_filter = value();
+            else if (arg == "--reps") opt.repetitions = std::max(1, std::stoi(value()));
+            else if (arg == "--min-time") opt.min_seconds = std::stod(value());
+            else if (arg == "--inline-threshold") opt.inline_threshold = std::stod(value());
+            else if (arg == "--strict-inline") opt.strict_inline = true;
+            else if (arg == "--threads") opt.max_threads = static_cast<unsigned>(std::max(1, std::stoi(value())));
+            else if (arg == "--scale") opt.app_scale = std::stod(value());
+            else if (arg == "--json") json_path = value();
+            else if (arg == "--save-baseline") save_baseline = true;
+            else if (arg == "--compare") compare = true;
+            else if (arg == "--baseline") baseline_path = value();
+            else if (arg == "--baseline-dir") baseline_dir = value();
+            else if (arg == "--machine") machine = value();
+            else if (arg == "--threshold") copt.threshold = std::stod(value()) / 100.0;
+            else if (arg == "--alpha") copt.alpha = std::stod(value());
+            else if (arg == "--help" || arg == "-h") { usage(argv[0]); return 0; }
+            else { usage(argv[0]); return 2; }
+        }
+        catch (const std::exception&) {
+            std::cerr << "invalid value for " << arg << "\n";
+            return 2;
+        }
+    }
+
+    if (compare && baseline_path.empty())
+        baseline_path = (std::filesystem::path(baseline_dir) / (machine + ".json")).string();
+
+    // Load the baseline before spending minutes on the run
+    std::vector<RNG_bench::result> baseline;
+    if (!baseline_path.empty()) {
+        try {
+            baseline = RNG_bench::load_results(baseline_path);
+        }
+        catch (const std::exception& e) {
+            std::cerr << "cannot load baseline: " << e.what() << "\n";
+            return 2;
+        }
+        if (opt.repetitions < 5)
+            std::cerr << "warning: fewer than 5 repetitions cannot reach significance at alpha "
+                << copt.alpha << "\n";
+    }
+
+    auto selected = [&](const char* suite) { return suites.empty() || suites.count(suite) != 0; };
+
+    RNG_bench::reporter rep;
+    int failures = 0;
+
+    if (selected("distributions"))
+        failures += RNG_bench::run_distributions(rep, opt);
+    if (selected("apps"))
+        failures += RNG_bench::run_apps(rep, opt);
+    if (selected("setup"))
+        failures += RNG_bench::run_setup(rep, opt);
+
+    auto write = [&](const std::string& path) {
+        std::ofstream out(path);
+        if (!out) {
+            std::cerr << "cannot open " << path << " for writing\n";
+            return false;
+        }
+        rep.write_json(out, machine);
+        return true;
+    };
+
+    if (!json_path.empty() && !write(json_path))
+        return 2;
+
+    if (save_baseline) {
+        std::error_code ec;
+        std::filesystem::create_directories(baseline_dir, ec);
+        const std::string path = (std::filesystem::path(baseline_dir) / (machine + ".json")).string();
+        if (!write(path))
+            return 2;
+        std::cout << "baseline saved to " << path << "\n";
+    }
+
+    if (!baseline_path.empty())
+        failures += RNG_bench::compare_results(baseline, rep.results(), copt);
+
+    if (failures) {
+        std::cout << failures << " check(s) failed or regressed\n";
+        return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}
@@ -3,21 +3,18 @@
 // Common types and utilities shared across the library
 
 #define NOMINMAX
+// Kept to what the engines need: no <iostream>, <random>, <string> or <vector>,
+// so that including one engine stays cheap. Headers that need more include it.
 #include <algorithm> // Needed for std::min
 #include <array>
 #include <bit>       // std::rotl, std::endian
 #include <cstddef>   // std::byte
 #include <cstdint>   // uint8_t
 #include <cstring>   // memcpy
-#include <iostream>
 #include <limits>    // std::numeric_limits
-#include <random>
 #include <span>      // std::span
-#include <stdexcept>
-#include <string>
 #include <type_traits> // Required for std::is_trivially_copyable_v
 #include <utility>   // for std::swap
-#include <vector>
 
 #include "Block.h"              // crypto::Block<N>
 #include "RNG_platform.h"       // get_entropy
@@ -47,6 +44,11 @@ namespace RNG {
     class Deterministic {};
     class NonDeterministic {};
 
+    // Anything usable as a SeedSequence (std::seed_seq and look-alikes). Used to
+    // keep the seed-sequence constructors from hijacking copies of the engine.
+    template <class S>
+    concept seed_sequence = requires(S & s, std::uint32_t * p) { s.generate(p, p); };
+
     // 64×64 → 128-bit multiplication
     inline u64 umul128(u64 a, u64 b, u64* hi) noexcept
     {
@@ -71,4 +73,84 @@ namespace RNG {
         return res;
     }
 
+    // Fill 'count' 64-bit words from 'e', through its bulk() block path when it has one.
+    // The words are the same ones count calls to e() would return.
+    template <class E>
+    inline void fill_words(E& e, u64* words, std::size_t count)
+    {
+        if constexpr (requires(E & g, u8 * p, std::size_t n) { g.bulk(p, n); }) {
+            e.bulk(reinterpret_cast<u8*>(words), count * sizeof(u64));
+        }
+        else {
+            for (std::size_t i = 0; i < count; ++i)
+                words[i] = e();
+        }
+    }
+
+    // Internal iteration over the next n outputs of any engine: the engine's own
+    // for_each_block() / generate_n() when it has them, otherwise 64-word
+    // blocks from fill_words(). f takes a std::span<const u64> block, or a
+    // single u64 for generate_n().
+    template <class E, class F>
+    inline void for_each_block(E& e, u64 n, F&& f)
+    {
+        if constexpr (requires { e.for_each_block(n, f); }) {
+            e.for_each_block(n, std::forward<F>(f));
+        }
+        else {
+            std::array<u64, 64> block;
+            while (n > 0) {
+                const std::size_t k = static_cast<std::size_t>(std::min<u64>(n, block.size()));
+                fill_words(e, block.data(), k);
+                f(std::span<const u64>(block.data(), k));
+                n -= k;
+            }
+        }
+    }
+
+    template <class E, class F>
+    inline void generate_n(E& e, u64 n, F&& f)
+    {
+        if constexpr (requires { e.generate_n(n, f); }) {
+            e.generate_n(n, std::forward<F>(f));
+        }
+        else {
+            for_each_block(e, n, [&](std::span<const u64> block) {
+                for (u64 x : block)
+                    f(x);
+            });
+        }
+    }
+
+    // Engine for parallel stream 'index' derived from 'seed'. Engines with
+    // jump(times) (fast, Nasam1024) are jumped 'index' times from E(seed) in
+    // one step, so any index costs about one jump; engines with only jump()
+    // take 'index' calls to it. The others are seeded with the index-th value
+    // of a SplitMix64 sequence. Stream 0 is always E(seed).
+    template <class E>
+    E make_stream(u64 seed, u64 index)
+    {
+        if constexpr (requires(E & e) { e.jump(index); }) {
+            E e(seed);
+            if (index != 0)
+                e.jump(index);
+            return e;
+        }
+        else if constexpr (requires(E & e) { e.jump(); }) {
+            E e(seed);
+            for (u64 i = 0; i < index; ++i)
+                e.jump();
+            return e;
+        }
+        else {
+            if (index == 0) return E(seed);
+            // SplitMix64 output for state seed + index*INCREMENT, inlined to
+            // keep common.h free of engine headers
+            u64 z = seed + (index + 1) * 0x9e3779b97f4a7c15ULL;
+            z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+            z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+            return E(z ^ (z >> 31));
+        }
+    }
+
 } // namespace RNG
@@ -6,6 +6,10 @@
 #include <cstdint>
 #include <string>     // for std::string in error messages
 #include <cstring>    // for strerror
+#include <algorithm>  // std::min
+#include <atomic>     // provisional entropy
+#include <chrono>     // provisional entropy
+#include <thread>     // provisional entropy
 
 
 #if defined(_WIN32) || defined(_WIN64)
@@ -21,6 +25,18 @@
     #include <sys/syscall.h> // for syscall
     #include <linux/random.h> // for GRND_ flags (may not exist on older systems)
     #include <errno.h>
+    #include <time.h>       // clock_gettime, provisional entropy
+    #if defined(__linux__)
+        #include <sys/auxv.h>   // getauxval(AT_RANDOM), provisional entropy
+    #endif
+#endif
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+    #if defined(_MSC_VER)
+        #include <intrin.h>
+    #else
+        #include <x86intrin.h>
+    #endif
+    #define RNG_PLATFORM_HAS_RDTSC
 #endif
 
 
@@ -108,6 +124,105 @@ namespace RNG_platform {
 #endif
     }
 
+    // Like get_entropy(), but never waits for the kernel's generator to be
+    // initialized: returns false (buffer contents unspecified) if it is not
+    // ready yet, as in early boot.
+    bool try_get_entropy(unsigned char* buffer, std::size_t size)
+    {
+#if (defined(__linux__) || defined(__FreeBSD__) || defined(__OpenBSD__)) && defined(GRND_NONBLOCK)
+        size_t filled = 0;
+        while (filled < size) {
+            long ret = syscall(SYS_getrandom, buffer + filled, size - filled, GRND_NONBLOCK);
+            if (ret > 0) {
+                filled += static_cast<size_t>(ret);
+            }
+            else if (ret == 0) {
+                return false;
+            }
+            else { // ret < 0
+                if (errno == EINTR) continue;
+                if (errno == EAGAIN) return false; // generator not initialized yet
+                if (errno == ENOSYS) break;        // no getrandom(): /dev/urandom does not block
+                throw std::runtime_error("getrandom() failed: " + std::string(strerror(errno)));
+            }
+        }
+        if (filled == size) return true;
+        get_entropy(buffer + filled, size - filled);
+        return true;
+#else
+        // BCryptGenRandom and /dev/urandom do not block
+        get_entropy(buffer, size);
+        return true;
+#endif
+    }
+
+    namespace {
+
+        inline std::uint64_t mix64(std::uint64_t z) noexcept
+        {
+            z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+            z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+            return z ^ (z >> 31);
+        }
+
+        struct weak_pool {
+            std::uint64_t h = 0x6a09e667f3bcc908ULL;
+            void add(std::uint64_t v) noexcept { h = mix64(h ^ v) + 0x9e3779b97f4a7c15ULL; }
+        };
+
+    } // namespace
+
+    // NOT cryptographic: distinct per boot, process and call, but guessable.
+    // Mixes what is available without blocking: the kernel's per-process
+    // AT_RANDOM bytes (Linux), clocks, the cycle counter, process and thread
+    // ids and ASLR addresses. For provisional seeds until try_get_entropy()
+    // succeeds.
+    void get_provisional_entropy(unsigned char* buffer, std::size_t size)
+    {
+        static std::atomic<std::uint64_t> calls{ 0 };  // distinct output per call
+        weak_pool pool;
+        pool.add(calls.fetch_add(1, std::memory_order_relaxed));
+
+#if defined(__linux__)
+        if (const auto* at_random = reinterpret_cast<const unsigned char*>(getauxval(AT_RANDOM))) {
+            std::uint64_t w[2];
+            std::memcpy(w, at_random, sizeof(w));
+            pool.add(w[0]);
+            pool.add(w[1]);
+        }
+#endif
+#if !defined(_WIN32) && !defined(_WIN64)
+        for (clockid_t id : { CLOCK_REALTIME, CLOCK_MONOTONIC
+#if defined(CLOCK_BOOTTIME)
+                              , CLOCK_BOOTTIME
+#endif
+            }) {
+            timespec ts{};
+            clock_gettime(id, &ts);
+            pool.add((static_cast<std::uint64_t>(ts.tv_sec) << 32) ^ static_cast<std::uint64_t>(ts.tv_nsec));
+        }
+        pool.add(static_cast<std::uint64_t>(getpid()));
+#endif
+        pool.add(static_cast<std::uint64_t>(std::chrono::system_clock::now().time_since_epoch().count()));
+        pool.add(static_cast<std::uint64_t>(std::chrono::steady_clock::now().time_since_epoch().count()));
+        pool.add(static_cast<std::uint64_t>(std::hash<std::thread::id>{}(std::this_thread::get_id())));
+        pool.add(reinterpret_cast<std::uintptr_t>(&pool));              // stack (ASLR)
+        pool.add(reinterpret_cast<std::uintptr_t>(&get_entropy));       // code (ASLR)
+        pool.add(reinterpret_cast<std::uintptr_t>(buffer));
+
+        std::uint64_t s = pool.h;
+        while (size > 0) {
+#if defined(RNG_PLATFORM_HAS_RDTSC)
+            s ^= static_cast<std::uint64_t>(__rdtsc());
+#endif
+            const std::uint64_t w = mix64(s += 0x9e3779b97f4a7c15ULL);
+            const std::size_t k = std::min(size, sizeof(w));
+            std::memcpy(buffer, &w, k);
+            buffer += k;
+            size -= k;
+        }
+    }
+
 } // namespace RNG_platform
 
 
@@ -0,0 +1,153 @@
+// file rng.cppm
+//
+// C++20 module interface of the engine library:  import rng;
+//
+// The headers are parsed once, when the module is built; importing it costs
+// a fraction of #include "RNG.h" in every translation unit.
+//
+// Build
+//      g++ -std=c++20 -fmodules-ts -x c++ -c rng.cppm                    (GCC 14 or later; then import rng;)
+//      clang++ -std=c++20 --precompile rng.cppm -o rng.pcm               (then -fmodule-file=rng=rng.pcm)
+//      cl /std:c++20 /interface /c rng.cppm
+//  and link platform_entropy.cpp as usual.
+//
+// Exported: the engines, RNG::random_device, the helpers of common.h, the
+// concepts and engine_base of RNG_engine.h, engine_traits and select_engine
+// (RNG_traits.h), RNG::views (RNG_views.h), any_engine with its factory
+// (RNG_any_engine.h), engine_array (RNG_engine_array.h), the mixers and
+// hashes (RNG_mix.h, RNG_hash.h), sketches (RNG_sketch.h), noise
+// (RNG_noise.h), stochastic rounding (RNG_stochastic_round.h), dither
+// (RNG_dither.h), sampling from logits (RNG_categorical.h) and bootstrap
+// weights (RNG_bootstrap.h). The file formats
+// and tools (RNG_fill.h, RNG_tape.h, RNG_checkpoint.h, RNG_battery.h), the
+// usage counters (RNG_stats.h) and early-boot seeding (RNG_boot_seed.h) are
+// used through their headers.
+//
+// The module does not export <iostream> or <random>: import std; or include
+// them where std::cout or std:: distributions are used.
+
+module;
+
+#define NOMINMAX
+#include "RNG_random_device.h"
+#include "RNG_SplitMix64.h"
+#include "RNG_wyrand.h"
+#include "RNG_fast.h"
+#include "Nasam1024.h"
+#include "RNG_engine.h"
+#include "RNG_traits.h"
+#include "RNG_views.h"
+#include "RNG_any_engine.h"
+#include "RNG_engine_array.h"
+#include "RNG_mix.h"
+#include "RNG_hash.h"
+#include "RNG_sketch.h"
+#include "RNG_noise.h"
+#include "RNG_stochastic_round.h"
+#include "RNG_dither.h"
+#include "RNG_categorical.h"
+#include "RNG_bootstrap.h"
+
+export module rng;
+
+export namespace RNG {
+    // common.h
+    using RNG::u8;
+    using RNG::u16;
+    using RNG::u32;
+    using RNG::u64;
+    using RNG::u128;
+    using RNG::Deterministic;
+    using RNG::NonDeterministic;
+    using RNG::seed_sequence;
+    using RNG::umul128;
+    using RNG::mul;
+    using RNG::fill_words;
+    using RNG::for_each_block;
+    using RNG::generate_n;
+    using RNG::make_stream;
+
+    // engines
+    using RNG::random_device;
+    using RNG::SplitMix64;
+    using RNG::wyrand;
+    using RNG::fast;
+    using RNG::nasam;
+    using RNG::Counter_1024;
+    using RNG::Nasam1024;
+
+    // RNG_engine.h
+    using RNG::engine;
+    using RNG::bulk_engine;
+    using RNG::engine_base;
+
+    // RNG_traits.h
+    using RNG::engine_traits;
+    using RNG::engine_requirements;
+    using RNG::meets;
+    using RNG::select_engine;
+
+    // RNG_views.h
+    using RNG::engine_kind_t;
+    using RNG::engine_kind;
+    namespace views {
+        using RNG::views::random_view;
+        using RNG::views::random;
+        using RNG::views::random_at_view;
+        using RNG::views::random_at;
+    }
+
+    // RNG_any_engine.h
+    using RNG::any_engine;
+    using RNG::make_engine;
+    using RNG::register_engine;
+    using RNG::engine_names;
+
+    // RNG_engine_array.h
+    using RNG::engine_array;
+
+    // RNG_mix.h, RNG_hash.h
+    using RNG::WY_P0;
+    using RNG::WY_P1;
+    using RNG::WY_P2;
+    using RNG::WY_P3;
+    using RNG::wymix;
+    using RNG::hash64;
+    using RNG::hash_bytes;
+    using RNG::hasher;
+    using RNG::reduce;
+    using RNG::bloom_probes;
+    using RNG::hash_counter;
+
+    // RNG_sketch.h
+    using RNG::minhash;
+    using RNG::minhash_update;
+    using RNG::minhash_similarity;
+    using RNG::bottom_k;
+    using RNG::priority_sample;
+
+    // RNG_noise.h
+    using RNG::noise;
+    using RNG::noise_kind;
+    using RNG::fractal;
+
+    // RNG_stochastic_round.h
+    using RNG::stochastic_bf16;
+    using RNG::stochastic_fp16;
+    using RNG::stochastic_int8;
+    using RNG::stochastic_round_bf16;
+    using RNG::stochastic_round_fp16;
+    using RNG::stochastic_round_int8;
+
+    // RNG_dither.h
+    using RNG::ditherer;
+    using RNG::dither_kind;
+
+    // RNG_categorical.h
+    using RNG::sample_logits;
+    using RNG::sample_logits_top_k;
+    using RNG::sample_logits_top_p;
+
+    // RNG_bootstrap.h
+    using RNG::poisson_bootstrap;
+}
@@ -0,0 +1,130 @@
+// file tests/test_categorical.cpp
+//
+// Regression tests for RNG_categorical.h: the samplers on +infinity logits,
+// temperatures whose inverse overflows, NaN and -infinity logits, and the
+// sampled frequencies against softmax.
+//
+// Build and run (from the tests directory)
+//      g++ -std=c++20 -O2 -I.. test_categorical.cpp ../platform_entropy.cpp -o test_categorical && ./test_categorical
+//      cl /std:c++20 /O2 /EHsc /I.. test_categorical.cpp ..\platform_entropy.cpp
+//
+// Prints the failed checks and exits with 1 if there are any.
+
+#define NOMINMAX
+#include <cmath>
+#include <cstddef>
+#include <cstdio>
+#include <limits>
+#include <stdexcept>
+#include <vector>
+
+#include "RNG_categorical.h"
+#include "RNG_fast.h"
+
+namespace {
+
+    constexpr float INF = std::numeric_limits<float>::infinity();
+    constexpr float NaN = std::numeric_limits<float>::quiet_NaN();
+
+    int failures = 0;
+
+    void check(bool ok, const char* what, const char* sampler = nullptr)
+    {
+        if (!ok) {
+            std::printf("FAILED: %s%s%s\n", sampler ? sampler : "", sampler ? ": " : "", what);
+            ++failures;
+        }
+    }
+
+    // Every sampler, as f(logits, engine, temperature)
+    template <class F>
+    void each_sampler(F&& f)
+    {
+        f("sample_logits", [](std::span<const float> l, RNG::fast& e, float t) { return RNG::sample_logits(l, e, t); });
+        f("top_k", [](std::span<const float> l, RNG::fast& e, float t) { return RNG::sample_logits_top_k(l, 3, e, t); });
+        f("top_p", [](std::span<const float> l, RNG::fast& e, float t) { return RNG::sample_logits_top_p(l, 0.9f, e, t); });
+        f("top_p = 1", [](std::span<const float> l, RNG::fast& e, float t) { return RNG::sample_logits_top_p(l, 1.0f, e, t); });
+    }
+
+    // Sample counts of sampler over n draws
+    template <class S>
+    std::vector<int> counts(const std::vector<float>& logits, S&& sampler, float t, int n)
+    {
+        RNG::fast e(5);
+        std::vector<int> c(logits.size());
+        for (int i = 0; i < n; ++i) ++c.at(sampler(logits, e, t));
+        return c;
+    }
+
+    // Each of the indices 'in' sampled about n / in.size() times, the others never
+    bool uniform_over(const std::vector<int>& c, std::initializer_list<std::size_t> in, int n)
+    {
+        int total = 0;
+        for (std::size_t i : in) {
+            const double expected = double(n) / in.size();
+            if (std::abs(c[i] - expected) > 5 * std::sqrt(expected)) return false;
+            total += c[i];
+        }
+        return total == n;
+    }
+
+} // namespace
+
+int main()
+{
+    const int N = 20000;
+
+    // +inf logits take the whole probability, shared uniformly. Before the
+    // fix, top_p found an empty nucleus and read past it.
+    each_sampler([&](const char* name, auto sampler) {
+        std::vector<float> logits(40, 0.0f);
+        for (std::size_t i = 0; i < logits.size(); ++i) logits[i] = std::sin(float(i));
+        logits[3] = INF;
+        check(uniform_over(counts(logits, sampler, 1.0f, N), { 3 }, N), "one +inf logit", name);
+        logits[17] = INF;
+        logits[38] = INF;
+        logits[5] = NaN;
+        check(uniform_over(counts(logits, sampler, 0.7f, N), { 3, 17, 38 }, N), "three +inf logits", name);
+    });
+
+    // A temperature whose inverse overflows is the argmax. Before the fix,
+    // top_p found an empty nucleus.
+    each_sampler([&](const char* name, auto sampler) {
+        const std::vector<float> logits = { 0.5f, 2.0f, -1.0f, 2.0f, 1.9f };
+        check(uniform_over(counts(logits, sampler, 1e-40f, 100), { 1 }, 100), "temperature 1e-40", name);
+        check(uniform_over(counts(logits, sampler, 0.0f, 100), { 1 }, 100), "temperature 0", name);
+    });
+
+    // No logit above -inf throws; NaN and -inf are never sampled
+    each_sampler([&](const char* name, auto sampler) {
+        const std::vector<float> none = { -INF, NaN, -INF };
+        bool threw = false;
+        try { RNG::fast e(1); sampler(none, e, 1.0f); }
+        catch (const std::invalid_argument&) { threw = true; }
+        check(threw, "no logit above -infinity throws", name);
+        const std::vector<float> some = { -INF, NaN, 0.0f, NaN, 0.0f, -INF };
+        check(uniform_over(counts(some, sampler, 1.0f, N), { 2, 4 }, N), "NaN and -inf never sampled", name);
+    });
+
+    // Frequencies against softmax, with the nucleus of top_p
+    {
+        const std::vector<float> logits = { 1.0f, 0.0f, 2.0f, -1.0f, 0.5f };
+        const auto c = counts(logits, [](std::span<const float> l, RNG::fast& e, float t) { return RNG::sample_logits(l, e, t); }, 1.0f, N);
+        double z = 0.0;
+        for (float v : logits) z += std::exp(double(v));
+        bool ok = true;
+        for (std::size_t i = 0; i < logits.size(); ++i) {
+            const double expected = N * std::exp(double(logits[i])) / z;
+            ok &= std::abs(c[i] - expected) < 5 * std::sqrt(expected) + 1;
+        }
+        check(ok, "sample_logits frequencies match softmax");
+
+        // probabilities, largest first, 0.56 (2), 0.21 (0), 0.13, 0.08, 0.03:
+        // the nucleus of 0.7 is {2, 0}
+        const auto cp = counts(logits, [](std::span<const float> l, RNG::fast& e, float t) { return RNG::sample_logits_top_p(l, 0.7f, e, t); }, 1.0f, N);
+        check(cp[1] == 0 && cp[3] == 0 && cp[4] == 0 && cp[0] + cp[2] == N, "top_p keeps the nucleus only");
+    }
+
+    std::printf("%s\n", failures ? "test_categorical: FAILED" : "test_categorical: ok");
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,128 @@
+// file tests/test_checkpoint.cpp
+//
+// Regression tests for checkpoint() / restore() (RNG_checkpoint.h): a restored
+// engine continues the saved one's stream, including after the position was
+// changed by something other than drawing (jumps, set_counter()).
+//
+// Build and run (from the tests directory)
+//      g++ -std=c++20 -O2 -I.. test_checkpoint.cpp ../platform_entropy.cpp -o test_checkpoint && ./test_checkpoint
+//      cl /std:c++20 /O2 /EHsc /I.. test_checkpoint.cpp ..\platform_entropy.cpp
+//
+// Prints the failed checks and exits with 1 if there are any.
+
+#define NOMINMAX
+#include <cstdint>
+#include <cstdio>
+
+#include "Nasam1024.h"
+#include "RNG_checkpoint.h"
+#include "RNG_fast.h"
+#include "RNG_SplitMix64.h"
+#include "RNG_wyrand.h"
+
+namespace {
+
+    int failures = 0;
+
+    void check(bool ok, const char* what)
+    {
+        if (!ok) {
+            std::printf("FAILED: %s\n", what);
+            ++failures;
+        }
+    }
+
+    // The next n outputs of a restored copy of e, of e itself and of e.at()
+    // are the same
+    template <class E>
+    bool continues(E& e, int n = 100)
+    {
+        E copy(1);
+        RNG::restore(copy, RNG::checkpoint(e));
+        bool ok = true;
+        for (int i = 0; i < n; ++i) {
+            const std::uint64_t x = e.at(0);
+            ok &= copy() == x && e() == x;
+        }
+        return ok;
+    }
+
+    template <class E>
+    void drawn(const char* what)
+    {
+        for (int k : { 0, 1, 3, 8, 13 }) {
+            E e(42);
+            for (int i = 0; i < k; ++i) e();
+            check(continues(e), what);
+        }
+    }
+
+    template <class E>
+    void jumped(const char* what)
+    {
+        for (int k : { 0, 1, 3, 8, 13 }) {
+            E e(42);
+            for (int i = 0; i < k; ++i) e();
+            e.jump();
+            check(continues(e), what);
+            e.long_jump();
+            check(continues(e), what);
+            e.jump(5);
+            check(continues(e), what);
+        }
+    }
+
+} // namespace
+
+int main()
+{
+    drawn<RNG::SplitMix64>("SplitMix64 after draws");
+    drawn<RNG::wyrand>("wyrand after draws");
+    drawn<RNG::fast>("fast after draws");
+    drawn<RNG::Nasam1024>("Nasam1024 after draws");
+
+    jumped<RNG::fast>("fast after jumps");
+    jumped<RNG::Nasam1024>("Nasam1024 after jumps");
+
+    // jump64() .. jump256() and big_jump() with a buffer partly read
+    {
+        RNG::Nasam1024 e(7);
+        e(); e(); e();
+        e.jump64();
+        check(continues(e, 5), "Nasam1024 after jump64");
+        e.jump192();
+        check(continues(e, 5), "Nasam1024 after jump192");
+        std::uint64_t step[16] = { 3, 1, 4, 1, 5, 9, 2, 6 };
+        e.big_jump(step);
+        check(continues(e), "Nasam1024 after big_jump");
+    }
+
+    // a jump moves the position by whole blocks, the place in the block is kept
+    {
+        RNG::Nasam1024 a(9), b(9);
+        for (int i = 0; i < 3; ++i) a();
+        for (int i = 0; i < 11; ++i) b();
+        a.jump64();
+        b.jump64();
+        for (int i = 0; i < 8; ++i) a();
+        bool ok = true;
+        for (int i = 0; i < 20; ++i) ok &= a() == b();
+        check(ok, "Nasam1024 jump keeps the position in the block");
+    }
+
+    // set_counter() starts a new block, whatever was buffered
+    {
+        RNG::Nasam1024 src(11), e(12);
+        e(); e();
+        e.set_counter(src.get_counter());
+        bool ok = true;
+        for (int i = 0; i < 20; ++i) ok &= e() == src();
+        check(ok, "Nasam1024 set_counter matches the source engine");
+        e();
+        e.set_counter(src.get_counter());
+        check(continues(e), "Nasam1024 after set_counter");
+    }
+
+    std::printf("%s\n", failures ? "test_checkpoint: FAILED" : "test_checkpoint: ok");
+    return failures ? 1 : 0;
+}
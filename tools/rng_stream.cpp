@@ -0,0 +1,331 @@
+// file tools/rng_stream.cpp
+//
+// rng_stream - write raw engine output to stdout, for PractRand / TestU01.
+//
+// Replaces the write-a-file-then-pipe-it workflow (write_PractRand_file +
+// "type test.bin | RNG_test.exe ...") with a direct pipe:
+//
+//      rng_stream nasam1024 | RNG_test stdin64 -tf 2 -te 1 -tlmax 64GB -multithreaded
+//      rng_stream fast --streams 4 | RNG_test stdin64 -tlmax 1TB
+//
+// Build (from the tools directory)
+//      g++ -std=c++20 -O3 -march=native -pthread -I.. rng_stream.cpp ../platform_entropy.cpp -o rng_stream
+//      cl /std:c++20 /O2 /EHsc /I.. rng_stream.cpp ..\platform_entropy.cpp
+//
+// Usage
+//      rng_stream ENGINE [options]
+//
+//      ENGINE              splitmix64 | wyrand | fast | nasam1024, or hash64:
+//                          RNG::hash64(n, seed) for n = 0, 1, 2, ... (RNG_hash.h)
+//      --seed S            64-bit seed (default 12345)
+//      --bytes N           stop after N bytes; K/M/G/T suffixes (binary) allowed.
+//                          Default: run until the reader closes the pipe
+//      --streams K         interleave K streams: stream i is the seeded engine
+//                          jumped i times (jump()), or for engines without
+//                          jump() seeded from a SplitMix64 sequence (default 1)
+//      --interleave W      64-bit words taken from each stream per turn (default 1)
+//      --threads T         producer threads (default 1). T > 1 needs discard()
+//
+// Output is little-endian 64-bit words, stream by stream in turns of W words.
+//
+// How it keeps up with the reader
+//      Producer threads fill a ring of buffers; the main thread only hands
+//      finished buffers to the kernel. On Linux, when stdout is a pipe, the
+//      pipe is enlarged with F_SETPIPE_SZ and buffers are passed with
+//      vmsplice(), so the data is never copied. A vmspliced buffer stays
+//      referenced by the pipe until the reader consumes it, so buffers are
+//      half the pipe size and a slot is refilled only after two later
+//      buffers have been spliced (at that point the pipe cannot hold it any
+//      more). Otherwise large write() / fwrite() calls are used.
+//
+// Exit status: 0 when done or when the reader closed the pipe, 1 on an I/O
+// error, 2 on a usage error.
+
+#define NOMINMAX
+#include <algorithm>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <limits>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#if defined(_WIN32)
+#include <fcntl.h>
+#include <io.h>
+#else
+#include <csignal>
+#include <errno.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+#include <unistd.h>
+#endif
+
+#include "../RNG_SplitMix64.h"
+#include "../RNG_wyrand.h"
+#include "../RNG_fast.h"
+#include "../Nasam1024.h"
+#include "../RNG_hash.h"
+#include "tools_common.h"
+
+namespace {
+
+    using u64 = std::uint64_t;
+    using RNG_tools::parse_size;
+
+    struct settings {
+        std::string engine;
+        u64 seed = 12345ull;
+        u64 bytes = std::numeric_limits<u64>::max();
+        unsigned streams = 1;
+        unsigned interleave = 1;
+        unsigned threads = 1;
+    };
+
+    // -----------------------------------------------------------------
+    // Output sink
+    // -----------------------------------------------------------------
+    class sink {
+        bool splice_ = false;
+        std::size_t chunk_ = std::size_t(4) << 20; // bytes per buffer
+
+    public:
+        sink() {
+#if defined(_WIN32)
+            _setmode(_fileno(stdout), _O_BINARY);
+#else
+            std::signal(SIGPIPE, SIG_IGN); // a closed reader shows up as EPIPE instead
+#if defined(__linux__)
+            struct stat st;
+            if (fstat(STDOUT_FILENO, &st) == 0 && S_ISFIFO(st.st_mode)) {
+                // Grow the pipe as far as we are allowed; 1 MiB is the usual unprivileged limit.
+                for (int size = 64 << 20; size >= (64 << 10); size /= 2)
+                    if (fcntl(STDOUT_FILENO, F_SETPIPE_SZ, size) >= 0) break;
+                const int size = fcntl(STDOUT_FILENO, F_GETPIPE_SZ);
+                if (size > 0) {
+                    splice_ = true;
+                    chunk_ = static_cast<std::size_t>(size) / 2;
+                }
+            }
+#endif
+#endif
+        }
+
+        std::size_t chunk_bytes() const noexcept { return chunk_; }
+
+        // Buffers handed over after buffer x that must complete before x may be reused
+        unsigned reuse_lag() const noexcept { return splice_ ? 2u : 0u; }
+
+        // Returns false when the reader has gone away. Throws on other errors.
+        bool put(const unsigned char* p, std::size_t n) {
+#if defined(_WIN32)
+            if (std::fwrite(p, 1, n, stdout) != n)
+                return false;
+            return true;
+#else
+            while (n > 0) {
+                ssize_t ret;
+#if defined(__linux__)
+                if (splice_) {
+                    iovec iov{ const_cast<unsigned char*>(p), n };
+                    ret = vmsplice(STDOUT_FILENO, &iov, 1, 0);
+                }
+                else
+#endif
+                    ret = write(STDOUT_FILENO, p, n);
+
+                if (ret < 0) {
+                    if (errno == EINTR) continue;
+                    if (errno == EPIPE) return false;
+                    throw std::runtime_error(std::string("write to stdout failed: ") + std::strerror(errno));
+                }
+                p += ret;
+                n -= static_cast<std::size_t>(ret);
+            }
+            return true;
+#endif
+        }
+    };
+
+    // -----------------------------------------------------------------
+    // Generation
+    // -----------------------------------------------------------------
+
+    // Ring of buffers shared by the producers and the writer
+    struct ring {
+        std::vector<std::vector<u64>> slots;
+        std::vector<u64> filled;  // buffer number held by each slot, or NONE
+        u64 handed_over = 0;      // buffers completely passed to the sink
+        bool stop = false;
+        std::mutex m;
+        std::condition_variable cv;
+
+        static constexpr u64 NONE = std::numeric_limits<u64>::max();
+    };
+
+    template <class E>
+    int run(const settings& s)
+    {
+        sink out;
+
+        const std::size_t group = static_cast<std::size_t>(s.streams) * s.interleave; // words per round
+        std::size_t words = (out.chunk_bytes() / sizeof(u64)) / group * group;
+        if (words == 0) {
+            std::cerr << "rng_stream: --streams x --interleave is larger than one buffer ("
+                << out.chunk_bytes() / sizeof(u64) << " words)\n";
+            return 2;
+        }
+        const std::size_t share = words / s.streams; // words per stream per buffer
+
+        unsigned threads = s.threads;
+        if constexpr (!requires(E & e) { e.discard(1ull); }) {
+            if (threads > 1) {
+                std::cerr << "rng_stream: engine has no discard(), using one producer thread\n";
+                threads = 1;
+            }
+        }
+
+        const unsigned R = std::max(4u, 2 * threads + out.reuse_lag() + 1);
+        ring q;
+        q.slots.assign(R, std::vector<u64>(words));
+        q.filled.assign(R, ring::NONE);
+
+        const u64 total_buffers = (s.bytes == std::numeric_limits<u64>::max())
+            ? ring::NONE : (s.bytes + words * sizeof(u64) - 1) / (words * sizeof(u64));
+
+        auto producer = [&](unsigned t) {
+            std::vector<E> engines;
+            for (unsigned i = 0; i < s.streams; ++i) {
+                engines.push_back(RNG::make_stream<E>(s.seed, i));
+                if constexpr (requires(E & e) { e.discard(1ull); })
+                    if (t) engines.back().discard(static_cast<u64>(t) * share);
+            }
+            std::vector<u64> scratch(s.streams > 1 ? share : 0);
+
+            for (u64 x = t; x < total_buffers; x += threads) {
+                const unsigned slot = static_cast<unsigned>(x % R);
+                {
+                    std::unique_lock<std::mutex> lock(q.m);
+                    q.cv.wait(lock, [&] { return q.stop || q.handed_over + R >= x + 1 + out.reuse_lag(); });
+                    if (q.stop) return;
+                }
+
+                u64* buf = q.slots[slot].data();
+                if (s.streams == 1) {
+                    RNG::fill_words(engines[0], buf, words);
+                }
+                else {
+                    for (unsigned i = 0; i < s.streams; ++i) {
+                        RNG::fill_words(engines[i], scratch.data(), share);
+                        // turn k of stream i lands at word (k * streams + i) * interleave
+                        for (std::size_t k = 0; k < share / s.interleave; ++k)
+                            std::memcpy(buf + (k * s.streams + i) * s.interleave,
+                                scratch.data() + k * s.interleave, s.interleave * sizeof(u64));
+                    }
+                }
+                if constexpr (requires(E & e) { e.discard(1ull); })
+                    if (threads > 1)
+                        for (auto& e : engines)
+                            e.discard(static_cast<u64>(threads - 1) * share);
+
+                {
+                    std::lock_guard<std::mutex> lock(q.m);
+                    q.filled[slot] = x;
+                }
+                q.cv.notify_all();
+            }
+        };
+
+        std::vector<std::thread> pool;
+        for (unsigned t = 0; t < threads; ++t)
+            pool.emplace_back(producer, t);
+
+        int status = 0;
+        u64 remaining = s.bytes;
+        try {
+            for (u64 x = 0; x < total_buffers; ++x) {
+                const unsigned slot = static_cast<unsigned>(x % R);
+                {
+                    std::unique_lock<std::mutex> lock(q.m);
+                    q.cv.wait(lock, [&] { return q.filled[slot] == x; });
+                }
+                const std::size_t n = static_cast<std::size_t>(std::min<u64>(remaining, words * sizeof(u64)));
+                if (!out.put(reinterpret_cast<const unsigned char*>(q.slots[slot].data()), n))
+                    break; // reader closed the pipe
+                remaining -= n;
+                {
+                    std::lock_guard<std::mutex> lock(q.m);
+                    q.handed_over = x + 1;
+                }
+                q.cv.notify_all();
+            }
+        }
+        catch (const std::exception& e) {
+            std::cerr << "rng_stream: " << e.what() << "\n";
+            status = 1;
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(q.m);
+            q.stop = true;
+        }
+        q.cv.notify_all();
+        for (auto& th : pool)
+            th.join();
+#if defined(_WIN32)
+        std::fflush(stdout);
+#endif
+        return status;
+    }
+
+    void usage()
+    {
+        std::cerr << "usage: rng_stream splitmix64|wyrand|fast|nasam1024|hash64 [--seed S] [--bytes N[K|M|G|T]]\n"
+            "                  [--streams K] [--interleave W] [--threads T]\n";
+    }
+
+} // namespace
+
+int main(int argc, char** argv)
+{
+    settings s;
+    for (int i = 1; i < argc; ++i) {
+        const std::string arg = argv[i];
+        auto value = [&]() -> std::string {
+            if (i + 1 >= argc) { usage(); std::exit(2); }
+            return argv[++i];
+        };
+        try {
+            if (arg == "--seed") s.seed = std::stoull(value(), nullptr, 0);
+            else if (arg == "--bytes") { if (!parse_size(value(), s.bytes)) throw std::invalid_argument(arg); }
+            else if (arg == "--streams") s.streams = static_cast<unsigned>(std::max(1, std::stoi(value())));
+            else if (arg == "--interleave") s.interleave = static_cast<unsigned>(std::max(1, std::stoi(value())));
+            else if (arg == "--threads") s.threads = static_cast<unsigned>(std::max(1, std::stoi(value())));
+            else if (arg == "--help" || arg == "-h") { usage(); return 0; }
+            else if (s.engine.empty() && arg[0] != '-') s.engine = arg;
+            else { usage(); return 2; }
+        }
+        catch (const std::exception&) {
+            std::cerr << "rng_stream: invalid value for " << arg << "\n";
+            return 2;
+        }
+    }
+
+    std::string name = s.engine;
+    std::transform(name.begin(), name.end(), name.begin(), [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+
+    if (name == "splitmix64") return run<RNG::SplitMix64>(s);
+    if (name == "wyrand") return run<RNG::wyrand>(s);
+    if (name == "fast") return run<RNG::fast>(s);
+    if (name == "nasam1024") return run<RNG::Nasam1024>(s);
+    if (name == "hash64") return run<RNG::hash_counter>(s);
+
+    usage();
+    return 2;
+}
@@ -0,0 +1,35 @@
+#pragma once
+// file tools/tools_common.h
+//
+// Command-line helpers shared by the tools (rng_stream, rng_fill), so that
+// their options parse the same way.
+
+#define NOMINMAX
+#include <cstdint>
+#include <cstdlib>
+#include <string>
+
+namespace RNG_tools {
+
+    // A byte count with an optional binary suffix: 1000, 64K, 1.5G, 2TB.
+    // False if the text is not one.
+    inline bool parse_size(const std::string& text, std::uint64_t& out)
+    {
+        char* end = nullptr;
+        const double v = std::strtod(text.c_str(), &end);
+        if (end == text.c_str() || v < 0) return false;
+        double mult = 1;
+        switch (*end) {
+        case 'k': case 'K': mult = 0x1p10; ++end; break;
+        case 'm': case 'M': mult = 0x1p20; ++end; break;
+        case 'g': case 'G': mult = 0x1p30; ++end; break;
+        case 't': case 'T': mult = 0x1p40; ++end; break;
+        default: break;
+        }
+        if (*end == 'B' || *end == 'b') ++end;
+        if (*end != '\0') return false;
+        out = static_cast<std::uint64_t>(v * mult);
+        return true;
+    }
+
+} // namespace RNG_tools